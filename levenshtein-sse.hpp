@@ -13,15 +13,60 @@
 #include <cstdint>
 #include <cassert>
 #include <limits>
+#include <type_traits>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <utility>
+
+/**
+ * With GCC and Clang on x86, the SIMD kernels are compiled for all
+ * supported instruction sets (using target attributes), and the best one
+ * for the CPU the code is running on is picked at runtime. Otherwise,
+ * or if LSTSSE_NO_RUNTIME_DISPATCH is defined, only the instruction sets
+ * enabled at compile time (e.g. through -march=native) are used.
+ */
+#if !defined(LSTSSE_NO_RUNTIME_DISPATCH) && (defined(__x86_64__) || defined(__i386__)) && \
+  ((defined(__clang__) && __clang_major__ >= 6) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 7))
+#define LSTSSE_RUNTIME_DISPATCH
+#endif
+
+#ifdef LSTSSE_RUNTIME_DISPATCH
+#include <immintrin.h>
+#define LSTSSE_TARGET(isa) __attribute__((target(isa)))
+#define LSTSSE_FLATTEN __attribute__((flatten))
+#define LSTSSE_SSE2
+#define LSTSSE_SSSE3
+#define LSTSSE_SSE4_1
+#define LSTSSE_AVX2
+#define LSTSSE_AVX512BW
+#else
+#define LSTSSE_TARGET(isa)
+#define LSTSSE_FLATTEN
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define LSTSSE_SSE2
+#endif
 #ifdef __SSSE3__
 #include <tmmintrin.h>
+#define LSTSSE_SSSE3
 #endif
 #ifdef __SSE4_1__
 #include <smmintrin.h>
+#define LSTSSE_SSE4_1
 #endif
 #ifdef __AVX2__
 #include <immintrin.h>
+#define LSTSSE_AVX2
+#endif
+#ifdef __AVX512BW__
+#define LSTSSE_AVX512BW
 #endif
+#endif // LSTSSE_RUNTIME_DISPATCH
 
 namespace levenshteinSSE {
 
@@ -56,901 +101,8498 @@ template<typename Container1, typename Container2>
 std::size_t levenshtein(const Container1& a, const Container2& b);
 
 /**
- * Only implementation-specific stuff below
+ * Scratch memory for computing distances.
+ * 
+ * The functions that do not take a workspace use the one of the calling
+ * thread (LevenshteinWorkspace::threadLocal()). Its buffers only ever
+ * grow, so once they are large enough for the inputs at hand, computing
+ * a distance does not allocate memory.
+ * 
+ * See the class definition below for the available methods.
  */
+class LevenshteinWorkspace;
 
 /**
- * C++ STL allocator returning aligned memory with additional memory
- * on both sides to safely allow garbage reads/writes
- * 
- * based on https://stackoverflow.com/a/8545389/688904
+ * Same as levenshtein(a, aEnd, b, bEnd) and levenshtein(a, b), using the
+ * buffers of the given workspace.
  */
-template <typename T, std::size_t N = 16>
-class AlignmentAllocator;
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace);
 
-#ifdef __SSE2__
-template <typename T, std::size_t N>
-class AlignmentAllocator {
-public:
-  typedef T value_type;
-  typedef std::size_t size_type;
-  typedef std::ptrdiff_t difference_type;
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace);
 
-  typedef T* pointer;
-  typedef const T* const_pointer;
+/**
+ * Options for computing on multiple threads.
+ * 
+ * threads is the number of threads to use, including the calling one
+ * (0 means std::thread::hardware_concurrency()). tileSize is the edge
+ * length of the blocks of the table of a single distance that are handed
+ * out to the threads, and blockSize that of the blocks of pairs of
+ * levenshteinMatrix() (0 means picking one based on the input lengths and
+ * thread count).
+ */
+struct ParallelPolicy {
+  explicit ParallelPolicy(unsigned threads = 0, std::size_t tileSize = 0,
+    std::size_t blockSize = 0)
+    : threads(threads), tileSize(tileSize), blockSize(blockSize) {}
 
-  typedef T& reference;
-  typedef const T& const_reference;
+  unsigned threads;
+  std::size_t tileSize;
+  std::size_t blockSize;
+};
 
-  constexpr inline AlignmentAllocator () noexcept { }
+/**
+ * Compute the Levenshtein distance of [a, aEnd) and [b, bEnd), like
+ * levenshtein(), but split the work across multiple threads.
+ * 
+ * This is only worth it for very long inputs (many thousands of elements
+ * each); shorter ones are computed on the calling thread.
+ * Iterators that are not random access are always handled on the
+ * calling thread.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  ParallelPolicy policy);
 
-  template <typename T2>
-  constexpr inline AlignmentAllocator (const AlignmentAllocator<T2, N> &) noexcept { }
+/**
+ * Compute the Levenshtein distance of a and b on multiple threads.
+ * The same requirements as for levenshtein(a, b) apply to the containers.
+ */
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b, ParallelPolicy policy);
 
-  inline ~AlignmentAllocator () noexcept { }
+/**
+ * Same as above, using the given workspace on the calling thread.
+ * The other threads use their thread-local workspaces.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  ParallelPolicy policy, LevenshteinWorkspace& workspace);
 
-  inline pointer address (reference r) {
-    return &r;
-  }
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b, ParallelPolicy policy,
+  LevenshteinWorkspace& workspace);
 
-  inline const_pointer address (const_reference r) const {
-    return &r;
-  }
+/**
+ * Compute the Levenshtein distance of [a, aEnd) and [b, bEnd), provided
+ * that it is at most maxDist. Otherwise, maxDist + 1 is returned.
+ * 
+ * This only looks at the part of the table that can possibly
+ * lead to a distance <= maxDist and stops as soon as that is no longer
+ * possible, so it is a lot faster than levenshtein() for small maxDist.
+ * 
+ * The same requirements as for levenshtein() apply to the iterators.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist);
 
-  inline pointer allocate (size_type n) {
-    // this allocator is special in that it leaves 4*N bytes before and after
-    // the allocated area for garbage reads/writes
-    return reinterpret_cast<pointer>(reinterpret_cast<char*>(_mm_malloc(n * sizeof(value_type) + 8 * N, N)) + 4*N);
-  }
+/**
+ * Compute the Levenshtein distance of a and b, provided that it is
+ * at most maxDist. Otherwise, maxDist + 1 is returned.
+ * 
+ * The same requirements as for levenshtein() apply to the containers.
+ */
+template<typename Container1, typename Container2>
+std::size_t levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist);
 
-  inline void deallocate (pointer p, size_type) {
-    _mm_free(reinterpret_cast<char*>(p) - 4*N);
-  }
+/**
+ * Same as the two functions above, using the buffers of the given workspace.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace);
 
-  inline void construct (pointer p, const value_type& value) {
-     new (p) value_type (value);
-  }
+template<typename Container1, typename Container2>
+std::size_t levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist,
+  LevenshteinWorkspace& workspace);
 
-  inline void destroy (pointer p) {
-    p->~value_type ();
-  }
+/**
+ * Cheap lower bound on the Levenshtein distance of a and b: the larger of
+ * the difference in length and a bound from the histograms of a and b
+ * (for integral element types), in linear time and constant space.
+ * Useful for rejecting pairs before computing their distance.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinLowerBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd);
 
-  constexpr inline size_type max_size () const noexcept {
-    return size_type (-1) / sizeof (value_type);
-  }
+template<typename Container1, typename Container2>
+std::size_t levenshteinLowerBound(const Container1& a, const Container2& b);
 
-  template <typename T2>
-  struct rebind {
-    typedef AlignmentAllocator<T2, N> other;
-  };
+/**
+ * Cheap upper bound on the Levenshtein distance of a and b, in linear time
+ * and constant space. For inputs of the same length, this is their
+ * Hamming distance.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinUpperBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd);
 
-  constexpr bool operator!=(const AlignmentAllocator<T,N>& other) const  {
-    return !(*this == other);
-  }
+template<typename Container1, typename Container2>
+std::size_t levenshteinUpperBound(const Container1& a, const Container2& b);
 
-  // Returns true if and only if storage allocated from *this
-  // can be deallocated from other, and vice versa.
-  // Always returns true for stateless allocators.
-  constexpr bool operator==(const AlignmentAllocator<T,N>& other) const {
-    return other.usesMMAlloc;
-  }
-  
-  static constexpr bool usesMMAlloc = true;
-};
-#endif
+/**
+ * Whether the Levenshtein distance of a and b is at most maxDist.
+ * 
+ * This tries the bounds above first, and only computes the distance
+ * (like levenshteinBounded()) if they do not decide it.
+ */
+template<typename Iterator1, typename Iterator2>
+bool levenshteinIfWithin(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist);
 
-template <typename T>
-class AlignmentAllocator<T, 1> : public std::allocator<T> {
-public:
-  static constexpr bool usesMMAlloc = false;
-};
+template<typename Container1, typename Container2>
+bool levenshteinIfWithin(const Container1& a, const Container2& b, std::size_t maxDist);
 
-#ifdef __SSSE3__
-constexpr std::size_t alignment = 16;
-#else
-#warning "No SIMD extensions enabled"
-constexpr std::size_t alignment = 1;
-#endif
+/**
+ * Same as the two functions above, using the buffers of the given workspace.
+ */
+template<typename Iterator1, typename Iterator2>
+bool levenshteinIfWithin(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+bool levenshteinIfWithin(const Container1& a, const Container2& b, std::size_t maxDist,
+  LevenshteinWorkspace& workspace);
 
 /**
- * Some notes on the algorithm used here:
- * 
- * The standard Levenshtein metric is usually calculated using the
- * Wagner–Fischer algorithm [1]. This essentially means calculating
- * Levenshtein(a[:n], b[:m]) for all prefixes a[:n] and b[:m] of a and b,
- * storing the results in a table (and possibly “forgetting”
- * the previous rows to save memory). Normally, this is performed
- * row by row, but this approach has the disadvantage that it is not
- * easily converted to using SIMD instructions.
- * 
- * The “diagonal” algorithm variants in this file calculate the minor
- * diagonals one by one. There, the index `i` always corresponds to the
- * table row in which we currently are and `j` always denotes the column. 
- * Note that the tables have a trivial i=0 row and j=0 column; The
- * table entry [i,j] corresponds to the comparison a[i-1] == b[j-1].
- * A diagonal is defined by its index `k`, yielding the inner loop invariant
- * k == i + j.
- * 
- * The outer loop iterates over all diagonals from k = 0 to
- * k = len(a)+len(b) (compare with the table in [1] to verify), meaning
- * that the length of the diagonals may vary between iterations.
- * The current diagonal and the previous diagonal are kept in memory,
- * referred to as diag and diag2 respectively.
- * 
- * In the inner loop, the rows are treated in descending order,
- * i.e. `i` decreases from iteration to iteration, to avoid overwriting
- * data needed in the next iteration.
+ * Compute the Levenshtein distance of the UTF-8 strings a and b in code
+ * points (rather than bytes, like levenshtein() does for std::string).
  * 
- * [1]: https://en.wikipedia.org/wiki/Wagner%E2%80%93Fischer_algorithm
+ * Both inputs are validated first; std::invalid_argument is thrown if
+ * either is not valid UTF-8. If both are ASCII, they are compared byte
+ * by byte right away. Otherwise, they are decoded into 16-bit elements
+ * (32-bit if any code point lies outside the Basic Multilingual Plane)
+ * in the workspace, so this does not allocate once the workspace is
+ * large enough.
  */
+inline std::size_t levenshteinUtf8(const char* a, const char* aEnd, const char* b,
+  const char* bEnd);
 
 /**
- * Trivial implementation of one inner loop iteration.
+ * The containers need to provide .data() and .size(), e.g. std::string.
+ */
+template<typename Container1, typename Container2>
+std::size_t levenshteinUtf8(const Container1& a, const Container2& b);
+
+/**
+ * Same as the two functions above, using the buffers of the given workspace.
+ */
+inline std::size_t levenshteinUtf8(const char* a, const char* aEnd, const char* b,
+  const char* bEnd, LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinUtf8(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace);
+
+/**
+ * Equality policies for levenshtein() and levenshteinBounded(), which
+ * decide when two elements count as equal. Each one maps every element
+ * to a canonical one with fold(), and elements are equal if their folded
+ * values are. Custom policies derive from LevenshteinEquality and provide
+ * the same fold() member template.
  * 
- * Note that i is passed as a reference; The SIMD version may decrease it
- * by more than 1.
+ * The other functions and classes (levenshteinOSA(), levenshteinDamerau(),
+ * levenshteinUtf8(), levenshteinAlignment(), LevenshteinMatcher, ...) do
+ * not take a policy and always compare elements exactly; fold the inputs
+ * before passing them in to get the same effect.
  */
-template<typename Vec1, typename Vec2, typename Iterator1, typename Iterator2>
-struct LevenshteinIterationBase {
-static inline void perform(const Iterator1& a, const Iterator2& b,
-  std::size_t& i, std::size_t j, std::size_t bLen, Vec1& diag, const Vec2& diag2)
-{
-  std::uint32_t min = std::min(diag2[i], diag2[i-1]);
-  if (min < diag[i-1]) {
-    diag[i] = min + 1;
+struct LevenshteinEquality {};
+
+/**
+ * Elements are only equal to themselves (the default).
+ */
+struct LevenshteinExact : LevenshteinEquality {
+  template<typename T>
+  T fold(T c) const { return c; }
+};
+
+/**
+ * 'A' to 'Z' are equal to 'a' to 'z', for any integral element type
+ * (so also for UTF-16 and UTF-32 text). All other elements are only
+ * equal to themselves.
+ */
+struct LevenshteinAsciiCaseInsensitive : LevenshteinEquality {
+  template<typename T>
+  T fold(T c) const { return c >= T('A') && c <= T('Z') ? T(c + ('a' - 'A')) : c; }
+};
+
+/**
+ * Elements are equal if they are mapped to the same value by a table
+ * for the values 0 to 255, e.g. to ignore case in a single-byte encoding
+ * like Latin-1. Elements outside of that range are only equal to
+ * themselves.
+ */
+class LevenshteinFoldTable : public LevenshteinEquality {
+public:
+  /**
+   * Maps every value to itself.
+   */
+  LevenshteinFoldTable() {
+    for (std::size_t c = 0; c < 256; ++c) {
+      table_[c] = static_cast<unsigned char>(c);
+    }
   }
-  else {
-    diag[i] = diag[i-1] + (a[i-1] != b[j-1]);
+
+  /**
+   * Maps every value c to map(c), e.g. [](unsigned char c) { return std::tolower(c); }.
+   */
+  template<typename Map>
+  explicit LevenshteinFoldTable(Map map) {
+    for (std::size_t c = 0; c < 256; ++c) {
+      table_[c] = static_cast<unsigned char>(map(static_cast<unsigned char>(c)));
+    }
   }
-  --i;
-}
+
+  /**
+   * Map x to y.
+   */
+  void set(unsigned char x, unsigned char y) { table_[x] = y; }
+
+  template<typename T>
+  T fold(T c) const {
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+      "LevenshteinFoldTable needs integral element types other than bool");
+    typedef typename std::make_unsigned<T>::type U;
+    return static_cast<U>(c) < 256 ? T(table_[static_cast<U>(c)]) : c;
+  }
+
+private:
+  unsigned char table_[256];
 };
 
 /**
- * Start SIMD-Land
+ * Compute the Levenshtein distance of [a, aEnd) and [b, bEnd), comparing
+ * the elements according to the given equality policy (see above).
  * 
- * Currently, only SSSE3+ is supported, since we use
- * _mm_shuffle_epi8 and _mm_alignr_epi8.
+ * Unless the policy is LevenshteinExact, both inputs are folded once
+ * into the workspace (which takes linear time and does not allocate once
+ * the workspace is large enough), and the distance of the folded inputs
+ * is computed by the same engines as for levenshtein(). So unlike
+ * folding the inputs into new strings, this does not allocate memory
+ * for every pair. The elements need to be of an integral type then.
  * 
- * If you are not familiar with SSE and/or the intrinsics,
- * you can just believe me that they do about the same thing
- * as LevenshteinIterationBase::perform.
+ * The same requirements as for levenshtein() apply to the iterators.
  */
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd, const Equality& equal);
 
-#ifdef __SSSE3__
-#ifndef __SSE4_1__
-// straightforward _mm_min_epi32 polyfill using only SSE2
-inline __m128i _mm_min_epi32 (__m128i a, __m128i b) {
-  __m128i compare = _mm_cmpgt_epi32(a, b);
-  __m128i aIsSmaller = _mm_andnot_si128(a, compare);
-  __m128i bIsSmaller = _mm_and_si128   (b, compare);
-  return _mm_or_si128(aIsSmaller, bIsSmaller);
-}
-#endif // __SSE4_1__
-#endif // __SSSE3__
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(const Container1& a, const Container2& b, const Equality& equal);
 
-#ifdef __AVX2__
-// provide an AVX2 version of _mm256_alignr_epi32(a, b, 7)
-// (i.e. move a one epi32 to the left and write the highest
-// bytes of b to the lowest of a)
-/*#ifndef __AVX512F__*/
-__m256i _mm256_alignr_epi32_7(__m256i a, __m256i b) {
-  const __m256i rotl1_256_epi32 = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
-  __m256i combined = _mm256_blend_epi32(a, b, 0x80);
-  return _mm256_permutevar8x32_epi32(combined, rotl1_256_epi32);
-}
-/*
-#else
-__m256i _mm256_alignr_epi32_7(__m256i a, __m256i b) {
-  return _mm256_alignr_epi32(a, b, 7);
-}
-#endif*/
-#endif
+/**
+ * Same as levenshteinBounded(), comparing the elements according to the
+ * given equality policy.
+ */
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, const Equality& equal);
 
-template<typename T>
-struct LevenshteinIterationSIMD {
-/* Decide which implementation is acceptable */
-static inline void performSIMD(const T* a, const T* b,
-  std::size_t& i, std::size_t j, std::size_t bLen,
-  std::uint32_t* diag, const std::uint32_t* diag2)
-{
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist,
+  const Equality& equal);
 
-#ifdef __AVX2__
-  if (i >= 32 && bLen - j >= 32) {
-    performSSE_AVX2(a, b, i, j, bLen, diag, diag2);
-    return;
-  }
-#endif
+/**
+ * Same as the four functions above, using the buffers of the given
+ * workspace.
+ */
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd, const Equality& equal,
+  LevenshteinWorkspace& workspace);
 
-#ifdef __SSSE3__
-  if (i >= 16 && bLen - j >= 16) {
-    performSSE(a, b, i, j, bLen, diag, diag2);
-    return;
-  }
-#endif
-  
-  LevenshteinIterationBase<std::uint32_t*, const std::uint32_t*, const T*, const T*>
-    ::perform(a, b, i, j, bLen, diag, diag2);
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(const Container1& a, const Container2& b, const Equality& equal,
+  LevenshteinWorkspace& workspace);
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, const Equality& equal, LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist,
+  const Equality& equal, LevenshteinWorkspace& workspace);
+
+/**
+ * One run of consecutive edit operations of the same kind, see
+ * levenshteinAlignment().
+ */
+enum EditOperation { editMatch, editSubstitute, editInsert, editDelete };
+
+struct EditRun {
+  EditOperation operation;
+  std::size_t length;
+};
+
+/**
+ * Compute an optimal sequence of edit operations that turns [a, aEnd)
+ * into [b, bEnd), as runs of operations of the same kind.
+ * editMatch and editSubstitute consume one element of both inputs,
+ * editDelete one element of a and editInsert one element of b.
+ * The total length of all runs other than editMatch is the
+ * Levenshtein distance.
+ * 
+ * This needs memory linear in the input lengths, and takes about twice
+ * as long as computing the distance using the diagonal algorithm.
+ * 
+ * The same requirements as for levenshtein() apply to the iterators.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<EditRun> levenshteinAlignment(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd);
+
+/**
+ * Compute an optimal sequence of edit operations that turns a into b.
+ * The same requirements as for levenshtein() apply to the containers.
+ */
+template<typename Container1, typename Container2>
+std::vector<EditRun> levenshteinAlignment(const Container1& a, const Container2& b);
+
+/**
+ * Same as the two functions above, using the buffers of the given workspace.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<EditRun> levenshteinAlignment(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+std::vector<EditRun> levenshteinAlignment(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace);
+
+/**
+ * The cost model of levenshtein(): Every insertion, deletion and
+ * substitution costs 1.
+ */
+struct LevenshteinUnitCosts {};
+
+/**
+ * A cost model with a fixed cost for each kind of edit operation.
+ */
+struct LevenshteinWeights {
+  explicit LevenshteinWeights(std::uint32_t insertionCost = 1, std::uint32_t deletionCost = 1,
+    std::uint32_t substitutionCost = 1)
+    : insertionCost(insertionCost), deletionCost(deletionCost),
+      substitutionCost(substitutionCost) {}
+
+  template<typename T>
+  std::uint32_t insertion(const T&) const { return insertionCost; }
+
+  template<typename T>
+  std::uint32_t deletion(const T&) const { return deletionCost; }
+
+  template<typename T1, typename T2>
+  std::uint32_t substitution(const T1& x, const T2& y) const {
+    return x == y ? 0 : substitutionCost;
+  }
+
+  std::uint32_t insertionCost;
+  std::uint32_t deletionCost;
+  std::uint32_t substitutionCost;
+};
+
+/**
+ * A cost model for 1-byte element types with a separate cost for each
+ * pair of elements that can be substituted for one another, e.g. based
+ * on the distance of keys on a keyboard or on OCR confusion rates.
+ * Insertions and deletions have fixed costs.
+ */
+class LevenshteinCostTable {
+public:
+  /**
+   * All substitutions initially cost substitutionCost.
+   */
+  explicit LevenshteinCostTable(std::uint32_t insertionCost = 1, std::uint32_t deletionCost = 1,
+    std::uint32_t substitutionCost = 1)
+    : insertionCost_(insertionCost), deletionCost_(deletionCost),
+      table_(256 * 256, substitutionCost)
+  {
+    for (std::size_t x = 0; x < 256; ++x) {
+      table_[x * 256 + x] = 0;
+    }
+  }
+
+  /**
+   * Set the cost of substituting y for x. Matching elements always cost
+   * nothing, so x and y need to be different.
+   */
+  void set(unsigned char x, unsigned char y, std::uint32_t cost) {
+    assert(x != y);
+    table_[x * 256 + y] = cost;
+  }
+
+  template<typename T>
+  std::uint32_t insertion(const T&) const { return insertionCost_; }
+
+  template<typename T>
+  std::uint32_t deletion(const T&) const { return deletionCost_; }
+
+  template<typename T1, typename T2>
+  std::uint32_t substitution(const T1& x, const T2& y) const {
+    static_assert(sizeof(T1) == 1 && sizeof(T2) == 1, "LevenshteinCostTable only supports 1-byte elements");
+    return table_[static_cast<unsigned char>(x) * 256 + static_cast<unsigned char>(y)];
+  }
+
+  // the substitution costs, with the cost for (x, y) at x * 256 + y
+  const std::uint32_t* table() const { return table_.data(); }
+
+private:
+  std::uint32_t insertionCost_;
+  std::uint32_t deletionCost_;
+  std::vector<std::uint32_t> table_;
+};
+
+/**
+ * Compute the edit distance of [a, aEnd) and [b, bEnd) with the given
+ * costs, i.e. the minimum total cost of a sequence of insertions, deletions
+ * and substitutions that turns a into b. The same requirements as for
+ * levenshtein() apply to the iterators.
+ * 
+ * costs may be one of the models above, or of any other type with
+ * 
+ *   std::uint32_t insertion(const T2& y) const;  // inserting y
+ *   std::uint32_t deletion(const T1& x) const;   // deleting x
+ *   std::uint32_t substitution(const T1& x, const T2& y) const;
+ * 
+ * where substitution() needs to return 0 if x and y are equal. Deleting
+ * all of a and inserting all of b needs to cost less than 2^32 in total.
+ * 
+ * For LevenshteinUnitCosts, this is the same as levenshtein(). There are
+ * SIMD kernels for LevenshteinWeights with pointers to 1, 2 or 4-byte
+ * integral types, and for LevenshteinCostTable with pointers to 1-byte
+ * types (AVX2 only); other cost models are computed one entry at a time.
+ */
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs);
+
+/**
+ * Same as above, for two containers.
+ * The same requirements as for levenshtein(a, b) apply to them.
+ */
+template<typename Container1, typename Container2, typename Costs>
+std::size_t levenshteinWeighted(const Container1& a, const Container2& b, const Costs& costs);
+
+/**
+ * Same as the two functions above, using the buffers of the given workspace.
+ */
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs, LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2, typename Costs>
+std::size_t levenshteinWeighted(const Container1& a, const Container2& b, const Costs& costs,
+  LevenshteinWorkspace& workspace);
+
+/**
+ * Compute the optimal string alignment distance of [a, aEnd) and
+ * [b, bEnd), i.e. the Levenshtein distance where swapping two adjacent
+ * elements also counts as a single edit, as long as no element is edited
+ * more than once (so that e.g. "ca" -> "abc" takes 3 edits, not 2).
+ * The same requirements as for levenshtein() apply to the iterators.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinOSA(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd);
+
+/**
+ * Same as above, for two containers.
+ * The same requirements as for levenshtein(a, b) apply to them.
+ */
+template<typename Container1, typename Container2>
+std::size_t levenshteinOSA(const Container1& a, const Container2& b);
+
+/**
+ * Compute the Damerau–Levenshtein distance of [a, aEnd) and [b, bEnd),
+ * i.e. the Levenshtein distance where swapping two adjacent elements
+ * also counts as a single edit, without the restriction of
+ * levenshteinOSA() (so that "ca" -> "abc" takes 2 edits).
+ * The same requirements as for levenshtein() apply to the iterators.
+ * 
+ * Unlike levenshteinOSA(), this is a proper metric, but it needs some
+ * extra state per row and column on top of the diagonals of
+ * levenshteinOSA(), and there is no bit-parallel variant. It uses the
+ * same SSE4.1/AVX2 kernels if both inputs are pointers to the same 1, 2
+ * or 4-byte scalar type, the CPU supports SSE4.1, and the longer input
+ * has 64 to 65534 elements (after removing common prefixes and suffixes).
+ * With AVX2, this takes about 13 to 17 times as long as levenshtein() for
+ * 1k to 64k elements (10 times as long as levenshteinOSA()). Otherwise,
+ * it is computed one entry at a time, which takes about 60 to 70 times as
+ * long as levenshtein() for long inputs. For short inputs, where
+ * levenshtein() is bit-parallel, the gap is larger either way (about 40
+ * to 60 times for 64 elements).
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerau(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd);
+
+/**
+ * Same as above, for two containers.
+ * The same requirements as for levenshtein(a, b) apply to them.
+ */
+template<typename Container1, typename Container2>
+std::size_t levenshteinDamerau(const Container1& a, const Container2& b);
+
+/**
+ * Same as the four functions above, using the buffers of the given workspace.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinOSA(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinOSA(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace);
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerau(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinDamerau(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace);
+
+/**
+ * Precomputed query for computing the Levenshtein distances of one
+ * sequence of Ts to many other sequences.
+ * 
+ * See the class definition below for the available methods.
+ */
+template<typename T>
+class LevenshteinMatcher;
+
+/**
+ * A candidate sequence, identified by its position in the input,
+ * and its distance to the query.
+ */
+struct LevenshteinMatch {
+  std::size_t index;
+  std::size_t distance;
+};
+
+/**
+ * Find the k elements of [first, last) that are closest to query, among
+ * those with a distance of at most maxDist. The result is sorted by
+ * distance; candidates with the same distance are ordered by index, and
+ * earlier ones are preferred when there are more than k.
+ * 
+ * The elements of [first, last) and the query need to fulfill the same
+ * requirements as the arguments to levenshtein(const Container1&,
+ * const Container2&).
+ * 
+ * The distance of the current k-th best candidate is used as a bound for
+ * the remaining ones, which are skipped without computing their distance
+ * if their lengths (or, for integral element types, the numbers of
+ * occurrences of their elements) already differ too much from the query.
+ */
+template<typename Container, typename InputIterator>
+std::vector<LevenshteinMatch> levenshteinTopK(const Container& query,
+  InputIterator first, InputIterator last, std::size_t k,
+  std::size_t maxDist = std::numeric_limits<std::size_t>::max());
+
+/**
+ * Same as above, for any container of candidates supporting std::begin()
+ * and std::end().
+ */
+template<typename Container, typename Candidates>
+std::vector<LevenshteinMatch> levenshteinTopK(const Container& query,
+  const Candidates& candidates, std::size_t k,
+  std::size_t maxDist = std::numeric_limits<std::size_t>::max());
+
+/**
+ * An occurrence of a pattern in a text: text[start, end) has a
+ * Levenshtein distance of distance to the pattern.
+ */
+struct LevenshteinOccurrence {
+  std::size_t start;
+  std::size_t end;
+  std::size_t distance;
+};
+
+/**
+ * Search [text, textEnd) for approximate occurrences of
+ * [pattern, patternEnd), i.e. substrings with a Levenshtein distance of at
+ * most maxDist to it. For each end position e (0 <= e <= len(text)) at which
+ * such an occurrence ends, i.e. text[s, e) is one for some s, the result
+ * contains {e, the smallest distance of such an occurrence}, in order.
+ * The same requirements as for levenshtein() apply to the iterators.
+ *
+ * Uses the bit-parallel algorithm if both sequences have the same integral
+ * element type, and the SIMD variants of the diagonal algorithm otherwise.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinMatch> levenshteinSearch(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist);
+
+/**
+ * Same as above, for two containers.
+ * The same requirements as for levenshtein(a, b) apply to them.
+ */
+template<typename Container1, typename Container2>
+std::vector<LevenshteinMatch> levenshteinSearch(const Container1& pattern,
+  const Container2& text, std::size_t maxDist);
+
+/**
+ * Same as levenshteinSearch(), also finding where the occurrences start:
+ * For each end position e, start is the smallest s for which text[s, e)
+ * has the smallest distance to the pattern, i.e. the longest of the best
+ * occurrences ending at e is reported.
+ *
+ * This takes O(len(pattern) * (len(pattern) + maxDist)) additional time
+ * per end position.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(Iterator1 pattern,
+  Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd, std::size_t maxDist);
+
+/**
+ * Same as above, for two containers.
+ */
+template<typename Container1, typename Container2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(const Container1& pattern,
+  const Container2& text, std::size_t maxDist);
+
+/**
+ * Same as the four functions above, using the buffers of the given workspace.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinMatch> levenshteinSearch(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist, LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+std::vector<LevenshteinMatch> levenshteinSearch(const Container1& pattern,
+  const Container2& text, std::size_t maxDist, LevenshteinWorkspace& workspace);
+
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(Iterator1 pattern,
+  Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd, std::size_t maxDist,
+  LevenshteinWorkspace& workspace);
+
+template<typename Container1, typename Container2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(const Container1& pattern,
+  const Container2& text, std::size_t maxDist, LevenshteinWorkspace& workspace);
+
+/**
+ * Index of a fixed set of terms, for finding all terms within a given
+ * distance of a query without comparing the query to each of them.
+ * The index is stored in one flat buffer, which can be written to a file
+ * and memory-mapped later.
+ * 
+ * See the class definition below for the available methods.
+ */
+template<typename T>
+class LevenshteinIndex;
+
+/**
+ * Trie of a fixed set of terms, for finding all terms within a small
+ * distance of a query. Prefixes shared by several terms are only compared
+ * to the query once.
+ * 
+ * See the class definition below for the available methods.
+ */
+template<typename T>
+class LevenshteinTrie;
+
+/**
+ * Levenshtein distance of a fixed sequence of Ts and one that is passed
+ * in chunk by chunk, e.g. as it is read from a file or a socket, without
+ * keeping the chunks around.
+ * 
+ * See the class definition below for the available methods.
+ */
+template<typename T>
+class LevenshteinStream;
+
+/**
+ * Levenshtein distance of a fixed reference and a document that is
+ * edited over time, updated without starting over after each edit.
+ * 
+ * See the class definition below for the available methods.
+ */
+template<typename T>
+class LevenshteinIncremental;
+
+/**
+ * Compute the Levenshtein distances of many pairs of sequences.
+ * Each element of [first, last) needs to provide the two sequences as
+ * .first and .second (e.g. std::pair), which in turn need to fulfill the
+ * same requirements as the arguments to levenshtein(const Container1&,
+ * const Container2&). The distances are written to out, in order.
+ * 
+ * For short sequences of 1, 2 or 4-byte integral types, multiple pairs
+ * are processed at once using SIMD instructions, one pair per vector lane.
+ * 
+ * Returns the output iterator past the last written element.
+ */
+template<typename InputIterator, typename OutputIterator>
+OutputIterator levenshteinBatch(InputIterator first, InputIterator last, OutputIterator out);
+
+/**
+ * Same as above, for any container of pairs supporting std::begin()
+ * and std::end().
+ */
+template<typename Pairs, typename OutputIterator>
+OutputIterator levenshteinBatch(const Pairs& pairs, OutputIterator out);
+
+/**
+ * Same as the two levenshteinBatch() overloads above, using the buffers
+ * of the given workspace. The functions above use
+ * LevenshteinWorkspace::threadLocal().
+ */
+template<typename InputIterator, typename OutputIterator>
+OutputIterator levenshteinBatch(InputIterator first, InputIterator last, OutputIterator out,
+  LevenshteinWorkspace& workspace);
+
+template<typename Pairs, typename OutputIterator>
+OutputIterator levenshteinBatch(const Pairs& pairs, OutputIterator out,
+  LevenshteinWorkspace& workspace);
+
+/**
+ * Compute the Levenshtein distances of all pairs of sequences in
+ * [first, last), using multiple threads. The sequences need to fulfill
+ * the same requirements as the arguments to levenshtein(const Container1&,
+ * const Container2&).
+ * 
+ * The result is the upper triangle of the n x n distance matrix, row by
+ * row, i.e. the distance of the i-th and the j-th sequence (i < j) is
+ * written to out[i * (2n - i - 1) / 2 + j - i - 1]. out needs to be a
+ * random access iterator, e.g. a pointer to a buffer of n * (n - 1) / 2
+ * elements, since the distances are not computed in order.
+ * 
+ * policy.threads is the number of threads, including the calling one
+ * (0 means std::thread::hardware_concurrency()), and policy.blockSize the
+ * edge length of the blocks of pairs that are handed out to the threads
+ * (0 means picking one based on n and the thread count). policy.tileSize
+ * is not used.
+ * 
+ * Returns the output iterator past the last element of the triangle.
+ */
+template<typename RandomAccessIterator, typename OutputIterator>
+OutputIterator levenshteinMatrix(RandomAccessIterator first, RandomAccessIterator last,
+  OutputIterator out, ParallelPolicy policy = ParallelPolicy());
+
+/**
+ * Same as above, for any random access container of sequences
+ * supporting std::begin() and std::end().
+ */
+template<typename Sequences, typename OutputIterator>
+OutputIterator levenshteinMatrix(const Sequences& sequences, OutputIterator out,
+  ParallelPolicy policy = ParallelPolicy());
+
+/**
+ * Only implementation-specific stuff below
+ */
+
+/**
+ * C++ STL allocator returning aligned memory with additional memory
+ * on both sides to safely allow garbage reads/writes
+ * 
+ * based on https://stackoverflow.com/a/8545389/688904
+ */
+template <typename T, std::size_t N = 16>
+class AlignmentAllocator;
+
+#ifdef LSTSSE_SSE2
+template <typename T, std::size_t N>
+class AlignmentAllocator {
+public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  typedef T* pointer;
+  typedef const T* const_pointer;
+
+  typedef T& reference;
+  typedef const T& const_reference;
+
+  constexpr inline AlignmentAllocator () noexcept { }
+
+  template <typename T2>
+  constexpr inline AlignmentAllocator (const AlignmentAllocator<T2, N> &) noexcept { }
+
+  inline ~AlignmentAllocator () noexcept { }
+
+  inline pointer address (reference r) {
+    return &r;
+  }
+
+  inline const_pointer address (const_reference r) const {
+    return &r;
+  }
+
+  inline pointer allocate (size_type n) {
+    // this allocator is special in that it leaves 4*N bytes before and after
+    // the allocated area for garbage reads/writes
+    return reinterpret_cast<pointer>(reinterpret_cast<char*>(_mm_malloc(n * sizeof(value_type) + 8 * N, N)) + 4*N);
+  }
+
+  inline void deallocate (pointer p, size_type) {
+    _mm_free(reinterpret_cast<char*>(p) - 4*N);
+  }
+
+  inline void construct (pointer p, const value_type& value) {
+     new (p) value_type (value);
+  }
+
+  inline void destroy (pointer p) {
+    p->~value_type ();
+  }
+
+  constexpr inline size_type max_size () const noexcept {
+    return size_type (-1) / sizeof (value_type);
+  }
+
+  template <typename T2>
+  struct rebind {
+    typedef AlignmentAllocator<T2, N> other;
+  };
+
+  constexpr bool operator!=(const AlignmentAllocator<T,N>& other) const  {
+    return !(*this == other);
+  }
+
+  // Returns true if and only if storage allocated from *this
+  // can be deallocated from other, and vice versa.
+  // Always returns true for stateless allocators.
+  constexpr bool operator==(const AlignmentAllocator<T,N>& other) const {
+    return other.usesMMAlloc;
+  }
+  
+  static constexpr bool usesMMAlloc = true;
+};
+#endif
+
+template <typename T>
+class AlignmentAllocator<T, 1> : public std::allocator<T> {
+public:
+  static constexpr bool usesMMAlloc = false;
+};
+
+#ifdef LSTSSE_SSSE3
+constexpr std::size_t alignment = 16;
+#else
+#warning "No SIMD extensions enabled"
+constexpr std::size_t alignment = 1;
+#endif
+
+/**
+ * Instruction set levels. The tags form a hierarchy so that overloads
+ * for lower levels are picked when there is none for the exact level.
+ */
+enum CpuLevel {
+  cpuScalar,
+  cpuSSE2,
+  cpuSSSE3,
+  cpuSSE41,
+  cpuAVX2,
+  cpuAVX512
+};
+
+struct IsaScalar {};
+struct IsaSSE2 : IsaScalar {};
+struct IsaSSSE3 : IsaSSE2 {};
+struct IsaSSE41 : IsaSSSE3 {};
+struct IsaAVX2 : IsaSSE41 {};
+struct IsaAVX512 : IsaAVX2 {};
+
+#ifdef LSTSSE_RUNTIME_DISPATCH
+inline CpuLevel detectCpuLevel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    return cpuAVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return cpuAVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return cpuSSE41;
+  if (__builtin_cpu_supports("ssse3"))
+    return cpuSSSE3;
+  if (__builtin_cpu_supports("sse2"))
+    return cpuSSE2;
+  return cpuScalar;
+}
+
+/**
+ * The level of the current CPU, detected on first use.
+ */
+inline CpuLevel cpuLevel() {
+  static const CpuLevel level = detectCpuLevel();
+  return level;
+}
+#else
+/**
+ * The level enabled at compile time.
+ */
+constexpr inline CpuLevel cpuLevel() {
+#if defined(LSTSSE_AVX512BW)
+  return cpuAVX512;
+#elif defined(LSTSSE_AVX2)
+  return cpuAVX2;
+#elif defined(LSTSSE_SSE4_1)
+  return cpuSSE41;
+#elif defined(LSTSSE_SSSE3)
+  return cpuSSSE3;
+#elif defined(LSTSSE_SSE2)
+  return cpuSSE2;
+#else
+  return cpuScalar;
+#endif
+}
+#endif // LSTSSE_RUNTIME_DISPATCH
+
+/**
+ * Some notes on the algorithm used here:
+ * 
+ * The standard Levenshtein metric is usually calculated using the
+ * Wagner–Fischer algorithm [1]. This essentially means calculating
+ * Levenshtein(a[:n], b[:m]) for all prefixes a[:n] and b[:m] of a and b,
+ * storing the results in a table (and possibly “forgetting”
+ * the previous rows to save memory). Normally, this is performed
+ * row by row, but this approach has the disadvantage that it is not
+ * easily converted to using SIMD instructions.
+ * 
+ * The “diagonal” algorithm variants in this file calculate the minor
+ * diagonals one by one. There, the index `i` always corresponds to the
+ * table row in which we currently are and `j` always denotes the column. 
+ * Note that the tables have a trivial i=0 row and j=0 column; The
+ * table entry [i,j] corresponds to the comparison a[i-1] == b[j-1].
+ * A diagonal is defined by its index `k`, yielding the inner loop invariant
+ * k == i + j.
+ * 
+ * The outer loop iterates over all diagonals from k = 0 to
+ * k = len(a)+len(b) (compare with the table in [1] to verify), meaning
+ * that the length of the diagonals may vary between iterations.
+ * The current diagonal and the previous diagonal are kept in memory,
+ * referred to as diag and diag2 respectively.
+ * 
+ * In the inner loop, the rows are treated in descending order,
+ * i.e. `i` decreases from iteration to iteration, to avoid overwriting
+ * data needed in the next iteration.
+ * 
+ * [1]: https://en.wikipedia.org/wiki/Wagner%E2%80%93Fischer_algorithm
+ */
+
+/**
+ * Whether x and y are equal. Integral elements of different types are
+ * compared in their common type, like the built-in comparison does, but
+ * without a signedness warning for e.g. char and char32_t.
+ */
+template<typename T1, typename T2>
+inline bool levenshteinElementsEqual(const T1& x, const T2& y, std::true_type /* integral */) {
+  typedef typename std::common_type<T1, T2>::type C;
+  return static_cast<C>(x) == static_cast<C>(y);
+}
+
+template<typename T1, typename T2>
+inline bool levenshteinElementsEqual(const T1& x, const T2& y, std::false_type) {
+  return x == y;
+}
+
+template<typename T1, typename T2>
+inline bool levenshteinElementsEqual(const T1& x, const T2& y) {
+  return levenshteinElementsEqual(x, y,
+    std::integral_constant<bool, std::is_integral<T1>::value && std::is_integral<T2>::value>());
+}
+
+/**
+ * Trivial implementation of one inner loop iteration.
+ * 
+ * Note that i is passed as a reference; The SIMD version may decrease it
+ * by more than 1.
+ */
+template<typename Vec1, typename Vec2, typename Iterator1, typename Iterator2>
+struct LevenshteinIterationBase {
+static inline void perform(const Iterator1& a, const Iterator2& b,
+  std::size_t& i, std::size_t j, std::size_t bLen, Vec1& diag, const Vec2& diag2)
+{
+  std::uint32_t min = std::min(diag2[i], diag2[i-1]);
+  if (min < diag[i-1]) {
+    diag[i] = min + 1;
+  }
+  else {
+    diag[i] = diag[i-1] + !levenshteinElementsEqual(a[i-1], b[j-1]);
+  }
+  --i;
+}
+};
+
+/**
+ * Start SIMD-Land
+ * 
+ * Currently, only SSSE3+ is supported, since we use
+ * _mm_shuffle_epi8 and _mm_alignr_epi8.
+ * 
+ * If you are not familiar with SSE and/or the intrinsics,
+ * you can just believe me that they do about the same thing
+ * as LevenshteinIterationBase::perform.
+ */
+
+#ifdef LSTSSE_SSE4_1
+LSTSSE_TARGET("sse4.1")
+inline __m128i min_epi32(__m128i a, __m128i b) {
+  return _mm_min_epi32(a, b);
+}
+#elif defined(LSTSSE_SSSE3)
+// straightforward _mm_min_epi32 polyfill using only SSE2
+inline __m128i min_epi32(__m128i a, __m128i b) {
+  __m128i compare = _mm_cmpgt_epi32(a, b);
+  __m128i aIsSmaller = _mm_andnot_si128(compare, a);
+  __m128i bIsSmaller = _mm_and_si128   (compare, b);
+  return _mm_or_si128(aIsSmaller, bIsSmaller);
+}
+#endif // LSTSSE_SSE4_1
+
+#ifdef LSTSSE_AVX2
+// provide an AVX2 version of _mm256_alignr_epi32(a, b, 7)
+// (i.e. move a one epi32 to the left and write the highest
+// bytes of b to the lowest of a)
+#ifndef __AVX512VL__
+LSTSSE_TARGET("avx2")
+inline __m256i _mm256_alignr_epi32_7(__m256i a, __m256i b) {
+  const __m256i rotl1_256_epi32 = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+  __m256i combined = _mm256_blend_epi32(a, b, 0x80);
+  return _mm256_permutevar8x32_epi32(combined, rotl1_256_epi32);
+}
+#else
+LSTSSE_TARGET("avx2")
+inline __m256i _mm256_alignr_epi32_7(__m256i a, __m256i b) {
+  return _mm256_alignr_epi32(a, b, 7);
+}
+#endif // __AVX512VL__
+#endif // LSTSSE_AVX2
+
+template<typename T>
+struct LevenshteinIterationSIMD {
+/* Decide which implementation is acceptable */
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2, IsaScalar)
+{
+  LevenshteinIterationBase<std::uint32_t*, const std::uint32_t*, const T*, const T*>
+    ::perform(a, b, i, j, bLen, diag, diag2);
+}
+
+#ifdef LSTSSE_SSSE3
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2, IsaSSSE3)
+{
+  if (i >= 16 && bLen - j >= 16) {
+    performSSE(a, b, i, j, bLen, diag, diag2);
+    return;
+  }
+
+  performSIMD(a, b, i, j, bLen, diag, diag2, IsaScalar());
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2, IsaAVX2)
+{
+  if (i >= 32 && bLen - j >= 32) {
+    performSSE_AVX2(a, b, i, j, bLen, diag, diag2);
+    return;
+  }
+
+  performSIMD(a, b, i, j, bLen, diag, diag2, IsaSSE41());
+}
+#endif
+
+#ifdef LSTSSE_AVX512BW
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2, IsaAVX512)
+{
+  // The AVX-512 version uses masked loads and stores, so it can
+  // handle diagonal edges itself.
+  performAVX512(a, b, i, j, bLen, diag, diag2);
+}
+#endif
+
+#ifdef LSTSSE_SSSE3
+LSTSSE_TARGET("sse4.1")
+static inline void performSSE(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2)
+{
+  const __m128i one128_epi32 = _mm_set1_epi32(1);
+  const __m128i reversedIdentity128_epi8 = _mm_setr_epi8(
+    15, 14, 13, 12,
+    11, 10,  9,  8,
+     7,  6,  5,  4,
+     3,  2,  1,  0
+  );
+  const __m128i reversedIdentity128_epi16 = _mm_setr_epi8(
+    14, 15, 12, 13,
+    10, 11,  8,  9,
+     6,  7,  4,  5,
+     2,  3,  0,  1
+  );
+  const __m128i blockwiseReversed128_epi8_4 = _mm_setr_epi8(
+     3,  2,  1,  0,
+     7,  6,  5,  4,
+    11, 10,  9,  8,
+    15, 14, 13, 12
+  );
+  const __m128i blockwiseReversed128_epi16_4 = _mm_setr_epi8(
+     6,  7,  4,  5,
+     2,  3,  0,  1,
+    14, 15, 12, 13,
+    10, 11,  8,  9
+  );
+
+  __m128i substitutionCost32[4];
+  std::size_t k;
+  
+  // We support 1, 2, and 4 byte objects for SSE comparison.
+  // We always process 16 entries at once, so we may need multiple fetches
+  // depending on object size.
+  if (sizeof(T) <= 2) {
+    __m128i substitutionCost16LX, substitutionCost16HX;
+    
+    if (sizeof(T) == 1) {
+      __m128i a_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-16]));
+      __m128i b_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-1]));
+      a_ = _mm_shuffle_epi8(a_, reversedIdentity128_epi8);
+      
+      // int substitutionCost = a[i-1] == b[j-1] ? -1 : 0;
+      
+      // diag/diag2 will contain the following entries from the diagonal:
+      // index  [0]0 [0]1 [0]2 [0]3 [1]0 [1]1 [1]2 [1]3 ... [4]0 [4]1 [4]2 [4]3
+      // diag+i   -3   -2   -1    0   -7   -6   -5   -4 ...  -19  -18  -17  -16
+      
+      // substitutionCost8 contains the comparisons for the following indices in a and b:
+      // index  0   1   2   3   4   5   6   7   8   9  10  11  12  13  14  15
+      // a+i   -1  -2  -3  -4  -5  -6  -7  -8  -9 -10 -11 -12 -13 -14 -15 -16
+      // b+j   -1   0   1   2   3   4   5   6   7   8   9  10  11  12  13  14
+      // in substitutionCost8X we shuffle this so that it matches up with diag/diag2
+      // (barring the offset induces by comparing i-1 against j-1)
+      __m128i substitutionCost8 = _mm_cmpeq_epi8(a_, b_);
+      __m128i substitutionCost8X = _mm_shuffle_epi8(substitutionCost8, blockwiseReversed128_epi8_4);
+      // unpack with self so that 00 -> 00 00 and ff -> ff ff
+      substitutionCost16LX = _mm_unpacklo_epi8(substitutionCost8X, substitutionCost8X);
+      substitutionCost16HX = _mm_unpackhi_epi8(substitutionCost8X, substitutionCost8X);
+    } else {
+      __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-8]));
+      __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-16]));
+      __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-1]));
+      __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j+7]));
+      a0 = _mm_shuffle_epi8(a0, reversedIdentity128_epi16);
+      a1 = _mm_shuffle_epi8(a1, reversedIdentity128_epi16);
+      __m128i substitutionCost16L = _mm_cmpeq_epi16(a0, b0);
+      __m128i substitutionCost16H = _mm_cmpeq_epi16(a1, b1);
+      substitutionCost16LX = _mm_shuffle_epi8(substitutionCost16L, blockwiseReversed128_epi16_4);
+      substitutionCost16HX = _mm_shuffle_epi8(substitutionCost16H, blockwiseReversed128_epi16_4);
+    }
+    
+    substitutionCost32[0] = _mm_unpacklo_epi16(substitutionCost16LX, substitutionCost16LX);
+    substitutionCost32[1] = _mm_unpackhi_epi16(substitutionCost16LX, substitutionCost16LX);
+    substitutionCost32[2] = _mm_unpacklo_epi16(substitutionCost16HX, substitutionCost16HX);
+    substitutionCost32[3] = _mm_unpackhi_epi16(substitutionCost16HX, substitutionCost16HX);
+  } else {
+    assert(sizeof(T) == 4);
+    
+    for (k = 0; k < 4; ++k) {
+      __m128i a_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-4-k*4]));
+      __m128i b_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-1+k*4]));
+      b_ = _mm_shuffle_epi32(b_, 0x1b); // simple reverse
+      substitutionCost32[k] = _mm_cmpeq_epi32(a_, b_);
+    }
+  }
+  
+  __m128i diag_[5], diag2_[5];
+  for (k = 0; k < 5; ++k) {
+    diag_ [k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag [i-3-k*4]));
+  }
+  for (k = 0; k < 5; ++k) {
+    diag2_[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag2[i-3-k*4]));
+  }
+  
+  // There’s a ton of debug stuff down here. You can use it for reference
+  // or, of course, compile with -DLSTSSE_DEBUG if you’re feeling funny.
+#ifdef LSTSSE_DEBUG
+  for (k = 0; k < 5; ++k) {
+    std::uint32_t diag0 = _mm_extract_epi32(diag_[k], 0);
+    std::uint32_t diag1 = _mm_extract_epi32(diag_[k], 1);
+    std::uint32_t diag2 = _mm_extract_epi32(diag_[k], 2);
+    std::uint32_t diag3 = _mm_extract_epi32(diag_[k], 3);
+    assert(diag0 == diag[i-k*4-3]);
+    assert(diag1 == diag[i-k*4-2]);
+    assert(diag2 == diag[i-k*4-1]);
+    assert(diag3 == diag[i-k*4-0]);
+  }
+  for (k = 0; k < 5; ++k) {
+    std::uint32_t diag20 = _mm_extract_epi32(diag2_[k], 0);
+    std::uint32_t diag21 = _mm_extract_epi32(diag2_[k], 1);
+    std::uint32_t diag22 = _mm_extract_epi32(diag2_[k], 2);
+    std::uint32_t diag23 = _mm_extract_epi32(diag2_[k], 3);
+    assert(diag20 == diag2[i-k*4-3]);
+    assert(diag21 == diag2[i-k*4-2]);
+    assert(diag22 == diag2[i-k*4-1]);
+    assert(diag23 == diag2[i-k*4-0]);
+  }
+  
+  for (k = 0; k < 4; ++k) {
+    int sc0 = _mm_extract_epi32(substitutionCost32[k], 0);
+    int sc1 = _mm_extract_epi32(substitutionCost32[k], 1);
+    int sc2 = _mm_extract_epi32(substitutionCost32[k], 2);
+    int sc3 = _mm_extract_epi32(substitutionCost32[k], 3);
+    assert(sc0 == ((a[i-1-k*4-3] == b[j-1+k*4+3]) ? -1 : 0));
+    assert(sc1 == ((a[i-1-k*4-2] == b[j-1+k*4+2]) ? -1 : 0));
+    assert(sc2 == ((a[i-1-k*4-1] == b[j-1+k*4+1]) ? -1 : 0));
+    assert(sc3 == ((a[i-1-k*4-0] == b[j-1+k*4+0]) ? -1 : 0));
+  }
+#endif // LSTSSE_DEBUG
+
+  // reminders:
+  // the arrays (diag, diag2, substitutionCost32) correspond to i:
+  // index  [0]0 [0]1 [0]2 [0]3 [1]0 [1]1 [1]2 [1]3 ... [4]0 [4]1 [4]2 [4]3
+  // i+       -3   -2   -1    0   -7   -6   -5   -4 ...  -19  -18  -17  -16
+  // so when we need to access ...[i-1], we need to align the entries
+  // in *reverse* order
+  
+  // diag[i] = min(
+  //  diag2[i-1],
+  //  diag2[i],
+  //  diag[i-1] + substitutionCost
+  // ) + 1;
+  // 
+  for (k = 0; k < 4; ++k) {
+    __m128i diag2_i_m1 = _mm_alignr_epi8(diag2_[k], diag2_[k+1], 12);
+    __m128i diag_i_m1  = _mm_alignr_epi8(diag_ [k], diag_ [k+1], 12);
+    
+    __m128i result3 = _mm_add_epi32(diag_i_m1,  substitutionCost32[k]);
+    __m128i min = min_epi32(min_epi32(diag2_i_m1, diag2_[k]), result3);
+    min = _mm_add_epi32(min, one128_epi32);
+    
+#ifdef LSTSSE_DEBUG
+    std::uint32_t diag_i_m10 = _mm_extract_epi32(diag_i_m1, 0);
+    std::uint32_t diag_i_m11 = _mm_extract_epi32(diag_i_m1, 1);
+    std::uint32_t diag_i_m12 = _mm_extract_epi32(diag_i_m1, 2);
+    std::uint32_t diag_i_m13 = _mm_extract_epi32(diag_i_m1, 3);
+    assert(diag_i_m10 == diag[i-k*4-4]);
+    assert(diag_i_m11 == diag[i-k*4-3]);
+    assert(diag_i_m12 == diag[i-k*4-2]);
+    assert(diag_i_m13 == diag[i-k*4-1]);
+    
+    std::uint32_t diag2_i_m10 = _mm_extract_epi32(diag2_i_m1, 0);
+    std::uint32_t diag2_i_m11 = _mm_extract_epi32(diag2_i_m1, 1);
+    std::uint32_t diag2_i_m12 = _mm_extract_epi32(diag2_i_m1, 2);
+    std::uint32_t diag2_i_m13 = _mm_extract_epi32(diag2_i_m1, 3);
+    assert(diag2_i_m10 == diag2[i-k*4-4]);
+    assert(diag2_i_m11 == diag2[i-k*4-3]);
+    assert(diag2_i_m12 == diag2[i-k*4-2]);
+    assert(diag2_i_m13 == diag2[i-k*4-1]);
+    
+    std::uint32_t result30 = _mm_extract_epi32(result3, 0);
+    std::uint32_t result31 = _mm_extract_epi32(result3, 1);
+    std::uint32_t result32 = _mm_extract_epi32(result3, 2);
+    std::uint32_t result33 = _mm_extract_epi32(result3, 3);
+    
+    assert(result30 == diag[i-1-k*4-3] + ((a[i-1-k*4-3] == b[j-1+k*4+3]) ? -1 : 0));
+    assert(result31 == diag[i-1-k*4-2] + ((a[i-1-k*4-2] == b[j-1+k*4+2]) ? -1 : 0));
+    assert(result32 == diag[i-1-k*4-1] + ((a[i-1-k*4-1] == b[j-1+k*4+1]) ? -1 : 0));
+    assert(result33 == diag[i-1-k*4-0] + ((a[i-1-k*4-0] == b[j-1+k*4+0]) ? -1 : 0));
+#endif // LSTSSE_DEBUG
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&diag[i-k*4-3]), min);
+  }
+  
+  // We just handled 16 entries at once. Yay!
+  i -= 16;
+}
+#endif // LSTSSE_SSSE3
+
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2")
+static inline void performSSE_AVX2(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2)
+{
+  const __m256i one256_epi32 = _mm256_set1_epi32(1);
+  const __m256i reversedIdentity256_epi8 = _mm256_setr_epi8(
+    15, 14, 13, 12,
+    11, 10,  9,  8,
+     7,  6,  5,  4,
+     3,  2,  1,  0,
+    15, 14, 13, 12,
+    11, 10,  9,  8,
+     7,  6,  5,  4,
+     3,  2,  1,  0
+  );
+
+  const __m256i blockwiseReversed256_epi8_8 = _mm256_setr_epi8(
+     7,  6,  5,  4,
+     3,  2,  1,  0,
+    15, 14, 13, 12,
+    11, 10,  9,  8,
+     7,  6,  5,  4,
+     3,  2,  1,  0,
+    15, 14, 13, 12,
+    11, 10,  9,  8
+  );
+
+  const __m256i blockwiseReversed256_epi16_8 = _mm256_setr_epi8(
+    14, 15, 12, 13,
+    10, 11,  8,  9,
+     6,  7,  4,  5,
+     2,  3,  0,  1,
+    14, 15, 12, 13,
+    10, 11,  8,  9,
+     6,  7,  4,  5,
+     2,  3,  0,  1
+  );
+
+  __m256i substitutionCost32[4];
+  std::size_t k;
+
+  if (sizeof(T) <= 2) {
+    if (sizeof(T) == 1) {
+      __m256i a_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-32]));
+      __m256i b_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j-1]));
+      a_ = _mm256_shuffle_epi8(a_, reversedIdentity256_epi8);
+      a_ = _mm256_permute2x128_si256(a_, a_, 1); // swap hi/lo
+
+      __m256i substitutionCost8 = _mm256_cmpeq_epi8(a_, b_);
+      __m256i substitutionCost8X = _mm256_shuffle_epi8(substitutionCost8, blockwiseReversed256_epi8_8);
+      __m128i sc8Xlo  = _mm256_extracti128_si256(substitutionCost8X, 0);
+      __m128i sc8Xhi  = _mm256_extracti128_si256(substitutionCost8X, 1);
+      substitutionCost32[0] = _mm256_cvtepi8_epi32(sc8Xlo);
+      substitutionCost32[1] = _mm256_cvtepi8_epi32(_mm_srli_si128(sc8Xlo, 8));
+      substitutionCost32[2] = _mm256_cvtepi8_epi32(sc8Xhi);
+      substitutionCost32[3] = _mm256_cvtepi8_epi32(_mm_srli_si128(sc8Xhi, 8));
+    } else {
+      __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-16]));
+      __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-32]));
+      __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j-1]));
+      __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j+15]));
+      a0 = _mm256_permute2x128_si256(a0, a0, 1); // swap hi/lo
+      a1 = _mm256_permute2x128_si256(a1, a1, 1); // swap hi/lo
+      b0 = _mm256_shuffle_epi8(b0, blockwiseReversed256_epi16_8);
+      b1 = _mm256_shuffle_epi8(b1, blockwiseReversed256_epi16_8);
+      __m256i substitutionCost16L = _mm256_cmpeq_epi16(a0, b0);
+      __m256i substitutionCost16H = _mm256_cmpeq_epi16(a1, b1);
+      __m128i sc16Llo = _mm256_extracti128_si256(substitutionCost16L, 0);
+      __m128i sc16Lhi = _mm256_extracti128_si256(substitutionCost16L, 1);
+      __m128i sc16Hlo = _mm256_extracti128_si256(substitutionCost16H, 0);
+      __m128i sc16Hhi = _mm256_extracti128_si256(substitutionCost16H, 1);
+      substitutionCost32[0] = _mm256_cvtepi16_epi32(sc16Llo);
+      substitutionCost32[1] = _mm256_cvtepi16_epi32(sc16Lhi);
+      substitutionCost32[2] = _mm256_cvtepi16_epi32(sc16Hlo);
+      substitutionCost32[3] = _mm256_cvtepi16_epi32(sc16Hhi);
+    }
+  } else {
+    assert(sizeof(T) == 4);
+
+    for (k = 0; k < 4; ++k) {
+      __m256i a_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-8-k*8]));
+      __m256i b_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j-1+k*8]));
+      b_ = _mm256_shuffle_epi32(b_, 0x1b); // simple reverse
+      b_ = _mm256_permute2x128_si256(b_, b_, 1); // swap hi/lo
+      substitutionCost32[k] = _mm256_cmpeq_epi32(a_, b_);
+    }
+  }
+
+  __m256i diag_[5], diag2_[5];
+  for (k = 0; k < 5; ++k) {
+    diag_ [k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag [i-7-k*8]));
+  }
+  for (k = 0; k < 5; ++k) {
+    diag2_[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag2[i-7-k*8]));
+  }
+
+#ifdef LSTSSE_DEBUG
+  for (k = 0; k < 5; ++k) {
+    std::uint32_t diag0 = _mm256_extract_epi32(diag_[k], 0);
+    std::uint32_t diag1 = _mm256_extract_epi32(diag_[k], 1);
+    std::uint32_t diag2 = _mm256_extract_epi32(diag_[k], 2);
+    std::uint32_t diag3 = _mm256_extract_epi32(diag_[k], 3);
+    std::uint32_t diag4 = _mm256_extract_epi32(diag_[k], 4);
+    std::uint32_t diag5 = _mm256_extract_epi32(diag_[k], 5);
+    std::uint32_t diag6 = _mm256_extract_epi32(diag_[k], 6);
+    std::uint32_t diag7 = _mm256_extract_epi32(diag_[k], 7);
+    assert(diag0 == diag[i-k*8-7]);
+    assert(diag1 == diag[i-k*8-6]);
+    assert(diag2 == diag[i-k*8-5]);
+    assert(diag3 == diag[i-k*8-4]);
+    assert(diag4 == diag[i-k*8-3]);
+    assert(diag5 == diag[i-k*8-2]);
+    assert(diag6 == diag[i-k*8-1]);
+    assert(diag7 == diag[i-k*8-0]);
+  }
+  for (k = 0; k < 5; ++k) {
+    std::uint32_t diag20 = _mm256_extract_epi32(diag2_[k], 0);
+    std::uint32_t diag21 = _mm256_extract_epi32(diag2_[k], 1);
+    std::uint32_t diag22 = _mm256_extract_epi32(diag2_[k], 2);
+    std::uint32_t diag23 = _mm256_extract_epi32(diag2_[k], 3);
+    std::uint32_t diag24 = _mm256_extract_epi32(diag2_[k], 4);
+    std::uint32_t diag25 = _mm256_extract_epi32(diag2_[k], 5);
+    std::uint32_t diag26 = _mm256_extract_epi32(diag2_[k], 6);
+    std::uint32_t diag27 = _mm256_extract_epi32(diag2_[k], 7);
+    assert(diag20 == diag2[i-k*8-7]);
+    assert(diag21 == diag2[i-k*8-6]);
+    assert(diag22 == diag2[i-k*8-5]);
+    assert(diag23 == diag2[i-k*8-4]);
+    assert(diag24 == diag2[i-k*8-3]);
+    assert(diag25 == diag2[i-k*8-2]);
+    assert(diag26 == diag2[i-k*8-1]);
+    assert(diag27 == diag2[i-k*8-0]);
+  }
+  
+  for (k = 0; k < 4; ++k) {
+    int sc0 = _mm256_extract_epi32(substitutionCost32[k], 0);
+    int sc1 = _mm256_extract_epi32(substitutionCost32[k], 1);
+    int sc2 = _mm256_extract_epi32(substitutionCost32[k], 2);
+    int sc3 = _mm256_extract_epi32(substitutionCost32[k], 3);
+    int sc4 = _mm256_extract_epi32(substitutionCost32[k], 4);
+    int sc5 = _mm256_extract_epi32(substitutionCost32[k], 5);
+    int sc6 = _mm256_extract_epi32(substitutionCost32[k], 6);
+    int sc7 = _mm256_extract_epi32(substitutionCost32[k], 7);
+    assert(sc0 == ((a[i-1-k*8-7] == b[j-1+k*8+7]) ? -1 : 0));
+    assert(sc1 == ((a[i-1-k*8-6] == b[j-1+k*8+6]) ? -1 : 0));
+    assert(sc2 == ((a[i-1-k*8-5] == b[j-1+k*8+5]) ? -1 : 0));
+    assert(sc3 == ((a[i-1-k*8-4] == b[j-1+k*8+4]) ? -1 : 0));
+    assert(sc4 == ((a[i-1-k*8-3] == b[j-1+k*8+3]) ? -1 : 0));
+    assert(sc5 == ((a[i-1-k*8-2] == b[j-1+k*8+2]) ? -1 : 0));
+    assert(sc6 == ((a[i-1-k*8-1] == b[j-1+k*8+1]) ? -1 : 0));
+    assert(sc7 == ((a[i-1-k*8-0] == b[j-1+k*8+0]) ? -1 : 0));
+  }
+#endif // LSTSSE_DEBUG
+
+  for (k = 0; k < 4; ++k) {
+    __m256i diag2_i_m1 = _mm256_alignr_epi32_7(diag2_[k], diag2_[k+1]);
+    __m256i diag_i_m1  = _mm256_alignr_epi32_7(diag_ [k], diag_ [k+1]);
+
+    __m256i result3 = _mm256_add_epi32(diag_i_m1,  substitutionCost32[k]);
+    __m256i min = _mm256_min_epi32(_mm256_min_epi32(diag2_i_m1, diag2_[k]), result3);
+    min = _mm256_add_epi32(min, one256_epi32);
+
+#ifdef LSTSSE_DEBUG
+    std::uint32_t diag_i_m10 = _mm256_extract_epi32(diag_i_m1, 0);
+    std::uint32_t diag_i_m11 = _mm256_extract_epi32(diag_i_m1, 1);
+    std::uint32_t diag_i_m12 = _mm256_extract_epi32(diag_i_m1, 2);
+    std::uint32_t diag_i_m13 = _mm256_extract_epi32(diag_i_m1, 3);
+    std::uint32_t diag_i_m14 = _mm256_extract_epi32(diag_i_m1, 4);
+    std::uint32_t diag_i_m15 = _mm256_extract_epi32(diag_i_m1, 5);
+    std::uint32_t diag_i_m16 = _mm256_extract_epi32(diag_i_m1, 6);
+    std::uint32_t diag_i_m17 = _mm256_extract_epi32(diag_i_m1, 7);
+    assert(diag_i_m10 == diag[i-k*8-8]);
+    assert(diag_i_m11 == diag[i-k*8-7]);
+    assert(diag_i_m12 == diag[i-k*8-6]);
+    assert(diag_i_m13 == diag[i-k*8-5]);
+    assert(diag_i_m14 == diag[i-k*8-4]);
+    assert(diag_i_m15 == diag[i-k*8-3]);
+    assert(diag_i_m16 == diag[i-k*8-2]);
+    assert(diag_i_m17 == diag[i-k*8-1]);
+    
+    std::uint32_t diag2_i_m10 = _mm256_extract_epi32(diag2_i_m1, 0);
+    std::uint32_t diag2_i_m11 = _mm256_extract_epi32(diag2_i_m1, 1);
+    std::uint32_t diag2_i_m12 = _mm256_extract_epi32(diag2_i_m1, 2);
+    std::uint32_t diag2_i_m13 = _mm256_extract_epi32(diag2_i_m1, 3);
+    std::uint32_t diag2_i_m14 = _mm256_extract_epi32(diag2_i_m1, 4);
+    std::uint32_t diag2_i_m15 = _mm256_extract_epi32(diag2_i_m1, 5);
+    std::uint32_t diag2_i_m16 = _mm256_extract_epi32(diag2_i_m1, 6);
+    std::uint32_t diag2_i_m17 = _mm256_extract_epi32(diag2_i_m1, 7);
+    assert(diag2_i_m10 == diag2[i-k*8-8]);
+    assert(diag2_i_m11 == diag2[i-k*8-7]);
+    assert(diag2_i_m12 == diag2[i-k*8-6]);
+    assert(diag2_i_m13 == diag2[i-k*8-5]);
+    assert(diag2_i_m14 == diag2[i-k*8-4]);
+    assert(diag2_i_m15 == diag2[i-k*8-3]);
+    assert(diag2_i_m16 == diag2[i-k*8-2]);
+    assert(diag2_i_m17 == diag2[i-k*8-1]);
+    
+    std::uint32_t result30 = _mm256_extract_epi32(result3, 0);
+    std::uint32_t result31 = _mm256_extract_epi32(result3, 1);
+    std::uint32_t result32 = _mm256_extract_epi32(result3, 2);
+    std::uint32_t result33 = _mm256_extract_epi32(result3, 3);
+    std::uint32_t result34 = _mm256_extract_epi32(result3, 4);
+    std::uint32_t result35 = _mm256_extract_epi32(result3, 5);
+    std::uint32_t result36 = _mm256_extract_epi32(result3, 6);
+    std::uint32_t result37 = _mm256_extract_epi32(result3, 7);
+    
+    assert(result30 == diag[i-1-k*8-7] + ((a[i-1-k*8-7] == b[j-1+k*8+7]) ? -1 : 0));
+    assert(result31 == diag[i-1-k*8-6] + ((a[i-1-k*8-6] == b[j-1+k*8+6]) ? -1 : 0));
+    assert(result32 == diag[i-1-k*8-5] + ((a[i-1-k*8-5] == b[j-1+k*8+5]) ? -1 : 0));
+    assert(result33 == diag[i-1-k*8-4] + ((a[i-1-k*8-4] == b[j-1+k*8+4]) ? -1 : 0));
+    assert(result34 == diag[i-1-k*8-3] + ((a[i-1-k*8-3] == b[j-1+k*8+3]) ? -1 : 0));
+    assert(result35 == diag[i-1-k*8-2] + ((a[i-1-k*8-2] == b[j-1+k*8+2]) ? -1 : 0));
+    assert(result36 == diag[i-1-k*8-1] + ((a[i-1-k*8-1] == b[j-1+k*8+1]) ? -1 : 0));
+    assert(result37 == diag[i-1-k*8-0] + ((a[i-1-k*8-0] == b[j-1+k*8+0]) ? -1 : 0));
+#endif // LSTSSE_DEBUG
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&diag[i-k*8-7]), min);
+  }
+
+  // We just handled 32 entries at once. Yay!
+  i -= 32;
+}
+#endif // LSTSSE_AVX2
+
+#ifdef LSTSSE_AVX512BW
+#if defined(__GNUC__) && !defined(__clang__)
+// Older GCC versions warn about the _mm512_undefined_epi32() used
+// internally by a number of AVX-512 intrinsics.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+/**
+ * Handles up to 64 entries, namely rows i-n+1 .. i, where
+ * n = min(64, i, bLen - j + 1) is the number of entries left on
+ * the current diagonal (or 64, if there are more).
+ *
+ * Unlike the SSE and AVX2 versions above, this one reverses b instead
+ * of a, and keeps the comparison results in a mask register:
+ * bit p of `equal` corresponds to row i-63+p, i.e. a[i-64+p] == b[j+62-p].
+ * Loads and stores are masked so that only the rows i-n .. i
+ * are touched.
+ */
+LSTSSE_TARGET("avx512f,avx512bw")
+static inline void performAVX512(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2)
+{
+  const __m512i one512_epi32 = _mm512_set1_epi32(1);
+  const std::size_t n = std::min<std::size_t>(std::min<std::size_t>(64, i), bLen - j + 1);
+  assert(n > 0);
+
+  // lowest n bits (for b) and highest n bits (for a) set
+  const __mmask64 loN = n == 64 ? ~__mmask64(0) : (__mmask64(1) << n) - 1;
+  const __mmask64 hiN = n == 64 ? ~__mmask64(0) : ~((~__mmask64(0)) >> n);
+  __mmask64 equal;
+  std::size_t k;
+
+  if (sizeof(T) == 1) {
+    const __m512i reversed512_epi8 = _mm512_set_epi64(
+      0x0001020304050607, 0x08090a0b0c0d0e0f,
+      0x0001020304050607, 0x08090a0b0c0d0e0f,
+      0x0001020304050607, 0x08090a0b0c0d0e0f,
+      0x0001020304050607, 0x08090a0b0c0d0e0f);
+    __m512i a_ = _mm512_maskz_loadu_epi8(hiN, &a[i-64]);
+    __m512i b_ = _mm512_maskz_loadu_epi8(loN, &b[j-1]);
+    b_ = _mm512_shuffle_epi8(b_, reversed512_epi8);
+    b_ = _mm512_shuffle_i64x2(b_, b_, 0x1b);
+    equal = _mm512_cmpeq_epi8_mask(a_, b_);
+  } else if (sizeof(T) == 2) {
+    const __m512i reversed512_epi16 = _mm512_set_epi64(
+      0x0000000100020003, 0x0004000500060007,
+      0x00080009000a000b, 0x000c000d000e000f,
+      0x0010001100120013, 0x0014001500160017,
+      0x00180019001a001b, 0x001c001d001e001f);
+    __m512i a0 = _mm512_maskz_loadu_epi16(__mmask32(hiN), &a[i-64]);
+    __m512i a1 = _mm512_maskz_loadu_epi16(__mmask32(hiN >> 32), &a[i-32]);
+    __m512i b0 = _mm512_maskz_loadu_epi16(__mmask32(loN >> 32), &b[j+31]);
+    __m512i b1 = _mm512_maskz_loadu_epi16(__mmask32(loN), &b[j-1]);
+    b0 = _mm512_permutexvar_epi16(reversed512_epi16, b0);
+    b1 = _mm512_permutexvar_epi16(reversed512_epi16, b1);
+    equal = __mmask64(_mm512_cmpeq_epi16_mask(a0, b0)) |
+      (__mmask64(_mm512_cmpeq_epi16_mask(a1, b1)) << 32);
+  } else {
+    assert(sizeof(T) == 4);
+    const __m512i reversed512_epi32 = _mm512_set_epi32(
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    equal = 0;
+    for (k = 0; k < 4; ++k) {
+      __m512i a_ = _mm512_maskz_loadu_epi32(__mmask16(hiN >> (k*16)), &a[i-64+k*16]);
+      __m512i b_ = _mm512_maskz_loadu_epi32(__mmask16(loN >> (48-k*16)), &b[j+47-k*16]);
+      b_ = _mm512_permutexvar_epi32(reversed512_epi32, b_);
+      equal |= __mmask64(_mm512_cmpeq_epi32_mask(a_, b_)) << (k*16);
+    }
+  }
+
+  // diag_[k] and diag2_[k] hold the rows i-15-k*16 .. i-k*16;
+  // only rows i-n .. i are loaded.
+  __m512i diag_[5], diag2_[5];
+  for (k = 0; k < 5; ++k) {
+    const std::size_t lowest = 15 + k*16;
+    const __mmask16 load = lowest < n ? 0xffff :
+      lowest - n < 16 ? __mmask16(0xffff << (lowest - n)) : 0;
+    diag_ [k] = _mm512_maskz_loadu_epi32(load, &diag [i-lowest]);
+    diag2_[k] = _mm512_maskz_loadu_epi32(load, &diag2[i-lowest]);
+  }
+
+  // diag[i] = min(
+  //  diag2[i-1],
+  //  diag2[i],
+  //  diag[i-1] + substitutionCost
+  // ) + 1;
+  for (k = 0; k < 4; ++k) {
+    const __mmask16 equal16 = __mmask16(equal >> (48 - k*16));
+    const __mmask16 store = __mmask16(hiN >> (48 - k*16));
+    if (!store) {
+      break;
+    }
+
+    __m512i diag2_i_m1 = _mm512_alignr_epi32(diag2_[k], diag2_[k+1], 15);
+    __m512i diag_i_m1  = _mm512_alignr_epi32(diag_ [k], diag_ [k+1], 15);
+
+    __m512i result3 = _mm512_mask_sub_epi32(diag_i_m1, equal16, diag_i_m1, one512_epi32);
+    __m512i min = _mm512_min_epi32(_mm512_min_epi32(diag2_i_m1, diag2_[k]), result3);
+    min = _mm512_add_epi32(min, one512_epi32);
+
+    _mm512_mask_storeu_epi32(&diag[i-k*16-15], store, min);
+  }
+
+  i -= n;
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif // LSTSSE_AVX512BW
+
+};
+
+/**
+ * Narrow cells
+ *
+ * When all entries of the table fit into 16 or 8 bits, the diagonals
+ * are stored with std::uint16_t or std::uint8_t entries, so that each
+ * vector holds two or four times as many of them.
+ *
+ * These kernels handle Ops::lanes rows at once, namely i-lanes+1 .. i.
+ * Instead of shifting the loaded diagonals by one entry, diag[i-1] and
+ * diag2[i-1] are just loaded from an offset address. All arithmetic is
+ * unsigned and saturating, so there is no need for the temporary -1
+ * used by the 32-bit kernels:
+ *
+ * diag[i] = min(
+ *  min(diag2[i-1], diag2[i]) + 1,
+ *  diag[i-1] + (a[i-1] != b[j-1])
+ * );
+ *
+ * Each Ops provides mismatch<T>(a, b), which returns 1 in lane l if
+ * a[l] != b[lanes-1-l] and 0 otherwise (i.e. b is read backwards,
+ * just like the table is traversed along a minor diagonal), and
+ * step<T>(), which computes the rows themselves.
+ */
+
+#ifdef LSTSSE_SSE4_1
+template<typename Cell>
+struct LevenshteinNarrowSSE {
+  typedef __m128i Vec;
+  static constexpr std::size_t lanes = sizeof(Vec) / sizeof(Cell);
+
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec load(const Cell* p) {
+    return _mm_loadu_si128(reinterpret_cast<const Vec*>(p));
+  }
+
+  LSTSSE_TARGET("sse4.1")
+  static inline void store(Cell* p, Vec v) {
+    _mm_storeu_si128(reinterpret_cast<Vec*>(p), v);
+  }
+
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec one() {
+    return sizeof(Cell) == 1 ? _mm_set1_epi8(1) : _mm_set1_epi16(1);
+  }
+
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec min(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm_min_epu8(a, b) : _mm_min_epu16(a, b);
+  }
+
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec adds(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm_adds_epu8(a, b) : _mm_adds_epu16(a, b);
+  }
+
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec sub(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm_sub_epi8(a, b) : _mm_sub_epi16(a, b);
+  }
+
+  // Compare 16 / sizeof(T) elements: a[l] == bEnd[-1-l]
+  template<typename T>
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec equal(const T* a, const T* bEnd) {
+    const std::size_t n = sizeof(Vec) / sizeof(T);
+    const __m128i reversed128_epi8 = _mm_setr_epi8(
+      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i reversed128_epi16 = _mm_setr_epi8(
+      14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    __m128i a_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    __m128i b_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bEnd - n));
+    if (sizeof(T) == 1) {
+      return _mm_cmpeq_epi8(a_, _mm_shuffle_epi8(b_, reversed128_epi8));
+    } else if (sizeof(T) == 2) {
+      return _mm_cmpeq_epi16(a_, _mm_shuffle_epi8(b_, reversed128_epi16));
+    } else {
+      return _mm_cmpeq_epi32(a_, _mm_shuffle_epi32(b_, 0x1b));
+    }
+  }
+
+  template<typename T>
+  LSTSSE_TARGET("sse4.1")
+  static inline Vec mismatch(const T* a, const T* b) {
+    const std::size_t n = sizeof(Vec) / sizeof(T);
+    const T* bEnd = b + lanes;
+    __m128i equal8or16;
+
+    if (sizeof(T) == sizeof(Cell)) {
+      equal8or16 = equal(a, bEnd);
+    } else if (sizeof(T) < sizeof(Cell)) {
+      // 8 bytes -> 8 x 16 bit
+      const __m128i reversed64_epi8 = _mm_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, -1, -1, -1, -1, -1, -1, -1, -1);
+      __m128i a_ = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a));
+      __m128i b_ = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bEnd - 8));
+      b_ = _mm_shuffle_epi8(b_, reversed64_epi8);
+      equal8or16 = _mm_cvtepi8_epi16(_mm_cmpeq_epi8(a_, b_));
+    } else if (sizeof(T) == 2 * sizeof(Cell)) {
+      __m128i e0 = equal(a, bEnd);
+      __m128i e1 = equal(a + n, bEnd - n);
+      equal8or16 = sizeof(Cell) == 1 ? _mm_packs_epi16(e0, e1) : _mm_packs_epi32(e0, e1);
+    } else {
+      assert(sizeof(T) == 4 && sizeof(Cell) == 1);
+      __m128i e0 = equal(a, bEnd);
+      __m128i e1 = equal(a + n, bEnd - n);
+      __m128i e2 = equal(a + 2*n, bEnd - 2*n);
+      __m128i e3 = equal(a + 3*n, bEnd - 3*n);
+      equal8or16 = _mm_packs_epi16(_mm_packs_epi32(e0, e1), _mm_packs_epi32(e2, e3));
+    }
+
+    return _mm_andnot_si128(equal8or16, one());
+  }
+
+  // rows i-lanes+1 .. i of the diagonal, see above
+  template<typename T>
+  LSTSSE_TARGET("sse4.1")
+  static inline void step(const T* a, const T* b, std::size_t i, std::size_t j,
+    Cell* diag, const Cell* diag2) {
+    const Vec substitutionCost = mismatch(&a[i-lanes], &b[j-1]);
+    const Vec diag2Min = min(load(&diag2[i-lanes]), load(&diag2[i-lanes+1]));
+    const Vec result3 = adds(load(&diag[i-lanes]), substitutionCost);
+    store(&diag[i-lanes+1], min(adds(diag2Min, one()), result3));
+  }
+
+  // the same with transpositions, see levenshteinOSARows()
+  template<typename T>
+  LSTSSE_TARGET("sse4.1")
+  static inline void stepOSA(const T* a, const T* b, std::size_t i, std::size_t j,
+    const Cell* diag, const Cell* diag2, Cell* diag4) {
+    const Vec substitutionCost = mismatch(&a[i-lanes], &b[j-1]);
+    const Vec diag2Min = min(load(&diag2[i-lanes]), load(&diag2[i-lanes+1]));
+    const Vec result3 = adds(load(&diag[i-lanes]), substitutionCost);
+    // all ones where a[i-1] != b[j-2] or a[i-2] != b[j-1]
+    const Vec noTransposition = sub(_mm_setzero_si128(),
+      _mm_or_si128(mismatch(&a[i-lanes], &b[j-2]), mismatch(&a[i-lanes-1], &b[j-1])));
+    const Vec result4 = _mm_or_si128(adds(load(&diag4[i-lanes-1]), one()), noTransposition);
+    store(&diag4[i-lanes+1], min(min(adds(diag2Min, one()), result3), result4));
+  }
+
+  // Damerau–Levenshtein transpositions of the same rows, after stepOSA(),
+  // see levenshteinDamerauRows(); the state pointers point to lane 0,
+  // i.e. to the entries for row i-lanes+1 and column j+lanes-1
+  template<typename T>
+  LSTSSE_TARGET("sse4.1")
+  static inline void stepDamerau(const T* a, const T* b, std::size_t i, std::size_t j,
+    const Cell* diag3, Cell* diag4, Cell* lastRow, Cell* fromRow, Cell* lastColumn,
+    Cell* fromColumn) {
+    const Vec zero = _mm_setzero_si128();
+    const Vec row = sizeof(Cell) == 1 ?
+      _mm_add_epi8(_mm_set1_epi8(char(i-lanes+1)),
+        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)) :
+      _mm_add_epi16(_mm_set1_epi16(short(i-lanes+1)), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+    const Vec column = sizeof(Cell) == 1 ?
+      _mm_sub_epi8(_mm_set1_epi8(char(j+lanes-1)),
+        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)) :
+      _mm_sub_epi16(_mm_set1_epi16(short(j+lanes-1)), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+    const Vec lastRow_ = load(lastRow);
+    const Vec fromRow_ = load(fromRow);
+    const Vec lastColumn_ = load(lastColumn);
+    const Vec fromColumn_ = load(fromColumn);
+
+    // all ones where a[i-1] != b[j-2] and a[i-2] != b[j-1] respectively;
+    // without a match so far, from* saturate
+    const Vec transposition1 = _mm_or_si128(adds(fromRow_, sub(row, lastRow_)),
+      sub(zero, mismatch(&a[i-lanes], &b[j-2])));
+    const Vec transposition2 = _mm_or_si128(adds(fromColumn_, sub(column, lastColumn_)),
+      sub(zero, mismatch(&a[i-lanes-1], &b[j-1])));
+    store(&diag4[i-lanes+1], min(load(&diag4[i-lanes+1]), min(transposition1, transposition2)));
+
+    // all ones where a[i-1] == b[j-1]
+    const Vec match = sub(mismatch(&a[i-lanes], &b[j-1]), one());
+    store(lastRow, _mm_blendv_epi8(lastRow_, row, match));
+    store(fromRow, _mm_blendv_epi8(fromRow_, load(&diag3[i-lanes]), match));
+    store(lastColumn, _mm_blendv_epi8(lastColumn_, column, match));
+    store(fromColumn, _mm_blendv_epi8(fromColumn_, load(&diag3[i-lanes-1]), match));
+  }
+};
+#endif // LSTSSE_SSE4_1
+
+#ifdef LSTSSE_AVX2
+template<typename Cell>
+struct LevenshteinNarrowAVX2 {
+  typedef __m256i Vec;
+  static constexpr std::size_t lanes = sizeof(Vec) / sizeof(Cell);
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec load(const Cell* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const Vec*>(p));
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline void store(Cell* p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<Vec*>(p), v);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec one() {
+    return sizeof(Cell) == 1 ? _mm256_set1_epi8(1) : _mm256_set1_epi16(1);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec min(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm256_min_epu8(a, b) : _mm256_min_epu16(a, b);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec adds(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm256_adds_epu8(a, b) : _mm256_adds_epu16(a, b);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec sub(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm256_sub_epi8(a, b) : _mm256_sub_epi16(a, b);
+  }
+
+  // Compare 32 / sizeof(T) elements: a[l] == bEnd[-1-l]
+  template<typename T>
+  LSTSSE_TARGET("avx2")
+  static inline Vec equal(const T* a, const T* bEnd) {
+    const std::size_t n = sizeof(Vec) / sizeof(T);
+    const __m256i reversed256_epi8 = _mm256_setr_epi8(
+      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i reversed256_epi16 = _mm256_setr_epi8(
+      14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+      14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    __m256i a_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i b_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bEnd - n));
+    if (sizeof(T) == 1) {
+      b_ = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b_, reversed256_epi8), 0x4e);
+      return _mm256_cmpeq_epi8(a_, b_);
+    } else if (sizeof(T) == 2) {
+      b_ = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b_, reversed256_epi16), 0x4e);
+      return _mm256_cmpeq_epi16(a_, b_);
+    } else {
+      b_ = _mm256_permutevar8x32_epi32(b_, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+      return _mm256_cmpeq_epi32(a_, b_);
+    }
+  }
+
+  template<typename T>
+  LSTSSE_TARGET("avx2")
+  static inline Vec mismatch(const T* a, const T* b) {
+    const std::size_t n = sizeof(Vec) / sizeof(T);
+    const T* bEnd = b + lanes;
+    __m256i equal8or16;
+
+    if (sizeof(T) == sizeof(Cell)) {
+      equal8or16 = equal(a, bEnd);
+    } else if (sizeof(T) < sizeof(Cell)) {
+      // 16 bytes -> 16 x 16 bit
+      const __m128i reversed128_epi8 = _mm_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+      __m128i a_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+      __m128i b_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bEnd - 16));
+      b_ = _mm_shuffle_epi8(b_, reversed128_epi8);
+      equal8or16 = _mm256_cvtepi8_epi16(_mm_cmpeq_epi8(a_, b_));
+    } else if (sizeof(T) == 2 * sizeof(Cell)) {
+      // packs works on 128-bit halves, so restore the order afterwards
+      __m256i e0 = equal(a, bEnd);
+      __m256i e1 = equal(a + n, bEnd - n);
+      equal8or16 = sizeof(Cell) == 1 ? _mm256_packs_epi16(e0, e1) : _mm256_packs_epi32(e0, e1);
+      equal8or16 = _mm256_permute4x64_epi64(equal8or16, 0xd8);
+    } else {
+      assert(sizeof(T) == 4 && sizeof(Cell) == 1);
+      __m256i e0 = equal(a, bEnd);
+      __m256i e1 = equal(a + n, bEnd - n);
+      __m256i e2 = equal(a + 2*n, bEnd - 2*n);
+      __m256i e3 = equal(a + 3*n, bEnd - 3*n);
+      equal8or16 = _mm256_packs_epi16(_mm256_packs_epi32(e0, e1), _mm256_packs_epi32(e2, e3));
+      equal8or16 = _mm256_permutevar8x32_epi32(equal8or16, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+
+    return _mm256_andnot_si256(equal8or16, one());
+  }
+
+  // rows i-lanes+1 .. i of the diagonal, see above
+  template<typename T>
+  LSTSSE_TARGET("avx2")
+  static inline void step(const T* a, const T* b, std::size_t i, std::size_t j,
+    Cell* diag, const Cell* diag2) {
+    const Vec substitutionCost = mismatch(&a[i-lanes], &b[j-1]);
+    const Vec diag2Min = min(load(&diag2[i-lanes]), load(&diag2[i-lanes+1]));
+    const Vec result3 = adds(load(&diag[i-lanes]), substitutionCost);
+    store(&diag[i-lanes+1], min(adds(diag2Min, one()), result3));
+  }
+
+  // the same with transpositions, see levenshteinOSARows()
+  template<typename T>
+  LSTSSE_TARGET("avx2")
+  static inline void stepOSA(const T* a, const T* b, std::size_t i, std::size_t j,
+    const Cell* diag, const Cell* diag2, Cell* diag4) {
+    const Vec substitutionCost = mismatch(&a[i-lanes], &b[j-1]);
+    const Vec diag2Min = min(load(&diag2[i-lanes]), load(&diag2[i-lanes+1]));
+    const Vec result3 = adds(load(&diag[i-lanes]), substitutionCost);
+    // all ones where a[i-1] != b[j-2] or a[i-2] != b[j-1]
+    const Vec noTransposition = sub(_mm256_setzero_si256(),
+      _mm256_or_si256(mismatch(&a[i-lanes], &b[j-2]), mismatch(&a[i-lanes-1], &b[j-1])));
+    const Vec result4 = _mm256_or_si256(adds(load(&diag4[i-lanes-1]), one()), noTransposition);
+    store(&diag4[i-lanes+1], min(min(adds(diag2Min, one()), result3), result4));
+  }
+
+  // see LevenshteinNarrowSSE::stepDamerau()
+  template<typename T>
+  LSTSSE_TARGET("avx2")
+  static inline void stepDamerau(const T* a, const T* b, std::size_t i, std::size_t j,
+    const Cell* diag3, Cell* diag4, Cell* lastRow, Cell* fromRow, Cell* lastColumn,
+    Cell* fromColumn) {
+    const Vec zero = _mm256_setzero_si256();
+    const Vec lane = sizeof(Cell) == 1 ?
+      _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31) :
+      _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const Vec row = sizeof(Cell) == 1 ?
+      _mm256_add_epi8(_mm256_set1_epi8(char(i-lanes+1)), lane) :
+      _mm256_add_epi16(_mm256_set1_epi16(short(i-lanes+1)), lane);
+    const Vec column = sizeof(Cell) == 1 ?
+      _mm256_sub_epi8(_mm256_set1_epi8(char(j+lanes-1)), lane) :
+      _mm256_sub_epi16(_mm256_set1_epi16(short(j+lanes-1)), lane);
+    const Vec lastRow_ = load(lastRow);
+    const Vec fromRow_ = load(fromRow);
+    const Vec lastColumn_ = load(lastColumn);
+    const Vec fromColumn_ = load(fromColumn);
+
+    const Vec transposition1 = _mm256_or_si256(adds(fromRow_, sub(row, lastRow_)),
+      sub(zero, mismatch(&a[i-lanes], &b[j-2])));
+    const Vec transposition2 = _mm256_or_si256(adds(fromColumn_, sub(column, lastColumn_)),
+      sub(zero, mismatch(&a[i-lanes-1], &b[j-1])));
+    store(&diag4[i-lanes+1], min(load(&diag4[i-lanes+1]), min(transposition1, transposition2)));
+
+    const Vec match = sub(mismatch(&a[i-lanes], &b[j-1]), one());
+    store(lastRow, _mm256_blendv_epi8(lastRow_, row, match));
+    store(fromRow, _mm256_blendv_epi8(fromRow_, load(&diag3[i-lanes]), match));
+    store(lastColumn, _mm256_blendv_epi8(lastColumn_, column, match));
+    store(fromColumn, _mm256_blendv_epi8(fromColumn_, load(&diag3[i-lanes-1]), match));
+  }
+};
+#endif // LSTSSE_AVX2
+
+#ifdef LSTSSE_AVX512BW
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+template<typename Cell>
+struct LevenshteinNarrowAVX512 {
+  typedef __m512i Vec;
+  static constexpr std::size_t lanes = sizeof(Vec) / sizeof(Cell);
+
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline Vec load(const Cell* p) {
+    return _mm512_loadu_si512(p);
+  }
+
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline void store(Cell* p, Vec v) {
+    _mm512_storeu_si512(p, v);
+  }
+
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline Vec one() {
+    return sizeof(Cell) == 1 ? _mm512_set1_epi8(1) : _mm512_set1_epi16(1);
+  }
+
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline Vec min(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm512_min_epu8(a, b) : _mm512_min_epu16(a, b);
+  }
+
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline Vec adds(Vec a, Vec b) {
+    return sizeof(Cell) == 1 ? _mm512_adds_epu8(a, b) : _mm512_adds_epu16(a, b);
+  }
+
+  // Compare the first `count` of 64 / sizeof(T) elements: a[l] == bEnd[-1-l];
+  // bit l of the result is set if they are equal.
+  template<typename T>
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline __mmask64 equal(const T* a, const T* bEnd, std::size_t count) {
+    const std::size_t n = sizeof(Vec) / sizeof(T);
+    // the `count` lowest elements of a and the `count` highest elements of bEnd - n
+    const __mmask64 lo = count == 64 ? ~__mmask64(0) : (__mmask64(1) << count) - 1;
+    const __mmask64 hi = lo << (n - count);
+    if (sizeof(T) == 1) {
+      const __m512i reversed512_epi8 = _mm512_set_epi64(
+        0x0001020304050607, 0x08090a0b0c0d0e0f,
+        0x0001020304050607, 0x08090a0b0c0d0e0f,
+        0x0001020304050607, 0x08090a0b0c0d0e0f,
+        0x0001020304050607, 0x08090a0b0c0d0e0f);
+      __m512i a_ = _mm512_maskz_loadu_epi8(lo, a);
+      __m512i b_ = _mm512_maskz_loadu_epi8(hi, bEnd - n);
+      b_ = _mm512_shuffle_i64x2(_mm512_shuffle_epi8(b_, reversed512_epi8),
+        _mm512_shuffle_epi8(b_, reversed512_epi8), 0x1b);
+      return _mm512_cmpeq_epi8_mask(a_, b_) & lo;
+    } else if (sizeof(T) == 2) {
+      const __m512i reversed512_epi16 = _mm512_set_epi64(
+        0x0000000100020003, 0x0004000500060007,
+        0x00080009000a000b, 0x000c000d000e000f,
+        0x0010001100120013, 0x0014001500160017,
+        0x00180019001a001b, 0x001c001d001e001f);
+      __m512i a_ = _mm512_maskz_loadu_epi16(__mmask32(lo), a);
+      __m512i b_ = _mm512_maskz_loadu_epi16(__mmask32(hi), bEnd - n);
+      b_ = _mm512_permutexvar_epi16(reversed512_epi16, b_);
+      return _mm512_cmpeq_epi16_mask(a_, b_) & lo;
+    } else {
+      const __m512i reversed512_epi32 = _mm512_set_epi32(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+      __m512i a_ = _mm512_maskz_loadu_epi32(__mmask16(lo), a);
+      __m512i b_ = _mm512_maskz_loadu_epi32(__mmask16(hi), bEnd - n);
+      b_ = _mm512_permutexvar_epi32(reversed512_epi32, b_);
+      return _mm512_cmpeq_epi32_mask(a_, b_) & lo;
+    }
+  }
+
+  template<typename T>
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline Vec mismatch(const T* a, const T* b) {
+    const std::size_t n = std::min(sizeof(Vec) / sizeof(T), lanes);
+    const T* bEnd = b + lanes;
+    __mmask64 equal64 = 0;
+
+    for (std::size_t k = 0; k < lanes / n; ++k) {
+      equal64 |= equal(a + k*n, bEnd - k*n, n) << (k*n);
+    }
+
+    return sizeof(Cell) == 1 ?
+      _mm512_maskz_mov_epi8(~equal64, one()) :
+      _mm512_maskz_mov_epi16(__mmask32(~equal64), one());
+  }
+
+  // rows i-lanes+1 .. i of the diagonal, see above
+  template<typename T>
+  LSTSSE_TARGET("avx512f,avx512bw")
+  static inline void step(const T* a, const T* b, std::size_t i, std::size_t j,
+    Cell* diag, const Cell* diag2) {
+    const Vec substitutionCost = mismatch(&a[i-lanes], &b[j-1]);
+    const Vec diag2Min = min(load(&diag2[i-lanes]), load(&diag2[i-lanes+1]));
+    const Vec result3 = adds(load(&diag[i-lanes]), substitutionCost);
+    store(&diag[i-lanes+1], min(adds(diag2Min, one()), result3));
+  }
+};
+
+// passed to std::min() by reference in mismatch()
+template<typename Cell>
+constexpr std::size_t LevenshteinNarrowAVX512<Cell>::lanes;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif // LSTSSE_AVX512BW
+
+template<typename T, typename Cell>
+struct LevenshteinIterationNarrow {
+/* Decide which implementation is acceptable */
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  Cell* diag, const Cell* diag2, IsaScalar)
+{
+  LevenshteinIterationBase<Cell*, const Cell*, const T*, const T*>
+    ::perform(a, b, i, j, bLen, diag, diag2);
+}
+
+#ifdef LSTSSE_SSE4_1
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  Cell* diag, const Cell* diag2, IsaSSE41)
+{
+  if (i >= LevenshteinNarrowSSE<Cell>::lanes && bLen - j >= LevenshteinNarrowSSE<Cell>::lanes) {
+    LevenshteinNarrowSSE<Cell>::step(a, b, i, j, diag, diag2);
+    i -= LevenshteinNarrowSSE<Cell>::lanes;
+    return;
+  }
+
+  performSIMD(a, b, i, j, bLen, diag, diag2, IsaScalar());
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  Cell* diag, const Cell* diag2, IsaAVX2)
+{
+  if (i >= LevenshteinNarrowAVX2<Cell>::lanes && bLen - j >= LevenshteinNarrowAVX2<Cell>::lanes) {
+    LevenshteinNarrowAVX2<Cell>::step(a, b, i, j, diag, diag2);
+    i -= LevenshteinNarrowAVX2<Cell>::lanes;
+    return;
+  }
+
+  performSIMD(a, b, i, j, bLen, diag, diag2, IsaSSE41());
+}
+#endif
+
+#ifdef LSTSSE_AVX512BW
+static inline void performSIMD(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  Cell* diag, const Cell* diag2, IsaAVX512)
+{
+  if (i >= LevenshteinNarrowAVX512<Cell>::lanes && bLen - j >= LevenshteinNarrowAVX512<Cell>::lanes) {
+    LevenshteinNarrowAVX512<Cell>::step(a, b, i, j, diag, diag2);
+    i -= LevenshteinNarrowAVX512<Cell>::lanes;
+    return;
+  }
+
+  performSIMD(a, b, i, j, bLen, diag, diag2, IsaAVX2());
+}
+#endif
+};
+
+/**
+ * Default: If we don’t know better, just use the trivial implementation.
+ * 
+ * This is overloaded in multiple places and is the struct whose `perform`
+ * method will ultimately be called from the outer loop.
+ * 
+ * Vec1 and Vec2 correspond to `diag` and `diag2`, respectively.
+ * Isa is one of the Isa* tags and names the instruction set that
+ * may be used.
+ */
+template<typename Vec1, typename Vec2, typename Iterator1, typename Iterator2, typename Isa>
+struct LevenshteinIteration : LevenshteinIterationBase<Vec1, Vec2, Iterator1, Iterator2> {
+};
+
+/**
+ * Use a wrapper to pass the element pointers on as pointers to const.
+ */
+template<typename T, typename Isa>
+struct LevenshteinIterationSIMDWrap : private LevenshteinIterationSIMD<T> {
+static inline void perform(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  std::uint32_t* diag, const std::uint32_t* diag2) {
+  return LevenshteinIterationSIMD<T>::performSIMD(a, b, i, j, bLen, diag, diag2, Isa());
+}
+};
+
+/**
+ * Use a wrapper to test whether we can use SSE instuctions.
+ * 
+ * T needs to be a scalar of size 1, 2 or 4.
+ */
+template<typename T, typename Isa>
+struct LevenshteinIteration<std::uint32_t*, std::uint32_t*, const T*, const T*, Isa>
+  : std::conditional<std::is_scalar<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4),
+    LevenshteinIterationSIMDWrap<T, Isa>,
+    LevenshteinIterationBase<std::uint32_t*, std::uint32_t*, const T*, const T*>
+  >::type
+{ };
+
+/**
+ * Always decay pointers to const.
+ */
+template<typename T, typename Isa>
+struct LevenshteinIteration<std::uint32_t*, std::uint32_t*, T*, T*, Isa>
+  : LevenshteinIteration<std::uint32_t*, std::uint32_t*, const T*, const T*, Isa>
+{ };
+
+/**
+ * Same for narrow cells.
+ */
+template<typename T, typename Cell, typename Isa>
+struct LevenshteinIterationNarrowWrap : private LevenshteinIterationNarrow<T, Cell> {
+static inline void perform(const T* a, const T* b,
+  std::size_t& i, std::size_t j, std::size_t bLen,
+  Cell* diag, const Cell* diag2) {
+  return LevenshteinIterationNarrow<T, Cell>::performSIMD(a, b, i, j, bLen, diag, diag2, Isa());
+}
+};
+
+template<typename T, typename Cell, typename Isa>
+struct LevenshteinIteration<Cell*, Cell*, const T*, const T*, Isa>
+  : std::conditional<std::is_scalar<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4) &&
+      (std::is_same<Cell, std::uint16_t>::value || std::is_same<Cell, std::uint8_t>::value),
+    LevenshteinIterationNarrowWrap<T, Cell, Isa>,
+    LevenshteinIterationBase<Cell*, Cell*, const T*, const T*>
+  >::type
+{ };
+
+template<typename T, typename Cell, typename Isa>
+struct LevenshteinIteration<Cell*, Cell*, T*, T*, Isa>
+  : LevenshteinIteration<Cell*, Cell*, const T*, const T*, Isa>
+{ };
+
+/**
+ * Largest number of rows that one LevenshteinIteration<..., Isa>::perform()
+ * call handles with cells of the given size: the 32-bit kernels process
+ * 16, 32 or 64 rows, the narrow ones one vector of cells.
+ */
+constexpr std::size_t levenshteinKernelRows(std::size_t, IsaScalar) {
+  return 1;
+}
+
+constexpr std::size_t levenshteinKernelRows(std::size_t cellSize, IsaSSSE3) {
+  return cellSize == 4 ? 16 : 16 / cellSize;
+}
+
+constexpr std::size_t levenshteinKernelRows(std::size_t cellSize, IsaAVX2) {
+  return cellSize == 4 ? 32 : 32 / cellSize;
+}
+
+constexpr std::size_t levenshteinKernelRows(std::size_t cellSize, IsaAVX512) {
+  return cellSize == 4 ? 64 : 64 / cellSize;
+}
+
+/**
+ * All rows of one diagonal, from endRow down to startRow.
+ *
+ * This is the unit that gets compiled once per instruction set;
+ * select() picks the best variant for the current CPU, and the
+ * outer loops call it through a function pointer. If `banded` is set,
+ * the SIMD variants are only used while enough rows are left.
+ */
+template<typename Vec1, typename Vec2, typename Iterator1, typename Iterator2, bool banded>
+struct LevenshteinDiagonalStep {
+typedef void (*Function)(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2);
+
+template<typename Isa>
+static inline void run(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2) {
+  const std::size_t rows =
+    levenshteinKernelRows(sizeof(typename std::remove_pointer<Vec1>::type), Isa());
+
+  for (std::size_t i = endRow; i >= startRow; ) {
+    assert(i < k);
+    const std::size_t j = k - i;
+
+    // The SIMD variants may handle up to `rows` rows at once, so only use
+    // them if the band is actually wide enough.
+    if (!banded || i - startRow + 1 >= rows) {
+      LevenshteinIteration<Vec1, Vec2, Iterator1, Iterator2, Isa>
+        ::perform(a, b, i, j, bLen, diag, diag2);
+    } else {
+      LevenshteinIterationBase<Vec1, Vec2, Iterator1, Iterator2>
+        ::perform(a, b, i, j, bLen, diag, diag2);
+    }
+  }
+}
+
+static void runScalar(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2) {
+  run<IsaScalar>(a, b, startRow, endRow, k, bLen, diag, diag2);
+}
+
+#if defined(LSTSSE_SSSE3) && !defined(LSTSSE_SSE4_1)
+static void runSSSE3(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2) {
+  run<IsaSSSE3>(a, b, startRow, endRow, k, bLen, diag, diag2);
+}
+#endif
+
+#ifdef LSTSSE_SSE4_1
+LSTSSE_TARGET("sse4.1") LSTSSE_FLATTEN
+static void runSSE41(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2) {
+  run<IsaSSE41>(a, b, startRow, endRow, k, bLen, diag, diag2);
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2") LSTSSE_FLATTEN
+static void runAVX2(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2) {
+  run<IsaAVX2>(a, b, startRow, endRow, k, bLen, diag, diag2);
+}
+#endif
+
+#ifdef LSTSSE_AVX512BW
+LSTSSE_TARGET("avx2,avx512f,avx512bw") LSTSSE_FLATTEN
+static void runAVX512(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, std::size_t bLen, Vec1& diag, const Vec2& diag2) {
+  run<IsaAVX512>(a, b, startRow, endRow, k, bLen, diag, diag2);
+}
+#endif
+
+static Function select() {
+#ifdef LSTSSE_AVX512BW
+  if (cpuLevel() >= cpuAVX512)
+    return &runAVX512;
+#endif
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return &runAVX2;
+#endif
+#ifdef LSTSSE_SSE4_1
+  if (cpuLevel() >= cpuSSE41)
+    return &runSSE41;
+#elif defined(LSTSSE_SSSE3)
+  if (cpuLevel() >= cpuSSSE3)
+    return &runSSSE3;
+#endif
+  return &runScalar;
+}
+};
+
+/**
+ * Outer loop of the diagonal algorithm variant.
+ *
+ * diag and diag2 are scratch buffers with room for len(a) + 1 entries
+ * each (see LevenshteinWorkspace::buffer()); their contents do not
+ * matter, since every entry is written before it is read.
+ */
+template<typename T, typename Iterator1, typename Iterator2>
+T levenshteinDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  T* diag, T* diag2) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+  
+  assert(0 < aLen);
+  assert(aLen <= bLen);
+  
+  diag2[0] = 0;
+  
+  const typename LevenshteinDiagonalStep<T*, T*, Iterator1, Iterator2, false>::Function step =
+    LevenshteinDiagonalStep<T*, T*, Iterator1, Iterator2, false>::select();
+  
+  std::size_t k;
+  
+  k = 0;
+  for (k = 1; ; ++k) {
+    assert(k <= aLen + bLen);
+    
+    std::size_t startRow = k > bLen ? k - bLen : 1;
+    std::size_t endRow = k > aLen ? aLen : k - 1;
+    
+    assert(endRow >= startRow || k == 1);
+    
+    step(a, b, startRow, endRow, k, bLen, diag, diag2);
+    
+    diag[0] = k;
+    
+    if (k <= aLen) {
+      diag[k] = k;
+    }
+    
+    if (k == aLen + bLen) {
+      assert(startRow == endRow);
+      return diag[startRow];
+    }
+    
+    // switch buffers
+    std::swap(diag, diag2);
+  }
+  
+  assert(0);
+}
+
+// Extra rows kept below the band in levenshteinDiagonalBounded(), so that
+// the SIMD variants (which handle up to 64 rows at once) can still be used
+// near the lower edge of the window.
+constexpr std::size_t levenshteinBandMargin = 64;
+static_assert(levenshteinBandMargin >= levenshteinKernelRows(4, IsaAVX512()) &&
+  levenshteinBandMargin >= levenshteinKernelRows(1, IsaAVX512()),
+  "levenshteinBandMargin needs to cover the widest kernel");
+
+/**
+ * Number of entries of diag and diag2 used by levenshteinDiagonalBounded():
+ * twice the rows that are needed on any diagonal, or len(a) + 1 if that
+ * is less.
+ */
+inline std::size_t levenshteinBandCapacity(std::size_t aLen, std::size_t bLen,
+  std::size_t maxDist) {
+  const std::size_t lenDiff = bLen - aLen;
+  const std::size_t slack = (maxDist - lenDiff) / 2;
+  const std::size_t rows = slack + lenDiff / 2 + 4 + levenshteinBandMargin;
+  return std::min(aLen + 1, 2 * rows);
+}
+
+/**
+ * Outer loop of the diagonal algorithm variant, restricted to
+ * results <= maxDist.
+ *
+ * Any path through the table that visits [i,j] costs at least
+ * |j - i| + |(len(b) - len(a)) - (j - i)|, so only the entries whose
+ * offset j - i lies in [-slack, len(b) - len(a) + slack] can be part of
+ * a result <= maxDist (Ukkonen’s band). On each diagonal, these are
+ * the rows between ceil((k - len(b) + len(a) - slack) / 2) and
+ * floor((k + slack) / 2).
+ *
+ * All entries outside the band are treated as maxDist + 1; the entries
+ * directly next to the band are set to that value after each diagonal
+ * so that no outdated values from earlier diagonals are picked up.
+ * Once all entries of two consecutive diagonals exceed maxDist,
+ * so will all further ones.
+ *
+ * Only a window of rows around the band is stored: diag[i - offset] holds
+ * row i. The band moves down by half a row per diagonal, and once it
+ * reaches the end of the window, the window is moved down to the band
+ * (copying the rows that are still needed to the front), so the buffers
+ * stay small enough to remain in the L1 cache. The inner loops do not
+ * know about the window; they are just passed a + offset and row and
+ * diagonal numbers relative to offset.
+ *
+ * diag and diag2 are scratch buffers with room for
+ * levenshteinBandCapacity() entries each.
+ */
+template<typename T, typename Iterator1, typename Iterator2>
+T levenshteinDiagonalBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, T* diag, T* diag2) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+
+  assert(0 < aLen);
+  assert(aLen <= bLen);
+  assert(bLen - aLen <= maxDist);
+  assert(maxDist < bLen);
+
+  const std::size_t lenDiff = bLen - aLen;
+  const std::size_t slack = (maxDist - lenDiff) / 2;
+  const std::size_t capacity = levenshteinBandCapacity(aLen, bLen, maxDist);
+  const T outside = T(maxDist + 1);
+
+  std::fill(diag, diag + capacity, outside);
+  std::fill(diag2, diag2 + capacity, outside);
+  diag2[0] = 0;
+
+  const typename LevenshteinDiagonalStep<T*, T*, Iterator1, Iterator2, true>::Function step =
+    LevenshteinDiagonalStep<T*, T*, Iterator1, Iterator2, true>::select();
+
+  T prevMin = 0;
+  std::size_t offset = 0;
+  std::size_t i, k;
+
+  for (k = 1; ; ++k) {
+    assert(k <= aLen + bLen);
+
+    std::size_t startRow = k > bLen ? k - bLen : 1;
+    std::size_t endRow = k > aLen ? aLen : k - 1;
+
+    const std::size_t bandStart = k > lenDiff + slack ? (k - lenDiff - slack + 1) / 2 : 0;
+    const std::size_t bandEnd = std::min((k + slack) / 2, std::min(k, aLen));
+
+    startRow = std::max(startRow, bandStart);
+    endRow = std::min(endRow, bandEnd);
+
+    // Move the window once the band reaches its end; the rows below
+    // startRow - 1 are not needed anymore.
+    if (std::min(bandEnd + 1, aLen) - offset >= capacity) {
+      const std::size_t shift = startRow - 1 - levenshteinBandMargin - offset;
+      std::copy(diag + shift, diag + capacity, diag);
+      std::copy(diag2 + shift, diag2 + capacity, diag2);
+      std::fill(diag + capacity - shift, diag + capacity, outside);
+      std::fill(diag2 + capacity - shift, diag2 + capacity, outside);
+      offset += shift;
+    }
+
+    step(a + offset, b, startRow - offset, endRow - offset, k - offset, bLen, diag, diag2);
+
+    if (startRow > 0) {
+      diag[startRow - 1 - offset] = outside;
+    }
+
+    if (endRow + 1 <= aLen) {
+      diag[endRow + 1 - offset] = outside;
+    }
+
+    if (offset == 0) {
+      diag[0] = k <= lenDiff + slack ? T(k) : outside;
+    }
+
+    if (k <= aLen && k - offset < capacity) {
+      diag[k - offset] = k <= slack ? T(k) : outside;
+    }
+
+    if (k == aLen + bLen) {
+      return std::min(diag[aLen - offset], outside);
+    }
+
+    // Entries > maxDist are all equivalent, so clamp them to outside;
+    // this way, they never exceed outside + 1 and fit into narrow cells.
+    T min = outside;
+    for (i = std::max(bandStart, k > bLen ? k - bLen : 0); i <= bandEnd; ++i) {
+      diag[i - offset] = std::min(diag[i - offset], outside);
+      min = std::min(min, diag[i - offset]);
+    }
+
+    if (min > maxDist && prevMin > maxDist) {
+      return outside;
+    }
+
+    prevMin = min;
+
+    // switch buffers
+    std::swap(diag, diag2);
+  }
+
+  assert(0);
+}
+
+/**
+ * Outer loop of the diagonal algorithm variant, for one block of the
+ * table with arbitrary values along its upper and left edges.
+ *
+ * top[0 .. len(b)] is the row above the block and left[0 .. len(a)] the
+ * column left of it (top[0] == left[0] is the entry in the corner).
+ * On return, they contain the last row and the last column of the block.
+ * Both are updated in place: each entry of the input is read on an
+ * earlier diagonal than the one on which the output entry is written.
+ * diag and diag2 are scratch buffers like for levenshteinDiagonal().
+ */
+template<typename T, typename Iterator1, typename Iterator2>
+void levenshteinDiagonalTile(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  T* top, T* left, T* diag, T* diag2) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+
+  assert(0 < aLen && 0 < bLen);
+  assert(top[0] == left[0]);
+
+  diag2[0] = top[0];
+
+  const typename LevenshteinDiagonalStep<T*, T*, Iterator1, Iterator2, false>::Function step =
+    LevenshteinDiagonalStep<T*, T*, Iterator1, Iterator2, false>::select();
+
+  for (std::size_t k = 1; k <= aLen + bLen; ++k) {
+    std::size_t startRow = k > bLen ? k - bLen : 1;
+    std::size_t endRow = k > aLen ? aLen : k - 1;
+
+    step(a, b, startRow, endRow, k, bLen, diag, diag2);
+
+    if (k <= bLen) {
+      diag[0] = top[k];
+    }
+
+    if (k <= aLen) {
+      diag[k] = left[k];
+    }
+
+    if (k > aLen) {
+      top[k - aLen] = diag[aLen];
+    }
+
+    if (k > bLen) {
+      left[k - bLen] = diag[k - bLen];
+    }
+
+    // switch buffers
+    std::swap(diag, diag2);
+  }
+}
+
+/**
+ * Outer loop of the row-based variant, used for non-random-access iterators.
+ * arr is a scratch buffer with room for len(a) entries.
+ * 
+ * based on https://github.com/sindresorhus/leven
+ */
+template<typename T, typename Iterator1, typename Iterator2>
+T levenshteinRowBased(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd, T* arr) {
+  std::size_t i = 0, j = 0;
+  T ret(0);
+  
+  for (Iterator1 it = a; it != aEnd; ++it) {
+    arr[i] = i + 1;
+    ++i;
+  }
+
+  for (; b != bEnd; ++b) {
+    T tmp = j++;
+    ret = j;
+    i = 0;
+    
+    for (Iterator1 it = a; it != aEnd; ++it, ++i) {
+      T tmp2 = *b == *it ? tmp : tmp + 1;
+      tmp = arr[i];
+      ret = arr[i] = tmp > ret ? tmp2 > ret ? ret + 1 : tmp2 : tmp2 > tmp ? tmp + 1 : tmp2;
+    }
+  }
+
+  return ret;
+}
+
+/**
+ * Bit-parallel variant, used for integral element types.
+ *
+ * This is the bit-vector algorithm by Myers [2], in the formulation
+ * for the edit distance given by Hyyrö [3]. Instead of storing the
+ * table entries themselves, a column j of the table is represented by
+ * the vertical differences D[i][j] - D[i-1][j], which can only be
+ * -1, 0 or +1. These are stored as two bit vectors VP (the +1 entries)
+ * and VN (the -1 entries), bit `i-1` corresponding to row `i`.
+ * A whole column can then be computed from the previous one using a
+ * handful of word-sized operations, i.e. 64 table entries at once.
+ *
+ * All we need to know about a[] for that is, for every element c of b,
+ * the set of rows i with a[i-1] == c. That bit vector is precomputed
+ * once per call (see MyersPatternMatchVector).
+ *
+ * If a is longer than 64 elements, the column is split into blocks of
+ * 64 rows each, and the horizontal difference at the bottom of a
+ * block is carried into the top of the next block (the “blocked”
+ * variant from [2]).
+ *
+ * The distance itself is tracked by following the last row of the
+ * table, starting at D[len(a)][0] = len(a) and adding the horizontal
+ * differences at the bit corresponding to that row.
+ *
+ * [2]: G. Myers, A fast bit-vector algorithm for approximate string
+ *      matching based on dynamic programming, J. ACM 46 (1999)
+ * [3]: H. Hyyrö, A bit-vector algorithm for computing Levenshtein and
+ *      Damerau edit distances, Nordic Journal of Computing 10 (2003)
+ */
+
+/**
+ * Precomputed match bit vectors of a[] for all possible elements.
+ *
+ * get(c) returns a pointer to words() 64-bit words; bit `i % 64` of
+ * word `i / 64` is set iff a[i] == c.
+ *
+ * For 1-byte types, this is a simple lookup table. Wider types use
+ * a small open addressing hash table mapping each distinct element
+ * of a[] to its row of bit vectors; unknown elements map to row 0,
+ * which is all zeros.
+ */
+template<typename T, bool isByte = (sizeof(T) == 1)>
+class MyersPatternMatchVector;
+
+template<typename T>
+class MyersPatternMatchVector<T, true> {
+public:
+  MyersPatternMatchVector() : words_(0) {}
+
+  template<typename Iterator>
+  MyersPatternMatchVector(Iterator a, Iterator aEnd) {
+    assign(a, aEnd);
+  }
+
+  template<typename Iterator>
+  bool assign(Iterator a, Iterator aEnd) {
+    words_ = (std::distance(a, aEnd) + 63) / 64;
+    table_.assign(256 * words_, 0);
+
+    for (std::size_t i = 0; a != aEnd; ++a, ++i) {
+      table_[index(*a) * words_ + i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+
+    return true;
+  }
+
+  std::size_t words() const { return words_; }
+
+  const std::uint64_t* get(const T& c) const {
+    return &table_[index(c) * words_];
+  }
+
+private:
+  static inline std::size_t index(const T& c) {
+    return static_cast<unsigned char>(c);
+  }
+
+  std::size_t words_;
+  std::vector<std::uint64_t> table_;
+};
+
+template<typename T>
+class MyersPatternMatchVector<T, false> {
+public:
+  // Give up (and let the caller fall back to another algorithm)
+  // if the table would have more entries than this.
+  static constexpr std::size_t maxTableSize = std::size_t(1) << 22;
+
+  MyersPatternMatchVector() : words_(0), shift_(64) {}
+
+  template<typename Iterator>
+  MyersPatternMatchVector(Iterator a, Iterator aEnd) {
+    assign(a, aEnd);
+  }
+
+  template<typename Iterator>
+  bool assign(Iterator a, Iterator aEnd) {
+    const std::size_t len = std::distance(a, aEnd);
+    words_ = (len + 63) / 64;
+
+    // at least twice as many slots as there can be distinct elements
+    std::size_t slotCount = 16;
+    shift_ = 60;
+    while (slotCount < 2 * len) {
+      slotCount *= 2;
+      --shift_;
+    }
+
+    keys_.resize(slotCount);
+    rows_.assign(slotCount, 0);
+    masks_.assign(words_, 0); // row 0
+
+    for (std::size_t i = 0; a != aEnd; ++a, ++i) {
+      std::size_t slot = findSlot(*a);
+      if (rows_[slot] == 0) {
+        if (masks_.size() + words_ > maxTableSize) {
+          words_ = 0;
+          return false;
+        }
+
+        keys_[slot] = *a;
+        rows_[slot] = masks_.size() / words_;
+        masks_.resize(masks_.size() + words_, 0);
+      }
+
+      masks_[rows_[slot] * words_ + i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+
+    return true;
+  }
+
+  std::size_t words() const { return words_; }
+
+  const std::uint64_t* get(const T& c) const {
+    return &masks_[rows_[findSlot(c)] * words_];
+  }
+
+private:
+  inline std::size_t findSlot(const T& c) const {
+    const std::size_t mask = rows_.size() - 1;
+    std::size_t slot = (static_cast<std::uint64_t>(c) * 0x9e3779b97f4a7c15ull) >> shift_;
+
+    while (rows_[slot] != 0 && !(keys_[slot] == c)) {
+      slot = (slot + 1) & mask;
+    }
+
+    return slot;
+  }
+
+  std::size_t words_;
+  unsigned shift_;
+  std::vector<T> keys_;
+  std::vector<std::size_t> rows_;
+  std::vector<std::uint64_t> masks_;
+};
+
+/**
+ * Bit-parallel algorithm for len(a) <= 64, i.e. a single word per column.
+ * 
+ * Since D[len(a)][len(b)] >= D[len(a)][j] - (len(b) - j), we can stop
+ * early and return maxDist + 1 once the current score makes a result
+ * <= maxDist impossible.
+ */
+template<typename PatternMatchVector, typename Iterator2>
+std::size_t levenshteinMyers64(const PatternMatchVector& peq, std::size_t aLen,
+  Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist = std::numeric_limits<std::size_t>::max()) {
+  assert(0 < aLen && aLen <= 64);
+  assert(peq.words() == 1);
+
+  const std::uint64_t last = std::uint64_t(1) << (aLen - 1);
+  std::uint64_t vp = ~std::uint64_t(0);
+  std::uint64_t vn = 0;
+  std::size_t score = aLen;
+  std::size_t remaining = std::distance(b, bEnd);
+
+  for (; b != bEnd; ++b, --remaining) {
+    if (score > remaining && score - remaining > maxDist) {
+      return maxDist + 1;
+    }
+
+    const std::uint64_t x = *peq.get(*b);
+    const std::uint64_t d0 = (((x & vp) + vp) ^ vp) | x | vn;
+    std::uint64_t hp = vn | ~(d0 | vp);
+    std::uint64_t hn = d0 & vp;
+
+    score += (hp & last) != 0;
+    score -= (hn & last) != 0;
+
+    hp = (hp << 1) | 1;
+    hn = (hn << 1);
+    vp = hn | ~(d0 | hp);
+    vn = hp & d0;
+  }
+
+  return score;
+}
+
+/**
+ * One column of the blocked bit-parallel algorithm: update vp and vn
+ * (peq.words() words each) for the next element of b, whose match
+ * vectors are eq, and the last entry of the column, score.
+ * last is the bit of row len(a) in the last word.
+ *
+ * firstRowDelta is the horizontal difference in the first row of the
+ * table: 1 for the distance (0, 1, 2, ...), 0 for searching, where an
+ * occurrence may start anywhere (0, 0, 0, ...).
+ */
+inline void levenshteinMyersBlockedColumn(const std::uint64_t* eq, std::size_t words,
+  std::uint64_t last, std::uint64_t* vp, std::uint64_t* vn, std::size_t& score,
+  std::uint64_t firstRowDelta = 1) {
+  std::uint64_t hpCarry = firstRowDelta;
+  std::uint64_t hnCarry = 0;
+
+  for (std::size_t w = 0; w < words; ++w) {
+    const std::uint64_t x = eq[w] | hnCarry;
+    const std::uint64_t d0 = (((x & vp[w]) + vp[w]) ^ vp[w]) | x | vn[w];
+    std::uint64_t hp = vn[w] | ~(d0 | vp[w]);
+    std::uint64_t hn = d0 & vp[w];
+
+    if (w == words - 1) {
+      score += (hp & last) != 0;
+      score -= (hn & last) != 0;
+    }
+
+    const std::uint64_t hpOut = hp >> 63;
+    const std::uint64_t hnOut = hn >> 63;
+    hp = (hp << 1) | hpCarry;
+    hn = (hn << 1) | hnCarry;
+    vp[w] = hn | ~(d0 | hp);
+    vn[w] = hp & d0;
+    hpCarry = hpOut;
+    hnCarry = hnOut;
+  }
+}
+
+/**
+ * Blocked bit-parallel algorithm for len(a) > 64.
+ *
+ * vp and vn need to point to peq.words() words of scratch space each.
+ * maxDist is handled as in levenshteinMyers64.
+ */
+template<typename PatternMatchVector, typename Iterator2>
+std::size_t levenshteinMyersBlocked(const PatternMatchVector& peq, std::size_t aLen,
+  Iterator2 b, Iterator2 bEnd, std::uint64_t* vp, std::uint64_t* vn,
+  std::size_t maxDist = std::numeric_limits<std::size_t>::max()) {
+  const std::size_t words = peq.words();
+
+  assert(0 < aLen);
+  assert(words == (aLen + 63) / 64);
+
+  const std::uint64_t last = std::uint64_t(1) << ((aLen - 1) % 64);
+  std::fill(vp, vp + words, ~std::uint64_t(0));
+  std::fill(vn, vn + words, std::uint64_t(0));
+  std::size_t score = aLen;
+  std::size_t remaining = std::distance(b, bEnd);
+
+  for (; b != bEnd; ++b, --remaining) {
+    if (score > remaining && score - remaining > maxDist) {
+      return maxDist + 1;
+    }
+
+    levenshteinMyersBlockedColumn(peq.get(*b), words, last, vp, vn, score);
+  }
+
+  return score;
+}
+
+template<std::size_t size>
+struct UnsignedOfSize {};
+
+template<> struct UnsignedOfSize<1> { typedef std::uint8_t type; };
+template<> struct UnsignedOfSize<2> { typedef std::uint16_t type; };
+template<> struct UnsignedOfSize<4> { typedef std::uint32_t type; };
+template<> struct UnsignedOfSize<8> { typedef std::uint64_t type; };
+
+/**
+ * Grow-only scratch buffers for the algorithms above, by index:
+ *
+ * - 0, 1: the two diagonals of the diagonal variants, the VP/VN vectors
+ *   of the bit-parallel ones, the rows of the row-based ones
+ * - 2: the third diagonal of levenshteinOSA() and levenshteinDamerau()
+ *   (the saved entries of the row-based levenshteinDamerau()), the D0
+ *   vector of the bit-parallel levenshteinOSA(), the tile edges of the
+ *   parallel levenshtein(), levenshteinSearch() and
+ *   levenshteinAlignment()
+ * - 3: the fourth diagonal of levenshteinOSA() and levenshteinDamerau()
+ *   (the last matching rows of the row-based one), the same tile edges
+ * - 4: the row and column state of levenshteinDamerau(), the table and
+ *   the left edge of levenshteinAlignment()
+ *
+ * The input buffers are separate from these, and hold data that entry
+ * points keep across calls into the algorithms above, which never use them:
+ *
+ * - 0: the pointers to the inputs of levenshteinBatch(), the reversed
+ *   first input of levenshteinAlignment()
+ * - 1: the lengths, order and results of levenshteinBatch(), the reversed
+ *   second input of levenshteinAlignment()
+ * - 2, 3: the two inputs as decoded by levenshteinUtf8() or folded by an
+ *   equality policy
+ *
+ * Pattern match vectors are shared between all integral types of the
+ * same size, since the elements only need to be compared for equality.
+ *
+ * A workspace must not be used from multiple threads at the same time.
+ */
+class LevenshteinWorkspace {
+public:
+  static constexpr std::size_t bufferCount = 5;
+  static constexpr std::size_t inputBufferCount = 4;
+
+  LevenshteinWorkspace() {}
+  LevenshteinWorkspace(const LevenshteinWorkspace&) = delete;
+  LevenshteinWorkspace& operator=(const LevenshteinWorkspace&) = delete;
+
+  /**
+   * The workspace of the calling thread.
+   */
+  static LevenshteinWorkspace& threadLocal() {
+    static thread_local LevenshteinWorkspace workspace;
+    return workspace;
+  }
+
+  /**
+   * Buffer number index (< bufferCount) with room for at least n Ts.
+   * The contents are unspecified, and the returned pointer is valid
+   * until the next call with the same index.
+   */
+  template<typename T>
+  T* buffer(std::size_t index, std::size_t n) {
+    assert(index < bufferCount);
+    return grow<T>(buffers_[index], n);
+  }
+
+  /**
+   * Same as buffer(), for input buffer number index (< inputBufferCount).
+   */
+  template<typename T>
+  T* inputBuffer(std::size_t index, std::size_t n) {
+    assert(index < inputBufferCount);
+    return grow<T>(inputBuffers_[index], n);
+  }
+
+  template<typename T>
+  MyersPatternMatchVector<typename UnsignedOfSize<sizeof(T)>::type>& patternMatchVector() {
+    return patternMatchVector(typename UnsignedOfSize<sizeof(T)>::type());
+  }
+
+private:
+  typedef std::vector<char, AlignmentAllocator<char, alignment>> Buffer;
+
+  template<typename T>
+  static T* grow(Buffer& buffer, std::size_t n) {
+    if (buffer.size() < n * sizeof(T)) {
+      // the old contents are not needed, so do not copy them over
+      buffer.clear();
+      buffer.resize(n * sizeof(T));
+    }
+
+    return reinterpret_cast<T*>(buffer.data());
+  }
+
+  MyersPatternMatchVector<std::uint8_t>& patternMatchVector(std::uint8_t) { return peq8_; }
+  MyersPatternMatchVector<std::uint16_t>& patternMatchVector(std::uint16_t) { return peq16_; }
+  MyersPatternMatchVector<std::uint32_t>& patternMatchVector(std::uint32_t) { return peq32_; }
+  MyersPatternMatchVector<std::uint64_t>& patternMatchVector(std::uint64_t) { return peq64_; }
+
+  Buffer buffers_[bufferCount];
+  Buffer inputBuffers_[inputBufferCount];
+  MyersPatternMatchVector<std::uint8_t> peq8_;
+  MyersPatternMatchVector<std::uint16_t> peq16_;
+  MyersPatternMatchVector<std::uint32_t> peq32_;
+  MyersPatternMatchVector<std::uint64_t> peq64_;
+};
+
+/**
+ * Same as LevenshteinEngine (below), but for results <= maxDist only.
+ *
+ * The bit-parallel variant always looks at the whole table, so for
+ * longer inputs, we prefer the diagonal variant (which only looks at
+ * the Ukkonen band) if the band is narrow compared to len(a).
+ */
+template<bool useBitParallel>
+struct LevenshteinBoundedEngine {};
+
+template<>
+struct LevenshteinBoundedEngine<false> {
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calc(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  std::size_t aLen = aEnd - a;
+  std::size_t bLen = bEnd - b;
+
+#ifdef LSTSSE_SSE4_1
+  // All entries are <= maxDist + 1.
+  if (maxDist + 1 < std::numeric_limits<std::uint8_t>::max())
+    return calcDiagonal<std::uint8_t>(a, aEnd, b, bEnd, maxDist, workspace);
+
+  if (maxDist + 1 < std::numeric_limits<std::uint16_t>::max())
+    return calcDiagonal<std::uint16_t>(a, aEnd, b, bEnd, maxDist, workspace);
+#endif
+
+  if (aLen + bLen <= std::numeric_limits<std::uint32_t>::max())
+    return calcDiagonal<std::uint32_t>(a, aEnd, b, bEnd, maxDist, workspace);
+
+  return calcDiagonal<std::size_t>(a, aEnd, b, bEnd, maxDist, workspace);
+}
+
+template<typename T, typename Iterator1, typename Iterator2>
+static inline std::size_t calcDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t capacity = levenshteinBandCapacity(aLen, bEnd - b, maxDist);
+  return levenshteinDiagonalBounded<T>(a, aEnd, b, bEnd, maxDist,
+    workspace.buffer<T>(0, capacity), workspace.buffer<T>(1, capacity));
+}
+};
+
+template<>
+struct LevenshteinBoundedEngine<true> {
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calc(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  typedef typename std::iterator_traits<Iterator1>::value_type T;
+  const std::size_t aLen = aEnd - a;
+
+  if (aLen > 64 && maxDist < aLen / 8) {
+    return LevenshteinBoundedEngine<false>::calc(a, aEnd, b, bEnd, maxDist, workspace);
+  }
+
+  auto& peq = workspace.patternMatchVector<T>();
+  if (!peq.assign(a, aEnd)) {
+    return LevenshteinBoundedEngine<false>::calc(a, aEnd, b, bEnd, maxDist, workspace);
+  }
+
+  if (aLen <= 64) {
+    return std::min(levenshteinMyers64(peq, aLen, b, bEnd, maxDist), maxDist + 1);
+  }
+
+  return std::min(levenshteinMyersBlocked(peq, aLen, b, bEnd,
+    workspace.buffer<std::uint64_t>(0, peq.words()),
+    workspace.buffer<std::uint64_t>(1, peq.words()), maxDist), maxDist + 1);
+}
+};
+
+// Width of the first band that LevenshteinEngine<false> tries.
+constexpr std::size_t levenshteinMinAdaptiveBand = 64;
+
+/**
+ * Pick the algorithm for the (already trimmed) random-access case.
+ *
+ * The bit-parallel variant is used when both element types are
+ * the same integral type, because then the pattern match vectors
+ * can be built using hashing/table lookup and comparisons are exact.
+ * Otherwise, the diagonal variant is used.
+ */
+template<bool useBitParallel>
+struct LevenshteinEngine {};
+
+template<>
+struct LevenshteinEngine<false> {
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calc(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  std::size_t aLen = aEnd - a;
+  std::size_t bLen = bEnd - b;
+
+  // Similar inputs only need a narrow band of the table, so try bands of
+  // increasing width first; each attempt gives up early once the distance
+  // is known to exceed maxDist. Once the band would cover a sizable part
+  // of the table, computing all of it is cheaper.
+  for (std::size_t maxDist = bLen - aLen + levenshteinMinAdaptiveBand; maxDist < aLen / 8;
+    maxDist *= 2) {
+    const std::size_t result = LevenshteinBoundedEngine<false>::calc(a, aEnd, b, bEnd, maxDist,
+      workspace);
+    if (result <= maxDist) {
+      return result;
+    }
+  }
+
+  return calcFull(a, aEnd, b, bEnd, workspace);
+}
+
+/**
+ * The diagonal algorithm on the whole table, without trying bands first.
+ */
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calcFull(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  std::size_t aLen = aEnd - a;
+  std::size_t bLen = bEnd - b;
+
+#ifdef LSTSSE_SSE4_1
+  // All entries are <= bLen, so use the narrowest cells they fit into.
+  if (bLen < std::numeric_limits<std::uint8_t>::max())
+    return calcDiagonal<std::uint8_t>(a, aEnd, b, bEnd, workspace);
+
+  if (bLen < std::numeric_limits<std::uint16_t>::max())
+    return calcDiagonal<std::uint16_t>(a, aEnd, b, bEnd, workspace);
+#endif
+
+  if (aLen + bLen <= std::numeric_limits<std::uint32_t>::max())
+    return calcDiagonal<std::uint32_t>(a, aEnd, b, bEnd, workspace);
+
+  return calcDiagonal<std::size_t>(a, aEnd, b, bEnd, workspace);
+}
+
+template<typename T, typename Iterator1, typename Iterator2>
+static inline std::size_t calcDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  const std::size_t aLen = aEnd - a;
+  return levenshteinDiagonal<T>(a, aEnd, b, bEnd,
+    workspace.buffer<T>(0, aLen + 1), workspace.buffer<T>(1, aLen + 1));
+}
+};
+
+template<>
+struct LevenshteinEngine<true> {
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calc(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  typedef typename std::iterator_traits<Iterator1>::value_type T;
+  const std::size_t aLen = aEnd - a;
+
+  auto& peq = workspace.patternMatchVector<T>();
+  if (!peq.assign(a, aEnd)) {
+    return LevenshteinEngine<false>::calc(a, aEnd, b, bEnd, workspace);
+  }
+
+  if (aLen <= 64) {
+    return levenshteinMyers64(peq, aLen, b, bEnd);
+  }
+
+  return levenshteinMyersBlocked(peq, aLen, b, bEnd,
+    workspace.buffer<std::uint64_t>(0, peq.words()),
+    workspace.buffer<std::uint64_t>(1, peq.words()));
+}
+};
+
+template<typename Iterator1, typename Iterator2>
+struct UseBitParallel {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  static constexpr bool value = std::is_integral<T1>::value && std::is_same<T1, T2>::value &&
+    (sizeof(T1) == 1 || sizeof(T1) == 2 || sizeof(T1) == 4 || sizeof(T1) == 8);
+};
+
+/**
+ * Skipping common prefixes and suffixes, and looking for a single element.
+ *
+ * Inputs often share long prefixes or suffixes (e.g. versions of the same
+ * document), so for pointers to integral types, these compare 16 or 32
+ * bytes at once and find the first (last) difference from the comparison
+ * mask. Comparing bytes is enough for any integral type, since elements
+ * are equal iff all of their bytes are.
+ */
+inline unsigned levenshteinLowestBit(std::uint32_t mask) {
+  assert(mask != 0);
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  unsigned bit = 0;
+  while (!(mask & 1))
+    mask >>= 1, ++bit;
+  return bit;
+#endif
+}
+
+inline unsigned levenshteinHighestBit(std::uint32_t mask) {
+  assert(mask != 0);
+#if defined(__GNUC__)
+  return 31 - __builtin_clz(mask);
+#else
+  unsigned bit = 31;
+  while (!(mask & 0x80000000u))
+    mask <<= 1, --bit;
+  return bit;
+#endif
+}
+
+/**
+ * Number of equal bytes at the start of a and b, of at most n.
+ */
+inline std::size_t levenshteinPrefixBytes(const unsigned char* a, const unsigned char* b,
+  std::size_t n, std::size_t i, IsaScalar) {
+  while (i < n && a[i] == b[i])
+    ++i;
+  return i;
+}
+
+/**
+ * Number of equal bytes at the end of [.., aEnd) and [.., bEnd), of at most n.
+ */
+inline std::size_t levenshteinSuffixBytes(const unsigned char* aEnd, const unsigned char* bEnd,
+  std::size_t n, std::size_t i, IsaScalar) {
+  while (i < n && aEnd[-1 - std::ptrdiff_t(i)] == bEnd[-1 - std::ptrdiff_t(i)])
+    ++i;
+  return i;
+}
+
+#ifdef LSTSSE_SSE2
+LSTSSE_TARGET("sse2")
+inline std::size_t levenshteinPrefixBytes(const unsigned char* a, const unsigned char* b,
+  std::size_t n, std::size_t i, IsaSSE2) {
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    const std::uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffff;
+    if (mask != 0)
+      return i + levenshteinLowestBit(mask);
+  }
+  return levenshteinPrefixBytes(a, b, n, i, IsaScalar());
+}
+
+LSTSSE_TARGET("sse2")
+inline std::size_t levenshteinSuffixBytes(const unsigned char* aEnd, const unsigned char* bEnd,
+  std::size_t n, std::size_t i, IsaSSE2) {
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aEnd - i - 16));
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bEnd - i - 16));
+    const std::uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffff;
+    if (mask != 0)
+      return i + 15 - levenshteinHighestBit(mask);
+  }
+  return levenshteinSuffixBytes(aEnd, bEnd, n, i, IsaScalar());
+}
+#endif // LSTSSE_SSE2
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2")
+inline std::size_t levenshteinPrefixBytes(const unsigned char* a, const unsigned char* b,
+  std::size_t n, std::size_t i, IsaAVX2) {
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    const std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+    if (mask != 0)
+      return i + levenshteinLowestBit(mask);
+  }
+  return levenshteinPrefixBytes(a, b, n, i, IsaSSE2());
+}
+
+LSTSSE_TARGET("avx2")
+inline std::size_t levenshteinSuffixBytes(const unsigned char* aEnd, const unsigned char* bEnd,
+  std::size_t n, std::size_t i, IsaAVX2) {
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aEnd - i - 32));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bEnd - i - 32));
+    const std::uint32_t mask = ~std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+    if (mask != 0)
+      return i + 31 - levenshteinHighestBit(mask);
+  }
+  return levenshteinSuffixBytes(aEnd, bEnd, n, i, IsaSSE2());
+}
+#endif // LSTSSE_AVX2
+
+/**
+ * Index of the first element of [b, b + n) that is equal to x, or n.
+ */
+template<typename T>
+inline std::size_t levenshteinFindIndex(const T* b, std::size_t n, T x, std::size_t i, IsaScalar) {
+  while (i < n && !(b[i] == x))
+    ++i;
+  return i;
+}
+
+#ifdef LSTSSE_SSE2
+LSTSSE_TARGET("sse2")
+inline __m128i levenshteinCompareSSE2(__m128i x, std::uint8_t y) {
+  return _mm_cmpeq_epi8(x, _mm_set1_epi8(char(y)));
+}
+
+LSTSSE_TARGET("sse2")
+inline __m128i levenshteinCompareSSE2(__m128i x, std::uint16_t y) {
+  return _mm_cmpeq_epi16(x, _mm_set1_epi16(short(y)));
+}
+
+LSTSSE_TARGET("sse2")
+inline __m128i levenshteinCompareSSE2(__m128i x, std::uint32_t y) {
+  return _mm_cmpeq_epi32(x, _mm_set1_epi32(int(y)));
+}
+
+template<typename T>
+LSTSSE_TARGET("sse2")
+inline std::size_t levenshteinFindIndex(const T* b, std::size_t n, T x, std::size_t i, IsaSSE2) {
+  typedef typename UnsignedOfSize<sizeof(T)>::type U;
+  constexpr std::size_t lanes = 16 / sizeof(T);
+
+  for (; i + lanes <= n; i += lanes) {
+    const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    const std::uint32_t mask = _mm_movemask_epi8(levenshteinCompareSSE2(y, U(x)));
+    if (mask != 0)
+      return i + levenshteinLowestBit(mask) / sizeof(T);
+  }
+  return levenshteinFindIndex(b, n, x, i, IsaScalar());
+}
+#endif // LSTSSE_SSE2
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2")
+inline __m256i levenshteinCompareAVX2(__m256i x, std::uint8_t y) {
+  return _mm256_cmpeq_epi8(x, _mm256_set1_epi8(char(y)));
+}
+
+LSTSSE_TARGET("avx2")
+inline __m256i levenshteinCompareAVX2(__m256i x, std::uint16_t y) {
+  return _mm256_cmpeq_epi16(x, _mm256_set1_epi16(short(y)));
+}
+
+LSTSSE_TARGET("avx2")
+inline __m256i levenshteinCompareAVX2(__m256i x, std::uint32_t y) {
+  return _mm256_cmpeq_epi32(x, _mm256_set1_epi32(int(y)));
+}
+
+template<typename T>
+LSTSSE_TARGET("avx2")
+inline std::size_t levenshteinFindIndex(const T* b, std::size_t n, T x, std::size_t i, IsaAVX2) {
+  typedef typename UnsignedOfSize<sizeof(T)>::type U;
+  constexpr std::size_t lanes = 32 / sizeof(T);
+
+  for (; i + lanes <= n; i += lanes) {
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    const std::uint32_t mask = _mm256_movemask_epi8(levenshteinCompareAVX2(y, U(x)));
+    if (mask != 0)
+      return i + levenshteinLowestBit(mask) / sizeof(T);
+  }
+  return levenshteinFindIndex(b, n, x, i, IsaSSE2());
+}
+#endif // LSTSSE_AVX2
+
+// Below this many elements, the scalar loops are as fast.
+constexpr std::size_t levenshteinMinAffixScan = 16;
+
+inline std::size_t levenshteinPrefixBytes(const unsigned char* a, const unsigned char* b,
+  std::size_t n) {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return levenshteinPrefixBytes(a, b, n, 0, IsaAVX2());
+#endif
+#ifdef LSTSSE_SSE2
+  if (cpuLevel() >= cpuSSE2)
+    return levenshteinPrefixBytes(a, b, n, 0, IsaSSE2());
+#endif
+  return levenshteinPrefixBytes(a, b, n, 0, IsaScalar());
+}
+
+inline std::size_t levenshteinSuffixBytes(const unsigned char* aEnd, const unsigned char* bEnd,
+  std::size_t n) {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return levenshteinSuffixBytes(aEnd, bEnd, n, 0, IsaAVX2());
+#endif
+#ifdef LSTSSE_SSE2
+  if (cpuLevel() >= cpuSSE2)
+    return levenshteinSuffixBytes(aEnd, bEnd, n, 0, IsaSSE2());
+#endif
+  return levenshteinSuffixBytes(aEnd, bEnd, n, 0, IsaScalar());
+}
+
+/**
+ * Move a and b forward past their common prefix, and aEnd and bEnd back
+ * before their common suffix (which does not overlap with the prefix).
+ */
+template<typename Iterator1, typename Iterator2>
+inline void levenshteinSkipAffixes(Iterator1& a, Iterator1& aEnd, Iterator2& b, Iterator2& bEnd) {
+  while (a < aEnd && b < bEnd && a[0] == b[0])
+    ++a, ++b;
+
+  while (a < aEnd && b < bEnd && aEnd[-1] == bEnd[-1])
+    --aEnd, --bEnd;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type
+levenshteinSkipAffixes(const T*& a, const T*& aEnd, const T*& b, const T*& bEnd) {
+  std::size_t n = std::min(aEnd - a, bEnd - b);
+
+  // (most pairs of unrelated inputs differ right away)
+  if (n < levenshteinMinAffixScan || a[0] != b[0]) {
+    levenshteinSkipAffixes<const T*, const T*>(a, aEnd, b, bEnd);
+    return;
+  }
+
+  const std::size_t prefix = levenshteinPrefixBytes(reinterpret_cast<const unsigned char*>(a),
+    reinterpret_cast<const unsigned char*>(b), n * sizeof(T)) / sizeof(T);
+  a += prefix;
+  b += prefix;
+  n -= prefix;
+
+  if (n == 0 || aEnd[-1] != bEnd[-1]) {
+    return;
+  }
+
+  const std::size_t suffix = levenshteinSuffixBytes(reinterpret_cast<const unsigned char*>(aEnd),
+    reinterpret_cast<const unsigned char*>(bEnd), n * sizeof(T)) / sizeof(T);
+  aEnd -= suffix;
+  bEnd -= suffix;
+}
+
+/**
+ * Always decay pointers to const.
+ */
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type
+levenshteinSkipAffixes(T*& a, T*& aEnd, T*& b, T*& bEnd) {
+  const T* a_ = a;
+  const T* aEnd_ = aEnd;
+  const T* b_ = b;
+  const T* bEnd_ = bEnd;
+  levenshteinSkipAffixes(a_, aEnd_, b_, bEnd_);
+  a += a_ - a;
+  aEnd -= aEnd - aEnd_;
+  b += b_ - b;
+  bEnd -= bEnd - bEnd_;
+}
+
+/**
+ * Whether x occurs in [b, bEnd).
+ */
+template<typename Iterator2, typename T>
+inline bool levenshteinContains(Iterator2 b, Iterator2 bEnd, const T& x) {
+  return std::find(b, bEnd, x) != bEnd;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value &&
+  (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4), bool>::type
+levenshteinContains(const T* b, const T* bEnd, const T& x) {
+  const std::size_t n = bEnd - b;
+
+#ifdef LSTSSE_AVX2
+  if (n >= levenshteinMinAffixScan && cpuLevel() >= cpuAVX2)
+    return levenshteinFindIndex(b, n, x, 0, IsaAVX2()) != n;
+#endif
+#ifdef LSTSSE_SSE2
+  if (n >= levenshteinMinAffixScan && cpuLevel() >= cpuSSE2)
+    return levenshteinFindIndex(b, n, x, 0, IsaSSE2()) != n;
+#endif
+  return levenshteinFindIndex(b, n, x, 0, IsaScalar()) != n;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value &&
+  (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4), bool>::type
+levenshteinContains(T* b, T* bEnd, const T& x) {
+  return levenshteinContains(static_cast<const T*>(b), static_cast<const T*>(bEnd), x);
+}
+
+/**
+ * Number of positions j in [i, n) with a[j] != b[j].
+ */
+template<typename T>
+inline std::size_t levenshteinMismatches(const T* a, const T* b, std::size_t n, std::size_t i,
+  IsaScalar) {
+  std::size_t result = 0;
+  for (; i < n; ++i)
+    result += a[i] == b[i] ? 0 : 1;
+  return result;
+}
+
+#ifdef LSTSSE_SSE2
+LSTSSE_TARGET("sse2")
+inline __m128i levenshteinCompareSSE2(__m128i x, __m128i y, std::uint8_t) {
+  return _mm_cmpeq_epi8(x, y);
+}
+
+LSTSSE_TARGET("sse2")
+inline __m128i levenshteinCompareSSE2(__m128i x, __m128i y, std::uint16_t) {
+  return _mm_cmpeq_epi16(x, y);
+}
+
+LSTSSE_TARGET("sse2")
+inline __m128i levenshteinCompareSSE2(__m128i x, __m128i y, std::uint32_t) {
+  return _mm_cmpeq_epi32(x, y);
+}
+
+/**
+ * Each equal element sets all of its bytes in the comparison result,
+ * which are counted by byte-wise subtraction (flushed before the byte
+ * counters can overflow); the number of equal bytes divided by the
+ * element size is the number of equal elements.
+ */
+template<typename T>
+LSTSSE_TARGET("sse2")
+inline std::size_t levenshteinMismatches(const T* a, const T* b, std::size_t n, std::size_t i,
+  IsaSSE2) {
+  typedef typename UnsignedOfSize<sizeof(T)>::type U;
+  constexpr std::size_t lanes = 16 / sizeof(T);
+  const std::size_t start = i;
+  __m128i total = _mm_setzero_si128();
+
+  while (i + lanes <= n) {
+    const std::size_t blockEnd = i + std::min<std::size_t>((n - i) / lanes, 255) * lanes;
+    __m128i equal = _mm_setzero_si128();
+    for (; i < blockEnd; i += lanes) {
+      const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+      equal = _mm_sub_epi8(equal, levenshteinCompareSSE2(x, y, U()));
+    }
+    total = _mm_add_epi64(total, _mm_sad_epu8(equal, _mm_setzero_si128()));
+  }
+
+  std::uint64_t equalBytes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(equalBytes), total);
+  return (i - start) - std::size_t(equalBytes[0] + equalBytes[1]) / sizeof(T) +
+    levenshteinMismatches(a, b, n, i, IsaScalar());
+}
+#endif // LSTSSE_SSE2
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2")
+inline __m256i levenshteinCompareAVX2(__m256i x, __m256i y, std::uint8_t) {
+  return _mm256_cmpeq_epi8(x, y);
+}
+
+LSTSSE_TARGET("avx2")
+inline __m256i levenshteinCompareAVX2(__m256i x, __m256i y, std::uint16_t) {
+  return _mm256_cmpeq_epi16(x, y);
+}
+
+LSTSSE_TARGET("avx2")
+inline __m256i levenshteinCompareAVX2(__m256i x, __m256i y, std::uint32_t) {
+  return _mm256_cmpeq_epi32(x, y);
+}
+
+template<typename T>
+LSTSSE_TARGET("avx2")
+inline std::size_t levenshteinMismatches(const T* a, const T* b, std::size_t n, std::size_t i,
+  IsaAVX2) {
+  typedef typename UnsignedOfSize<sizeof(T)>::type U;
+  constexpr std::size_t lanes = 32 / sizeof(T);
+  const std::size_t start = i;
+  __m256i total = _mm256_setzero_si256();
+
+  while (i + lanes <= n) {
+    const std::size_t blockEnd = i + std::min<std::size_t>((n - i) / lanes, 255) * lanes;
+    __m256i equal = _mm256_setzero_si256();
+    for (; i < blockEnd; i += lanes) {
+      const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      equal = _mm256_sub_epi8(equal, levenshteinCompareAVX2(x, y, U()));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(equal, _mm256_setzero_si256()));
+  }
+
+  std::uint64_t equalBytes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(equalBytes), total);
+  return (i - start) -
+    std::size_t(equalBytes[0] + equalBytes[1] + equalBytes[2] + equalBytes[3]) / sizeof(T) +
+    levenshteinMismatches(a, b, n, i, IsaSSE2());
+}
+#endif // LSTSSE_AVX2
+
+/**
+ * Hamming distance of [a, aEnd) and the equally long range starting at b.
+ */
+template<typename Iterator1, typename Iterator2>
+inline std::size_t levenshteinHamming(Iterator1 a, Iterator1 aEnd, Iterator2 b) {
+  std::size_t result = 0;
+  for (; a != aEnd; ++a, ++b) {
+    if (!(*a == *b))
+      ++result;
+  }
+  return result;
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value &&
+  (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4), std::size_t>::type
+levenshteinHamming(const T* a, const T* aEnd, const T* b) {
+  const std::size_t n = aEnd - a;
+
+#ifdef LSTSSE_AVX2
+  if (n >= levenshteinMinAffixScan && cpuLevel() >= cpuAVX2)
+    return levenshteinMismatches(a, b, n, 0, IsaAVX2());
+#endif
+#ifdef LSTSSE_SSE2
+  if (n >= levenshteinMinAffixScan && cpuLevel() >= cpuSSE2)
+    return levenshteinMismatches(a, b, n, 0, IsaSSE2());
+#endif
+  return levenshteinMismatches(a, b, n, 0, IsaScalar());
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value &&
+  (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4), std::size_t>::type
+levenshteinHamming(T* a, T* aEnd, T* b) {
+  return levenshteinHamming(static_cast<const T*>(a), static_cast<const T*>(aEnd),
+    static_cast<const T*>(b));
+}
+
+/**
+ * Preable for edge cases and skipping common prefixes/suffixes,
+ * random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  if (aEnd - a > bEnd - b) {
+    return levenshtein(b, bEnd, a, aEnd, workspace);
+  }
+  
+  // skip common prefixes and suffixes
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
+  
+  std::size_t aLen = aEnd - a;
+  std::size_t bLen = bEnd - b;
+  
+  if (aLen == 0) {
+    return bLen;
+  }
+  
+  if (aLen == 1) {
+    return bLen - (levenshteinContains(b, bEnd, *a) ? 1 : 0);
+  }
+  
+  return LevenshteinEngine<UseBitParallel<Iterator1, Iterator2>::value>
+    ::calc(a, aEnd, b, bEnd, workspace);
+}
+
+/**
+ * Preable for edge cases and skipping common prefixes/suffixes,
+ * non-random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  // skip common prefixes and suffixes
+  while (a != aEnd && b != bEnd && *a == *b)
+    ++a, ++b;
+  
+  while (a != aEnd && b != bEnd && *std::prev(aEnd) == *std::prev(bEnd))
+    --aEnd, --bEnd;
+  
+  if (a == aEnd) {
+    return std::distance(b, bEnd);
+  }
+  
+  if (b == bEnd) {
+    return std::distance(a, aEnd);
+  }
+  
+  if (std::next(a) == aEnd) {
+    std::size_t ret = 0, found = 0;
+    for (; b != bEnd; ++b, ++ret)
+      if (*b == *a)
+        found = 1;
+    return ret - found;
+  }
+  
+  if (std::next(b) == bEnd) {
+    std::size_t ret = 0, found = 0;
+    for (; a != aEnd; ++a, ++ret)
+      if (*b == *a)
+        found = 1;
+    return ret - found;
+  }
+  
+  return levenshteinRowBased<std::size_t>(a, aEnd, b, bEnd,
+    workspace.buffer<std::size_t>(0, std::distance(a, aEnd)));
+}
+
+/**
+ * Preable for levenshteinBounded(), random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  if (aEnd - a > bEnd - b) {
+    return levenshteinBounded(b, bEnd, a, aEnd, maxDist, workspace);
+  }
+  
+  // the distance is at least the difference in length, so we may be
+  // able to tell right away
+  if (std::size_t((bEnd - b) - (aEnd - a)) > maxDist) {
+    return maxDist + 1;
+  }
+  
+  // skip common prefixes and suffixes
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
+  
+  std::size_t aLen = aEnd - a;
+  std::size_t bLen = bEnd - b;
+  
+  if (aLen == 0) {
+    return bLen;
+  }
+  
+  if (aLen == 1) {
+    std::size_t result = bLen - (levenshteinContains(b, bEnd, *a) ? 1 : 0);
+    return result > maxDist ? maxDist + 1 : result;
+  }
+  
+  // the distance is at most the longer length
+  if (bLen <= maxDist) {
+    return LevenshteinEngine<UseBitParallel<Iterator1, Iterator2>::value>
+      ::calc(a, aEnd, b, bEnd, workspace);
+  }
+  
+  return LevenshteinBoundedEngine<UseBitParallel<Iterator1, Iterator2>::value>
+    ::calc(a, aEnd, b, bEnd, maxDist, workspace);
+}
+
+/**
+ * Preable for levenshteinBounded(), non-random access version.
+ * 
+ * This only takes the shortcut for inputs whose lengths differ by
+ * more than maxDist.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  std::size_t aLen = std::distance(a, aEnd);
+  std::size_t bLen = std::distance(b, bEnd);
+  
+  if (std::max(aLen, bLen) - std::min(aLen, bLen) > maxDist) {
+    return maxDist + 1;
+  }
+  
+  std::size_t result = levenshtein(a, aEnd, b, bEnd, workspace);
+  return result > maxDist ? maxDist + 1 : result;
+}
+
+/**
+ * Multi-threaded variant of the diagonal algorithm.
+ *
+ * The table is split into square tiles of tileSize x tileSize entries
+ * (smaller at the bottom and right edges). A tile can be computed once
+ * the tiles above and to the left of it are done, so all tiles on an
+ * anti-diagonal of tiles can be computed at the same time; the threads
+ * take tiles from a queue, which is fed as tiles become ready.
+ *
+ * The tiles only exchange their edges: top_ holds the last computed row
+ * for every column of the table, left_ the last computed column for
+ * every row, and corners_ the entries shared by four tiles. Tile (r, c)
+ * reads and overwrites its part of top_ and left_ (excluding the corner,
+ * which would otherwise be shared with its neighbours), and the
+ * dependencies make sure that nobody else touches them in the meantime.
+ *
+ * Inside a tile, all entries are at least the smallest entry on its edges
+ * and exceed it by at most 2 * (h + w), so tiles are computed relative to
+ * that and fit into 16-bit cells. Each thread keeps its tile edges and
+ * diagonals in a workspace.
+ */
+template<typename Iterator1, typename Iterator2>
+class LevenshteinWavefront {
+public:
+  static constexpr std::size_t maxTileSize = 8192;
+
+#ifdef LSTSSE_SSE4_1
+  typedef std::uint16_t Cell;
+#else
+  typedef std::uint32_t Cell;
+#endif
+
+  LevenshteinWavefront(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+    std::size_t tileSize)
+    : a_(a), b_(b), aLen_(aEnd - a), bLen_(bEnd - b), tileSize_(tileSize),
+      rows_((aLen_ + tileSize - 1) / tileSize), cols_((bLen_ + tileSize - 1) / tileSize),
+      top_(bLen_ + 1), left_(aLen_ + 1), corners_((rows_ + 1) * (cols_ + 1)),
+      pending_(rows_ * cols_), done_(0), failed_(false)
+  {
+    assert(0 < tileSize && tileSize <= maxTileSize);
+
+    for (std::size_t j = 0; j <= bLen_; ++j)
+      top_[j] = j;
+    for (std::size_t i = 0; i <= aLen_; ++i)
+      left_[i] = i;
+    for (std::size_t c = 0; c <= cols_; ++c)
+      corners_[c] = std::min(c * tileSize, bLen_);
+    for (std::size_t r = 0; r <= rows_; ++r)
+      corners_[r * (cols_ + 1)] = std::min(r * tileSize, aLen_);
+
+    for (std::size_t r = 0; r < rows_; ++r) {
+      for (std::size_t c = 0; c < cols_; ++c)
+        pending_[r * cols_ + c] = (r > 0) + (c > 0);
+    }
+
+    ready_.push_back(0);
+  }
+
+  /**
+   * Compute the distance using the calling thread (with the given
+   * workspace) and threads - 1 additional ones.
+   */
+  std::size_t run(unsigned threads, LevenshteinWorkspace& workspace) {
+    std::vector<std::thread> workers;
+    try {
+      workers.reserve(threads - 1);
+      for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back([this] { work(LevenshteinWorkspace::threadLocal()); });
+      }
+    } catch (...) {
+      // (e.g. std::system_error if no more threads can be started) stop
+      // the workers that did start, since joinable threads must not be
+      // destroyed
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = true;
+      }
+      cond_.notify_all();
+      for (std::thread& worker : workers) {
+        worker.join();
+      }
+      throw;
+    }
+
+    work(workspace);
+
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+
+    return corners_.back();
+  }
+
+private:
+  void work(LevenshteinWorkspace& workspace) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+      cond_.wait(lock, [this] {
+        return !ready_.empty() || done_ == rows_ * cols_ || failed_;
+      });
+
+      if (ready_.empty() || failed_) {
+        return;
+      }
+
+      const std::size_t tile = ready_.front();
+      ready_.pop_front();
+      lock.unlock();
+
+      try {
+        computeTile(tile / cols_, tile % cols_, workspace);
+      } catch (...) {
+        lock.lock();
+        if (!failed_) {
+          error_ = std::current_exception();
+          failed_ = true;
+        }
+        cond_.notify_all();
+        return;
+      }
+
+      lock.lock();
+      ++done_;
+
+      if (tile % cols_ + 1 < cols_ && --pending_[tile + 1] == 0) {
+        ready_.push_back(tile + 1);
+      }
+
+      if (tile / cols_ + 1 < rows_ && --pending_[tile + cols_] == 0) {
+        ready_.push_back(tile + cols_);
+      }
+
+      cond_.notify_all();
+    }
+  }
+
+  void computeTile(std::size_t r, std::size_t c, LevenshteinWorkspace& workspace) {
+    const std::size_t i0 = r * tileSize_;
+    const std::size_t j0 = c * tileSize_;
+    const std::size_t h = std::min(tileSize_, aLen_ - i0);
+    const std::size_t w = std::min(tileSize_, bLen_ - j0);
+    const std::size_t corner = corners_[r * (cols_ + 1) + c];
+
+    std::size_t base = corner;
+    for (std::size_t j = 1; j <= w; ++j)
+      base = std::min(base, top_[j0 + j]);
+    for (std::size_t i = 1; i <= h; ++i)
+      base = std::min(base, left_[i0 + i]);
+
+    Cell* top = workspace.buffer<Cell>(2, w + 1);
+    Cell* left = workspace.buffer<Cell>(3, h + 1);
+    top[0] = left[0] = Cell(corner - base);
+    for (std::size_t j = 1; j <= w; ++j)
+      top[j] = Cell(top_[j0 + j] - base);
+    for (std::size_t i = 1; i <= h; ++i)
+      left[i] = Cell(left_[i0 + i] - base);
+
+    levenshteinDiagonalTile<Cell>(a_ + i0, a_ + i0 + h, b_ + j0, b_ + j0 + w, top, left,
+      workspace.buffer<Cell>(0, h + 1), workspace.buffer<Cell>(1, h + 1));
+
+    for (std::size_t j = 1; j <= w; ++j)
+      top_[j0 + j] = top[j] + base;
+    for (std::size_t i = 1; i <= h; ++i)
+      left_[i0 + i] = left[i] + base;
+    corners_[(r + 1) * (cols_ + 1) + c + 1] = top[w] + base;
+  }
+
+  const Iterator1 a_;
+  const Iterator2 b_;
+  const std::size_t aLen_, bLen_;
+  const std::size_t tileSize_;
+  const std::size_t rows_, cols_;
+
+  std::vector<std::size_t> top_;
+  std::vector<std::size_t> left_;
+  std::vector<std::size_t> corners_;
+
+  // everything below is protected by mutex_
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<unsigned char> pending_;
+  std::deque<std::size_t> ready_;
+  std::size_t done_;
+  bool failed_;
+  std::exception_ptr error_;
+};
+
+// passed to std::min() by reference
+template<typename Iterator1, typename Iterator2>
+constexpr std::size_t LevenshteinWavefront<Iterator1, Iterator2>::maxTileSize;
+
+/**
+ * Preable for the multi-threaded levenshtein(), random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  ParallelPolicy policy, LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  typedef LevenshteinWavefront<Iterator1, Iterator2> Wavefront;
+
+  // skip common prefixes and suffixes
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
+
+  const std::size_t shorter = std::min<std::size_t>(aEnd - a, bEnd - b);
+  unsigned threads = policy.threads;
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  // aim for a few tiles per thread along each edge
+  std::size_t tileSize = policy.tileSize;
+  if (tileSize == 0) {
+    tileSize = std::max<std::size_t>((shorter + 4 * threads - 1) / (4 * threads), 2048);
+  }
+  tileSize = std::min(tileSize, Wavefront::maxTileSize);
+
+  if (threads < 2 || shorter <= tileSize) {
+    return levenshtein(a, aEnd, b, bEnd, workspace);
+  }
+
+  return Wavefront(a, aEnd, b, bEnd, tileSize).run(threads, workspace);
+}
+
+/**
+ * Preable for the multi-threaded levenshtein(), non-random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  ParallelPolicy policy, LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  return levenshtein(a, aEnd, b, bEnd, workspace);
+}
+
+// SFINAE checker for .data() and .size()
+template<typename T>
+struct has_data_and_size {
+private:
+  struct char2 { char _[2]; };
+  template<typename U> static auto test(U* a) -> decltype(a->data() + a->size(), char(0));
+  template<typename U> static auto test(const U* a) -> char2;
+public:
+  static constexpr bool value = sizeof(test(static_cast<T*>(nullptr))) == 1;
+};
+
+template<bool useDataAndSize>
+struct LevenshteinContainer {};
+
+/**
+ * Use .data(), .size() when available.
+ */
+template<>
+struct LevenshteinContainer<true> {
+template<typename Container1, typename Container2>
+static inline std::size_t calc(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  return levenshtein(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), workspace);
+}
+
+template<typename Container1, typename Container2>
+static inline std::size_t calcParallel(const Container1& a, const Container2& b,
+  ParallelPolicy policy, LevenshteinWorkspace& workspace) {
+  return levenshtein(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), policy, workspace);
+}
+
+template<typename Container1, typename Container2>
+static inline std::size_t calcBounded(const Container1& a, const Container2& b,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  return levenshteinBounded(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(),
+    maxDist, workspace);
+}
+
+template<typename Container>
+static inline auto begin(const Container& c) -> decltype(c.data()) {
+  return c.data();
+}
+
+template<typename Container>
+static inline auto end(const Container& c) -> decltype(c.data()) {
+  return c.data() + c.size();
+}
+};
+
+/**
+ * Use std::begin(), std::end() otherwise.
+ */
+template<>
+struct LevenshteinContainer<false> {
+template<typename Container1, typename Container2>
+static inline std::size_t calc(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  return levenshtein(std::begin(a), std::end(a), std::begin(b), std::end(b), workspace);
+}
+
+template<typename Container1, typename Container2>
+static inline std::size_t calcParallel(const Container1& a, const Container2& b,
+  ParallelPolicy policy, LevenshteinWorkspace& workspace) {
+  return levenshtein(std::begin(a), std::end(a), std::begin(b), std::end(b), policy, workspace);
+}
+
+template<typename Container1, typename Container2>
+static inline std::size_t calcBounded(const Container1& a, const Container2& b,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  return levenshteinBounded(std::begin(a), std::end(a), std::begin(b), std::end(b), maxDist,
+    workspace);
+}
+
+template<typename Container>
+static inline auto begin(const Container& c) -> decltype(std::begin(c)) {
+  return std::begin(c);
+}
+
+template<typename Container>
+static inline auto end(const Container& c) -> decltype(std::end(c)) {
+  return std::end(c);
+}
+};
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshtein(a, aEnd, b, bEnd, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b) {
+  return levenshtein(a, b, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  return levenshtein(a, aEnd, b, bEnd, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  return LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value>::calc(a, b, workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  ParallelPolicy policy) {
+  return levenshtein(a, aEnd, b, bEnd, policy, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b, ParallelPolicy policy) {
+  return levenshtein(a, b, policy, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  ParallelPolicy policy, LevenshteinWorkspace& workspace) {
+  return levenshtein(a, aEnd, b, bEnd, policy, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshtein(const Container1& a, const Container2& b, ParallelPolicy policy,
+  LevenshteinWorkspace& workspace) {
+  return LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value>::calcParallel(a, b, policy, workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist) {
+  return levenshteinBounded(a, aEnd, b, bEnd, maxDist, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist) {
+  return levenshteinBounded(a, b, maxDist, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  return levenshteinBounded(a, aEnd, b, bEnd, maxDist, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist,
+  LevenshteinWorkspace& workspace) {
+  return LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value>::calcBounded(a, b, maxDist, workspace);
+}
+
+/**
+ * Histogram buckets for levenshteinLowerBound(): bytes are counted
+ * exactly, wider elements are hashed into as many buckets.
+ */
+constexpr std::size_t levenshteinHistogramSize = 256;
+
+template<typename T>
+inline std::size_t levenshteinHistogramBucket(T c, std::true_type /* byte */) {
+  return static_cast<unsigned char>(c);
+}
+
+template<typename T>
+inline std::size_t levenshteinHistogramBucket(T c, std::false_type /* byte */) {
+  return (static_cast<std::uint64_t>(c) * 0x9e3779b97f4a7c15ull) >> 56;
+}
+
+/**
+ * Add delta to the buckets of all elements of [it, itEnd), converted to C
+ * first, so that elements which compare equal end up in the same bucket.
+ *
+ * Consecutive elements are counted in different tables, so that repeated
+ * elements do not wait for each other's increments.
+ */
+template<typename C, typename Iterator>
+inline void levenshteinHistogramAdd(std::ptrdiff_t (&count)[4][levenshteinHistogramSize],
+  Iterator it, Iterator itEnd, std::ptrdiff_t delta, std::random_access_iterator_tag) {
+  const std::integral_constant<bool, sizeof(C) == 1> byte;
+
+  for (; itEnd - it >= 4; it += 4) {
+    count[0][levenshteinHistogramBucket(static_cast<C>(it[0]), byte)] += delta;
+    count[1][levenshteinHistogramBucket(static_cast<C>(it[1]), byte)] += delta;
+    count[2][levenshteinHistogramBucket(static_cast<C>(it[2]), byte)] += delta;
+    count[3][levenshteinHistogramBucket(static_cast<C>(it[3]), byte)] += delta;
+  }
+
+  for (; it != itEnd; ++it) {
+    count[0][levenshteinHistogramBucket(static_cast<C>(*it), byte)] += delta;
+  }
+}
+
+template<typename C, typename Iterator>
+inline void levenshteinHistogramAdd(std::ptrdiff_t (&count)[4][levenshteinHistogramSize],
+  Iterator it, Iterator itEnd, std::ptrdiff_t delta, std::bidirectional_iterator_tag) {
+  const std::integral_constant<bool, sizeof(C) == 1> byte;
+
+  for (; it != itEnd; ++it) {
+    count[0][levenshteinHistogramBucket(static_cast<C>(*it), byte)] += delta;
+  }
+}
+
+/**
+ * Every edit operation changes the number of occurrences of at most two
+ * elements, by one each, so if a has x more occurrences of some elements
+ * than b (in total) and b has y more occurrences of others, the distance
+ * is at least max(x, y) (see also LevenshteinMatcher). This is a q-gram
+ * lower bound with q = 1; longer q-grams do not give a better bound for
+ * the plain distance.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinHistogramBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::true_type /* integral */) {
+  typedef typename std::common_type<typename std::iterator_traits<Iterator1>::value_type,
+    typename std::iterator_traits<Iterator2>::value_type>::type C;
+
+  std::ptrdiff_t count[4][levenshteinHistogramSize] = {};
+  levenshteinHistogramAdd<C>(count, a, aEnd, 1,
+    typename std::iterator_traits<Iterator1>::iterator_category());
+  levenshteinHistogramAdd<C>(count, b, bEnd, -1,
+    typename std::iterator_traits<Iterator2>::iterator_category());
+
+  std::size_t x = 0, y = 0;
+  for (std::size_t i = 0; i < levenshteinHistogramSize; ++i) {
+    const std::ptrdiff_t difference = count[0][i] + count[1][i] + count[2][i] + count[3][i];
+    if (difference > 0) {
+      x += difference;
+    } else {
+      y -= difference;
+    }
+  }
+
+  return std::max(x, y);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinHistogramBound(Iterator1, Iterator1, Iterator2, Iterator2,
+  std::false_type /* integral */) {
+  return 0;
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinHistogramBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshteinHistogramBound(a, aEnd, b, bEnd, std::integral_constant<bool,
+    std::is_integral<typename std::iterator_traits<Iterator1>::value_type>::value &&
+    std::is_integral<typename std::iterator_traits<Iterator2>::value_type>::value>());
+}
+
+/**
+ * Lower bound, random access version. The common prefix and suffix do
+ * not change the histograms, so they are not counted.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinLowerBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
+  return std::max(std::max(aLen, bLen) - std::min(aLen, bLen),
+    levenshteinHistogramBound(a, aEnd, b, bEnd));
+}
+
+/**
+ * Lower bound, non-random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinLowerBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  const std::size_t aLen = std::distance(a, aEnd);
+  const std::size_t bLen = std::distance(b, bEnd);
+  return std::max(std::max(aLen, bLen) - std::min(aLen, bLen),
+    levenshteinHistogramBound(a, aEnd, b, bEnd));
+}
+
+/**
+ * Upper bound, random access version: substitute the shorter input for
+ * the start or the end of the longer one (whichever takes fewer
+ * substitutions) and insert the rest. For inputs of the same length,
+ * this is their Hamming distance.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinUpperBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  if (aEnd - a > bEnd - b) {
+    return levenshteinUpperBound(b, bEnd, a, aEnd);
+  }
+
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
+
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+
+  std::size_t substitutions = levenshteinHamming(a, aEnd, b);
+  if (aLen < bLen) {
+    substitutions = std::min(substitutions, levenshteinHamming(a, aEnd, bEnd - aLen));
+  }
+
+  return bLen - aLen + substitutions;
+}
+
+/**
+ * Upper bound, non-random access version, which only aligns the starts.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinUpperBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  std::size_t substitutions = 0;
+  for (; a != aEnd && b != bEnd; ++a, ++b) {
+    if (!(*a == *b))
+      ++substitutions;
+  }
+
+  return substitutions + std::distance(a, aEnd) + std::distance(b, bEnd);
+}
+
+// For smaller maxDist, levenshteinBounded() gives up about as quickly as
+// the histograms can be counted.
+constexpr std::size_t levenshteinMinHistogramFilter = 64;
+
+/**
+ * Preamble for levenshteinIfWithin(), random access version: try the
+ * bounds from the cheapest to the most expensive one before computing
+ * the distance itself.
+ */
+template<typename Iterator1, typename Iterator2>
+bool levenshteinIfWithin(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  if (aEnd - a > bEnd - b) {
+    return levenshteinIfWithin(b, bEnd, a, aEnd, maxDist, workspace);
+  }
+
+  if (std::size_t((bEnd - b) - (aEnd - a)) > maxDist) {
+    return false;
+  }
+
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
+
+  // the distance is at most the longer length
+  if (std::size_t(bEnd - b) <= maxDist || levenshteinUpperBound(a, aEnd, b, bEnd) <= maxDist) {
+    return true;
+  }
+
+  if (maxDist >= levenshteinMinHistogramFilter &&
+    levenshteinHistogramBound(a, aEnd, b, bEnd) > maxDist) {
+    return false;
+  }
+
+  return levenshteinBounded(a, aEnd, b, bEnd, maxDist, workspace) <= maxDist;
+}
+
+/**
+ * Preamble for levenshteinIfWithin(), non-random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+bool levenshteinIfWithin(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  const std::size_t aLen = std::distance(a, aEnd);
+  const std::size_t bLen = std::distance(b, bEnd);
+
+  if (std::max(aLen, bLen) - std::min(aLen, bLen) > maxDist) {
+    return false;
+  }
+
+  if (std::max(aLen, bLen) <= maxDist || levenshteinUpperBound(a, aEnd, b, bEnd) <= maxDist) {
+    return true;
+  }
+
+  if (maxDist >= levenshteinMinHistogramFilter &&
+    levenshteinHistogramBound(a, aEnd, b, bEnd) > maxDist) {
+    return false;
+  }
+
+  return levenshteinBounded(a, aEnd, b, bEnd, maxDist, workspace) <= maxDist;
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinLowerBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshteinLowerBound(a, aEnd, b, bEnd,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinLowerBound(const Container1& a, const Container2& b) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value> Access;
+  return levenshteinLowerBound(Access::begin(a), Access::end(a), Access::begin(b), Access::end(b));
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinUpperBound(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshteinUpperBound(a, aEnd, b, bEnd,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinUpperBound(const Container1& a, const Container2& b) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value> Access;
+  return levenshteinUpperBound(Access::begin(a), Access::end(a), Access::begin(b), Access::end(b));
+}
+
+template<typename Iterator1, typename Iterator2>
+bool levenshteinIfWithin(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist) {
+  return levenshteinIfWithin(a, aEnd, b, bEnd, maxDist, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+bool levenshteinIfWithin(const Container1& a, const Container2& b, std::size_t maxDist) {
+  return levenshteinIfWithin(a, b, maxDist, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2>
+bool levenshteinIfWithin(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  return levenshteinIfWithin(a, aEnd, b, bEnd, maxDist, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+bool levenshteinIfWithin(const Container1& a, const Container2& b, std::size_t maxDist,
+  LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value> Access;
+  return levenshteinIfWithin(Access::begin(a), Access::end(a), Access::begin(b), Access::end(b),
+    maxDist, workspace);
+}
+
+/**
+ * Index of the first byte of [s, s + n) at or after i that is not ASCII
+ * (0x80 or above), or n.
+ */
+inline std::size_t levenshteinAsciiBytes(const unsigned char* s, std::size_t n, std::size_t i,
+  IsaScalar) {
+  while (i < n && s[i] < 0x80)
+    ++i;
+  return i;
+}
+
+#ifdef LSTSSE_SSE2
+LSTSSE_TARGET("sse2")
+inline std::size_t levenshteinAsciiBytes(const unsigned char* s, std::size_t n, std::size_t i,
+  IsaSSE2) {
+  for (; i + 16 <= n; i += 16) {
+    const std::uint32_t mask = _mm_movemask_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+    if (mask != 0)
+      return i + levenshteinLowestBit(mask);
+  }
+  return levenshteinAsciiBytes(s, n, i, IsaScalar());
+}
+#endif // LSTSSE_SSE2
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2")
+inline std::size_t levenshteinAsciiBytes(const unsigned char* s, std::size_t n, std::size_t i,
+  IsaAVX2) {
+  for (; i + 32 <= n; i += 32) {
+    const std::uint32_t mask = _mm256_movemask_epi8(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)));
+    if (mask != 0)
+      return i + levenshteinLowestBit(mask);
+  }
+  return levenshteinAsciiBytes(s, n, i, IsaSSE2());
+}
+#endif // LSTSSE_AVX2
+
+inline std::size_t levenshteinAsciiBytes(const unsigned char* s, std::size_t n) {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return levenshteinAsciiBytes(s, n, 0, IsaAVX2());
+#endif
+#ifdef LSTSSE_SSE2
+  if (cpuLevel() >= cpuSSE2)
+    return levenshteinAsciiBytes(s, n, 0, IsaSSE2());
+#endif
+  return levenshteinAsciiBytes(s, n, 0, IsaScalar());
+}
+
+/**
+ * Decode the multi-byte sequence starting at s[i] and move i past it.
+ * Overlong encodings, surrogates and code points above U+10FFFF are
+ * rejected, like truncated sequences and stray continuation bytes.
+ */
+inline std::uint32_t levenshteinDecodeUtf8(const unsigned char* s, std::size_t n,
+  std::size_t& i) {
+  const std::uint32_t lead = s[i];
+  std::size_t length;
+  std::uint32_t c, min;
+
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2, c = lead & 0x1f, min = 0x80;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3, c = lead & 0x0f, min = 0x800;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4, c = lead & 0x07, min = 0x10000;
+  } else {
+    throw std::invalid_argument("levenshteinUtf8: invalid UTF-8");
+  }
+
+  if (n - i < length) {
+    throw std::invalid_argument("levenshteinUtf8: invalid UTF-8");
+  }
+
+  for (std::size_t k = 1; k < length; ++k) {
+    if ((s[i + k] & 0xc0) != 0x80) {
+      throw std::invalid_argument("levenshteinUtf8: invalid UTF-8");
+    }
+    c = (c << 6) | (s[i + k] & 0x3f);
+  }
+
+  if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) {
+    throw std::invalid_argument("levenshteinUtf8: invalid UTF-8");
+  }
+
+  i += length;
+  return c;
+}
+
+/**
+ * Validate [s, s + n) and return its number of code points; astral is
+ * set if any of them lies outside the Basic Multilingual Plane.
+ * Runs of ASCII are skipped 16 or 32 bytes at a time.
+ */
+inline std::size_t levenshteinScanUtf8(const unsigned char* s, std::size_t n, bool& astral) {
+  std::size_t length = 0;
+
+  for (std::size_t i = 0; i < n; ) {
+    if (s[i] < 0x80) {
+      const std::size_t ascii = levenshteinAsciiBytes(s + i, n - i);
+      length += ascii;
+      i += ascii;
+    } else {
+      astral |= levenshteinDecodeUtf8(s, n, i) > 0xffff;
+      ++length;
+    }
+  }
+
+  return length;
+}
+
+/**
+ * Decode the (already validated) [s, s + n) into out, which needs room
+ * for as many elements as there are code points.
+ */
+template<typename T>
+inline void levenshteinDecodeUtf8(const unsigned char* s, std::size_t n, T* out) {
+  for (std::size_t i = 0; i < n; ) {
+    if (s[i] < 0x80) {
+      const std::size_t ascii = levenshteinAsciiBytes(s + i, n - i);
+      out = std::copy(s + i, s + i + ascii, out);
+      i += ascii;
+    } else {
+      *out++ = T(levenshteinDecodeUtf8(s, n, i));
+    }
+  }
+}
+
+/**
+ * Decode both inputs into input buffers 2 and 3 of the workspace, with
+ * elements of type T.
+ */
+template<typename T>
+std::size_t levenshteinUtf8Decoded(const unsigned char* a, std::size_t aBytes,
+  std::size_t aLen, const unsigned char* b, std::size_t bBytes, std::size_t bLen,
+  LevenshteinWorkspace& workspace) {
+  T* a_ = workspace.inputBuffer<T>(2, aLen);
+  T* b_ = workspace.inputBuffer<T>(3, bLen);
+  levenshteinDecodeUtf8(a, aBytes, a_);
+  levenshteinDecodeUtf8(b, bBytes, b_);
+  return levenshtein(static_cast<const T*>(a_), static_cast<const T*>(a_ + aLen),
+    static_cast<const T*>(b_), static_cast<const T*>(b_ + bLen), workspace);
+}
+
+inline std::size_t levenshteinUtf8(const char* a, const char* aEnd, const char* b,
+  const char* bEnd) {
+  return levenshteinUtf8(a, aEnd, b, bEnd, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinUtf8(const Container1& a, const Container2& b) {
+  return levenshteinUtf8(a, b, LevenshteinWorkspace::threadLocal());
+}
+
+inline std::size_t levenshteinUtf8(const char* a, const char* aEnd, const char* b,
+  const char* bEnd, LevenshteinWorkspace& workspace) {
+  const unsigned char* a_ = reinterpret_cast<const unsigned char*>(a);
+  const unsigned char* b_ = reinterpret_cast<const unsigned char*>(b);
+  const std::size_t aBytes = aEnd - a;
+  const std::size_t bBytes = bEnd - b;
+
+  bool astral = false;
+  const std::size_t aLen = levenshteinScanUtf8(a_, aBytes, astral);
+  const std::size_t bLen = levenshteinScanUtf8(b_, bBytes, astral);
+
+  // For ASCII, bytes and code points are the same.
+  if (aLen == aBytes && bLen == bBytes) {
+    return levenshtein(a, aEnd, b, bEnd, workspace);
+  }
+
+  if (astral) {
+    return levenshteinUtf8Decoded<char32_t>(a_, aBytes, aLen, b_, bBytes, bLen, workspace);
+  }
+
+  return levenshteinUtf8Decoded<char16_t>(a_, aBytes, aLen, b_, bBytes, bLen, workspace);
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinUtf8(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinUtf8(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(),
+    workspace);
+}
+
+/**
+ * Fold [in, in + n) into out, element by element.
+ */
+template<typename Iterator, typename T, typename Equality>
+inline void levenshteinFold(Iterator in, std::size_t n, T* out, const Equality& equal) {
+  for (std::size_t i = 0; i < n; ++i, ++in) {
+    out[i] = equal.fold(T(*in));
+  }
+}
+
+/**
+ * Fold the bytes [in + i, in + n) into out with
+ * LevenshteinAsciiCaseInsensitive, i.e. set the 0x20 bit of 'A' to 'Z'.
+ */
+inline void levenshteinFoldAscii(const unsigned char* in, std::size_t n, unsigned char* out,
+  std::size_t i, IsaScalar) {
+  for (; i < n; ++i) {
+    out[i] = static_cast<unsigned>(in[i] - 'A') < 26 ? in[i] | 0x20 : in[i];
+  }
+}
+
+#ifdef LSTSSE_SSE2
+LSTSSE_TARGET("sse2")
+inline void levenshteinFoldAscii(const unsigned char* in, std::size_t n, unsigned char* out,
+  std::size_t i, IsaSSE2) {
+  const __m128i first = _mm_set1_epi8('A');
+  const __m128i last = _mm_set1_epi8('Z' - 'A');
+  const __m128i bit = _mm_set1_epi8(0x20);
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    // x - 'A' <= 'Z' - 'A', unsigned
+    const __m128i t = _mm_sub_epi8(x, first);
+    const __m128i upper = _mm_cmpeq_epi8(_mm_min_epu8(t, last), t);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+      _mm_or_si128(x, _mm_and_si128(upper, bit)));
+  }
+  levenshteinFoldAscii(in, n, out, i, IsaScalar());
+}
+#endif // LSTSSE_SSE2
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2")
+inline void levenshteinFoldAscii(const unsigned char* in, std::size_t n, unsigned char* out,
+  std::size_t i, IsaAVX2) {
+  const __m256i first = _mm256_set1_epi8('A');
+  const __m256i last = _mm256_set1_epi8('Z' - 'A');
+  const __m256i bit = _mm256_set1_epi8(0x20);
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const __m256i t = _mm256_sub_epi8(x, first);
+    const __m256i upper = _mm256_cmpeq_epi8(_mm256_min_epu8(t, last), t);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+      _mm256_or_si256(x, _mm256_and_si256(upper, bit)));
+  }
+  levenshteinFoldAscii(in, n, out, i, IsaSSE2());
+}
+#endif // LSTSSE_AVX2
+
+/**
+ * Bytes are folded 16 or 32 at a time.
+ */
+template<typename T>
+inline void levenshteinFold(const T* in, std::size_t n, T* out,
+  const LevenshteinAsciiCaseInsensitive& equal) {
+  if (sizeof(T) != 1) {
+    for (std::size_t i = 0; i < n; ++i) {
+      out[i] = equal.fold(in[i]);
+    }
+    return;
+  }
+
+  const unsigned char* in_ = reinterpret_cast<const unsigned char*>(in);
+  unsigned char* out_ = reinterpret_cast<unsigned char*>(out);
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return levenshteinFoldAscii(in_, n, out_, 0, IsaAVX2());
+#endif
+#ifdef LSTSSE_SSE2
+  if (cpuLevel() >= cpuSSE2)
+    return levenshteinFoldAscii(in_, n, out_, 0, IsaSSE2());
+#endif
+  levenshteinFoldAscii(in_, n, out_, 0, IsaScalar());
+}
+
+/**
+ * Fold [a, aEnd) into input buffer index of the workspace (2 or 3), and
+ * point folded and foldedEnd to the result.
+ */
+template<std::size_t index, typename Iterator, typename T, typename Equality>
+void levenshteinFold(Iterator a, Iterator aEnd, const T*& folded, const T*& foldedEnd,
+  const Equality& equal, LevenshteinWorkspace& workspace) {
+  static_assert(std::is_integral<T>::value,
+    "equality policies other than LevenshteinExact need integral element types");
+  static_assert(index < LevenshteinWorkspace::inputBufferCount,
+    "the folded inputs need to be in input buffers, which the algorithms do not use");
+  const std::size_t n = std::distance(a, aEnd);
+  T* out = workspace.inputBuffer<T>(index, n);
+  levenshteinFold(a, n, out, equal);
+  folded = out;
+  foldedEnd = out + n;
+}
+
+template<typename Iterator>
+struct LevenshteinFolded {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator>::value_type>::type type;
+};
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+std::size_t levenshteinEqual(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Equality& equal, LevenshteinWorkspace& workspace) {
+  const typename LevenshteinFolded<Iterator1>::type *a_, *aEnd_;
+  const typename LevenshteinFolded<Iterator2>::type *b_, *bEnd_;
+  levenshteinFold<2>(a, aEnd, a_, aEnd_, equal, workspace);
+  levenshteinFold<3>(b, bEnd, b_, bEnd_, equal, workspace);
+  return levenshtein(a_, aEnd_, b_, bEnd_, workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinEqual(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const LevenshteinExact&, LevenshteinWorkspace& workspace) {
+  return levenshtein(a, aEnd, b, bEnd, workspace);
+}
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+std::size_t levenshteinEqualBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, const Equality& equal, LevenshteinWorkspace& workspace) {
+  const typename LevenshteinFolded<Iterator1>::type *a_, *aEnd_;
+  const typename LevenshteinFolded<Iterator2>::type *b_, *bEnd_;
+  levenshteinFold<2>(a, aEnd, a_, aEnd_, equal, workspace);
+  levenshteinFold<3>(b, bEnd, b_, bEnd_, equal, workspace);
+  return levenshteinBounded(a_, aEnd_, b_, bEnd_, maxDist, workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinEqualBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, const LevenshteinExact&, LevenshteinWorkspace& workspace) {
+  return levenshteinBounded(a, aEnd, b, bEnd, maxDist, workspace);
+}
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd, const Equality& equal) {
+  return levenshtein(a, aEnd, b, bEnd, equal, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(const Container1& a, const Container2& b, const Equality& equal) {
+  return levenshtein(a, b, equal, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, const Equality& equal) {
+  return levenshteinBounded(a, aEnd, b, bEnd, maxDist, equal,
+    LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist,
+  const Equality& equal) {
+  return levenshteinBounded(a, b, maxDist, equal, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd, const Equality& equal,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinEqual(a, aEnd, b, bEnd, equal, workspace);
+}
+
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshtein(const Container1& a, const Container2& b, const Equality& equal,
+  LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value> Access;
+  return levenshteinEqual(Access::begin(a), Access::end(a), Access::begin(b), Access::end(b),
+    equal, workspace);
+}
+
+template<typename Iterator1, typename Iterator2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  std::size_t maxDist, const Equality& equal, LevenshteinWorkspace& workspace) {
+  return levenshteinEqualBounded(a, aEnd, b, bEnd, maxDist, equal, workspace);
+}
+
+template<typename Container1, typename Container2, typename Equality>
+typename std::enable_if<std::is_base_of<LevenshteinEquality, Equality>::value, std::size_t>::type
+levenshteinBounded(const Container1& a, const Container2& b, std::size_t maxDist,
+  const Equality& equal, LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value &&
+    has_data_and_size<Container2>::value> Access;
+  return levenshteinEqualBounded(Access::begin(a), Access::end(a), Access::begin(b),
+    Access::end(b), maxDist, equal, workspace);
+}
+
+/**
+ * Batch variant, computing the distances of multiple pairs at once.
+ *
+ * All of the SIMD variants above compute multiple entries of the table
+ * of a single pair at once, which does not work for short inputs.
+ * Here, each SIMD lane holds the table entry of a different pair instead,
+ * and the tables of all pairs are computed row by row in lockstep
+ * (the textbook Wagner–Fischer algorithm, just vectorized).
+ *
+ * The inputs are “transposed” first, so that the i-th elements of all
+ * pairs’ a[] are stored next to each other (and likewise for b[]).
+ * Each lane is as wide as the element type, so that elements can be
+ * compared directly; since the inputs are short, the table entries fit
+ * into lanes of any width. Pairs shorter than the longest one in the
+ * batch are padded; their result is picked up from the row buffer
+ * once row len(a) has been computed.
+ */
+
+// Inputs with more elements than this are not batched.
+constexpr std::size_t maxBatchLength = 64;
+
+template<typename Ops, typename T>
+void levenshteinBatchKernel(const T* const* as, const std::size_t* aLens,
+  const T* const* bs, const std::size_t* bLens, std::size_t count,
+  std::size_t* result, typename std::make_unsigned<T>::type* aT,
+  typename std::make_unsigned<T>::type* bT, typename std::make_unsigned<T>::type* row);
+
+#ifdef LSTSSE_SSE2
+template<typename Lane>
+struct LevenshteinBatchSSE2 {
+  typedef __m128i Vec;
+  static constexpr std::size_t lanes = sizeof(Vec) / sizeof(Lane);
+
+  LSTSSE_TARGET("sse2")
+  static inline Vec load(const Lane* p) {
+    return _mm_loadu_si128(reinterpret_cast<const Vec*>(p));
+  }
+
+  LSTSSE_TARGET("sse2")
+  static inline void store(Lane* p, Vec v) {
+    _mm_storeu_si128(reinterpret_cast<Vec*>(p), v);
+  }
+
+  LSTSSE_TARGET("sse2")
+  static inline Vec set1(Lane v) {
+    return sizeof(Lane) == 1 ? _mm_set1_epi8(v) :
+           sizeof(Lane) == 2 ? _mm_set1_epi16(v) : _mm_set1_epi32(v);
+  }
+
+  LSTSSE_TARGET("sse2")
+  static inline Vec add(Vec a, Vec b) {
+    return sizeof(Lane) == 1 ? _mm_add_epi8(a, b) :
+           sizeof(Lane) == 2 ? _mm_add_epi16(a, b) : _mm_add_epi32(a, b);
+  }
+
+  // All table entries are < 2^15, so for wider lanes, the upper halves
+  // are always zero and the signed 16-bit minimum works just as well.
+  LSTSSE_TARGET("sse2")
+  static inline Vec min(Vec a, Vec b) {
+    return sizeof(Lane) == 1 ? _mm_min_epu8(a, b) : _mm_min_epi16(a, b);
+  }
+
+  LSTSSE_TARGET("sse2")
+  static inline Vec cmpeq(Vec a, Vec b) {
+    return sizeof(Lane) == 1 ? _mm_cmpeq_epi8(a, b) :
+           sizeof(Lane) == 2 ? _mm_cmpeq_epi16(a, b) : _mm_cmpeq_epi32(a, b);
+  }
+
+  LSTSSE_TARGET("sse2")
+  static inline Vec andnot(Vec a, Vec b) {
+    return _mm_andnot_si128(a, b);
+  }
+  // levenshteinBatchKernel() compiled for this instruction set
+  template<typename T>
+  LSTSSE_TARGET("sse2") LSTSSE_FLATTEN
+  static void kernel(const T* const* as, const std::size_t* aLens,
+    const T* const* bs, const std::size_t* bLens, std::size_t count,
+    std::size_t* result, Lane* aT, Lane* bT, Lane* row) {
+    levenshteinBatchKernel<LevenshteinBatchSSE2>(as, aLens, bs, bLens, count, result, aT, bT, row);
+  }
+};
+#endif // LSTSSE_SSE2
+
+#ifdef LSTSSE_AVX2
+template<typename Lane>
+struct LevenshteinBatchAVX2 {
+  typedef __m256i Vec;
+  static constexpr std::size_t lanes = sizeof(Vec) / sizeof(Lane);
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec load(const Lane* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const Vec*>(p));
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline void store(Lane* p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<Vec*>(p), v);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec set1(Lane v) {
+    return sizeof(Lane) == 1 ? _mm256_set1_epi8(v) :
+           sizeof(Lane) == 2 ? _mm256_set1_epi16(v) : _mm256_set1_epi32(v);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec add(Vec a, Vec b) {
+    return sizeof(Lane) == 1 ? _mm256_add_epi8(a, b) :
+           sizeof(Lane) == 2 ? _mm256_add_epi16(a, b) : _mm256_add_epi32(a, b);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec min(Vec a, Vec b) {
+    return sizeof(Lane) == 1 ? _mm256_min_epu8(a, b) :
+           sizeof(Lane) == 2 ? _mm256_min_epu16(a, b) : _mm256_min_epu32(a, b);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec cmpeq(Vec a, Vec b) {
+    return sizeof(Lane) == 1 ? _mm256_cmpeq_epi8(a, b) :
+           sizeof(Lane) == 2 ? _mm256_cmpeq_epi16(a, b) : _mm256_cmpeq_epi32(a, b);
+  }
+
+  LSTSSE_TARGET("avx2")
+  static inline Vec andnot(Vec a, Vec b) {
+    return _mm256_andnot_si256(a, b);
+  }
+  // levenshteinBatchKernel() compiled for this instruction set
+  template<typename T>
+  LSTSSE_TARGET("avx2") LSTSSE_FLATTEN
+  static void kernel(const T* const* as, const std::size_t* aLens,
+    const T* const* bs, const std::size_t* bLens, std::size_t count,
+    std::size_t* result, Lane* aT, Lane* bT, Lane* row) {
+    levenshteinBatchKernel<LevenshteinBatchAVX2>(as, aLens, bs, bLens, count, result, aT, bT, row);
+  }
+};
+#endif // LSTSSE_AVX2
+
+/**
+ * One batch of up to Ops::lanes pairs, described by pointers and lengths.
+ * Results are written to result[0 .. count).
+ * aT, bT and row need to provide space for maxBatchLength + 1 vectors each.
+ *
+ * This is only ever inlined into Ops::kernel(), which is compiled for the
+ * right instruction set, so the vectors never cross a call boundary.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+template<typename Ops, typename T>
+void levenshteinBatchKernel(const T* const* as, const std::size_t* aLens,
+  const T* const* bs, const std::size_t* bLens, std::size_t count,
+  std::size_t* result, typename std::make_unsigned<T>::type* aT,
+  typename std::make_unsigned<T>::type* bT, typename std::make_unsigned<T>::type* row) {
+  typedef typename std::make_unsigned<T>::type Lane;
+  typedef typename Ops::Vec Vec;
+  const std::size_t lanes = Ops::lanes;
+
+  assert(count <= lanes);
+
+  std::size_t aMax = 0, bMax = 0;
+  for (std::size_t l = 0; l < count; ++l) {
+    aMax = std::max(aMax, aLens[l]);
+    bMax = std::max(bMax, bLens[l]);
+  }
+
+  assert(aMax <= maxBatchLength && bMax <= maxBatchLength);
+
+  std::fill(aT, aT + aMax * lanes, 0);
+  std::fill(bT, bT + bMax * lanes, 0);
+  for (std::size_t l = 0; l < count; ++l) {
+    for (std::size_t i = 0; i < aLens[l]; ++i)
+      aT[i * lanes + l] = static_cast<Lane>(as[l][i]);
+    for (std::size_t j = 0; j < bLens[l]; ++j)
+      bT[j * lanes + l] = static_cast<Lane>(bs[l][j]);
+    if (aLens[l] == 0)
+      result[l] = bLens[l];
+  }
+
+  const Vec one = Ops::set1(1);
+  for (std::size_t j = 0; j <= bMax; ++j) {
+    Ops::store(&row[j * lanes], Ops::set1(static_cast<Lane>(j)));
+  }
+
+  for (std::size_t i = 1; i <= aMax; ++i) {
+    const Vec a = Ops::load(&aT[(i - 1) * lanes]);
+    Vec diag = Ops::load(&row[0]);
+    Vec left = Ops::set1(static_cast<Lane>(i));
+    Ops::store(&row[0], left);
+
+    for (std::size_t j = 1; j <= bMax; ++j) {
+      const Vec up = Ops::load(&row[j * lanes]);
+      const Vec substitutionCost = Ops::andnot(Ops::cmpeq(a, Ops::load(&bT[(j - 1) * lanes])), one);
+      left = Ops::min(Ops::add(Ops::min(up, left), one), Ops::add(diag, substitutionCost));
+      diag = up;
+      Ops::store(&row[j * lanes], left);
+    }
+
+    for (std::size_t l = 0; l < count; ++l) {
+      if (aLens[l] == i)
+        result[l] = row[bLens[l] * lanes + l];
+    }
+  }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * Sort the pairs by size, run the kernel on groups of Ops::lanes pairs,
+ * and compute the remaining pairs one by one.
+ */
+template<typename Ops, typename T>
+void levenshteinBatchPointers(const T** as, std::size_t* aLens, const T** bs, std::size_t* bLens,
+  std::size_t n, std::size_t* order, std::size_t* result, LevenshteinWorkspace& workspace) {
+  const std::size_t lanes = Ops::lanes;
+  std::size_t bucketStart[maxBatchLength + 2] = {};
+
+  for (std::size_t p = 0; p < n; ++p) {
+    const T* a = as[p];
+    const T* aEnd = a + aLens[p];
+    const T* b = bs[p];
+    const T* bEnd = b + bLens[p];
+
+    // skip common prefixes and suffixes
+    levenshteinSkipAffixes(a, aEnd, b, bEnd);
+
+    as[p] = a;
+    bs[p] = b;
+    aLens[p] = aEnd - a;
+    bLens[p] = bEnd - b;
+
+    if (aLens[p] <= maxBatchLength && bLens[p] <= maxBatchLength) {
+      ++bucketStart[std::max(aLens[p], bLens[p]) + 1];
+    } else {
+      result[p] = levenshtein(a, aEnd, b, bEnd, workspace);
+    }
+  }
+
+  // counting sort by the longer of the two lengths
+  for (std::size_t len = 1; len <= maxBatchLength + 1; ++len) {
+    bucketStart[len] += bucketStart[len - 1];
+  }
+
+  const std::size_t batched = bucketStart[maxBatchLength + 1];
+  for (std::size_t p = 0; p < n; ++p) {
+    if (aLens[p] <= maxBatchLength && bLens[p] <= maxBatchLength) {
+      order[bucketStart[std::max(aLens[p], bLens[p])]++] = p;
+    }
+  }
+
+  typedef typename std::make_unsigned<T>::type Lane;
+  Lane* aT = workspace.buffer<Lane>(0, 3 * (maxBatchLength + 1) * lanes);
+  Lane* bT = aT + (maxBatchLength + 1) * lanes;
+  Lane* row = bT + (maxBatchLength + 1) * lanes;
+
+  const T* batchA[lanes];
+  const T* batchB[lanes];
+  std::size_t batchALens[lanes], batchBLens[lanes], batchResult[lanes];
+
+  for (std::size_t start = 0; start < batched; start += lanes) {
+    const std::size_t count = std::min(lanes, batched - start);
+
+    for (std::size_t l = 0; l < count; ++l) {
+      const std::size_t p = order[start + l];
+      batchA[l] = as[p];
+      batchB[l] = bs[p];
+      batchALens[l] = aLens[p];
+      batchBLens[l] = bLens[p];
+    }
+
+    Ops::kernel(batchA, batchALens, batchB, batchBLens, count, batchResult, aT, bT, row);
+
+    for (std::size_t l = 0; l < count; ++l) {
+      result[order[start + l]] = batchResult[l];
+    }
+  }
+}
+
+template<typename Pair>
+struct UseBatchKernel {
+  typedef typename std::decay<decltype(std::declval<Pair>().first)>::type Container1;
+  typedef typename std::decay<decltype(std::declval<Pair>().second)>::type Container2;
+  typedef typename std::remove_cv<typename Container1::value_type>::type T1;
+  typedef typename std::remove_cv<typename Container2::value_type>::type T2;
+
+  static constexpr bool value = std::is_integral<T1>::value && !std::is_same<T1, bool>::value &&
+    std::is_same<T1, T2>::value && (sizeof(T1) == 1 || sizeof(T1) == 2 || sizeof(T1) == 4) &&
+    has_data_and_size<Container1>::value && has_data_and_size<Container2>::value;
+};
+
+// Number of pairs that levenshteinBatch() collects before computing them.
+constexpr std::size_t batchChunkSize = 4096;
+
+template<bool useBatchKernel>
+struct LevenshteinBatch {};
+
+/**
+ * Compute the distances one by one.
+ */
+template<>
+struct LevenshteinBatch<false> {
+template<typename InputIterator, typename OutputIterator>
+static inline OutputIterator calc(InputIterator first, InputIterator last, OutputIterator out,
+  LevenshteinWorkspace& workspace) {
+  for (; first != last; ++first) {
+    *out++ = levenshtein(first->first, first->second, workspace);
+  }
+  return out;
+}
+};
+
+/**
+ * Collect pointers and lengths of up to batchChunkSize pairs at a time in
+ * the input buffers of the workspace, and use the batch kernel on them.
+ */
+template<>
+struct LevenshteinBatch<true> {
+template<typename InputIterator, typename OutputIterator>
+static inline OutputIterator calc(InputIterator first, InputIterator last, OutputIterator out,
+  LevenshteinWorkspace& workspace) {
+  typedef typename std::iterator_traits<InputIterator>::value_type Pair;
+  typedef typename std::remove_cv<typename UseBatchKernel<Pair>::T1>::type T;
+
+  const T** as = workspace.inputBuffer<const T*>(0, 2 * batchChunkSize);
+  const T** bs = as + batchChunkSize;
+  std::size_t* aLens = workspace.inputBuffer<std::size_t>(1, 4 * batchChunkSize);
+  std::size_t* bLens = aLens + batchChunkSize;
+  std::size_t* order = bLens + batchChunkSize;
+  std::size_t* result = order + batchChunkSize;
+
+  while (first != last) {
+    std::size_t n = 0;
+    for (; n < batchChunkSize && first != last; ++n, ++first) {
+      as[n] = first->first.data();
+      aLens[n] = first->first.size();
+      bs[n] = first->second.data();
+      bLens[n] = first->second.size();
+    }
+
+    calcPointers(as, aLens, bs, bLens, n, order, result, workspace);
+    out = std::copy(result, result + n, out);
+  }
+  return out;
+}
+
+template<typename T>
+static inline void calcPointers(const T** as, std::size_t* aLens, const T** bs, std::size_t* bLens,
+  std::size_t n, std::size_t* order, std::size_t* result, LevenshteinWorkspace& workspace) {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2) {
+    levenshteinBatchPointers<LevenshteinBatchAVX2<typename std::make_unsigned<T>::type>>(
+      as, aLens, bs, bLens, n, order, result, workspace);
+    return;
+  }
+#endif
+
+#ifdef LSTSSE_SSE2
+  if (cpuLevel() >= cpuSSE2) {
+    levenshteinBatchPointers<LevenshteinBatchSSE2<typename std::make_unsigned<T>::type>>(
+      as, aLens, bs, bLens, n, order, result, workspace);
+    return;
+  }
+#endif
+
+  for (std::size_t p = 0; p < n; ++p) {
+    result[p] = levenshtein(as[p], as[p] + aLens[p], bs[p], bs[p] + bLens[p], workspace);
+  }
+}
+};
+
+template<typename InputIterator, typename OutputIterator>
+OutputIterator levenshteinBatch(InputIterator first, InputIterator last, OutputIterator out,
+  LevenshteinWorkspace& workspace) {
+  typedef typename std::iterator_traits<InputIterator>::value_type Pair;
+  return LevenshteinBatch<UseBatchKernel<Pair>::value>::calc(first, last, out, workspace);
+}
+
+template<typename Pairs, typename OutputIterator>
+OutputIterator levenshteinBatch(const Pairs& pairs, OutputIterator out,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinBatch(std::begin(pairs), std::end(pairs), out, workspace);
+}
+
+template<typename InputIterator, typename OutputIterator>
+OutputIterator levenshteinBatch(InputIterator first, InputIterator last, OutputIterator out) {
+  return levenshteinBatch(first, last, out, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Pairs, typename OutputIterator>
+OutputIterator levenshteinBatch(const Pairs& pairs, OutputIterator out) {
+  return levenshteinBatch(pairs, out, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename T>
+class LevenshteinMatcher {
+public:
+  /**
+   * Prepare for computing distances to [query, queryEnd).
+   * The iterators need to fulfill the requirements of InputIterator;
+   * the sequence is copied, so it does not need to outlive the matcher.
+   */
+  template<typename Iterator>
+  LevenshteinMatcher(Iterator query, Iterator queryEnd)
+    : query_(query, queryEnd), bitParallel_(false)
+  {
+    init(std::integral_constant<bool, std::is_integral<T>::value>());
+  }
+
+  /**
+   * Prepare for computing distances to query, which needs to support
+   * std::begin() and std::end().
+   */
+  template<typename Container>
+  explicit LevenshteinMatcher(const Container& query)
+    : LevenshteinMatcher(std::begin(query), std::end(query)) {}
+
+  /**
+   * Prepare for computing distances to [query, queryEnd) instead, re-using
+   * the internal buffers, so that this does not allocate memory once they
+   * are large enough.
+   */
+  template<typename Iterator>
+  void reset(Iterator query, Iterator queryEnd) {
+    query_.assign(query, queryEnd);
+    init(std::integral_constant<bool, std::is_integral<T>::value>());
+  }
+
+  /**
+   * Compute the Levenshtein distance of the query and [b, bEnd).
+   * The same requirements as for levenshtein() apply to the iterators.
+   * 
+   * Calling this is not thread-safe, since the matcher re-uses its
+   * internal buffers for every call. Use one matcher per thread.
+   */
+  template<typename Iterator>
+  std::size_t distance(Iterator b, Iterator bEnd) {
+    return distance(b, bEnd,
+      std::integral_constant<bool, UseBitParallel<const T*, Iterator>::value>());
+  }
+
+  /**
+   * Compute the Levenshtein distance of the query and b.
+   * The same requirements as for levenshtein() apply to the container.
+   */
+  template<typename Container>
+  std::size_t distance(const Container& b) {
+    typedef LevenshteinContainer<has_data_and_size<Container>::value> Range;
+    return distance(Range::begin(b), Range::end(b));
+  }
+
+  /**
+   * Compute the Levenshtein distances of the query and each container in
+   * [first, last), and write them to out.
+   * Returns the output iterator past the last written element.
+   */
+  template<typename InputIterator, typename OutputIterator>
+  OutputIterator distances(InputIterator first, InputIterator last, OutputIterator out) {
+    for (; first != last; ++first, ++out) {
+      *out = distance(*first);
+    }
+
+    return out;
+  }
+
+  /**
+   * Compute the Levenshtein distance of the query and [b, bEnd), provided
+   * that it is at most maxDist. Otherwise, maxDist + 1 is returned.
+   * 
+   * Before computing anything, this checks whether the difference in
+   * length or, for integral types, the histograms of the two sequences
+   * rule out a result <= maxDist.
+   */
+  template<typename Iterator>
+  std::size_t distanceBounded(Iterator b, Iterator bEnd, std::size_t maxDist) {
+    const std::size_t aLen = query_.size();
+    const std::size_t bLen = std::distance(b, bEnd);
+
+    // the distance is at least the difference in length...
+    if (std::max(aLen, bLen) - std::min(aLen, bLen) > maxDist) {
+      return maxDist + 1;
+    }
+
+    // ... and at most the longer length
+    if (std::max(aLen, bLen) <= maxDist) {
+      return distance(b, bEnd);
+    }
+
+    if (histogramBound(b, bEnd, std::integral_constant<bool, std::is_integral<T>::value>()) > maxDist) {
+      return maxDist + 1;
+    }
+
+    return distanceBounded(b, bEnd, maxDist,
+      std::integral_constant<bool, UseBitParallel<const T*, Iterator>::value>());
+  }
+
+  /**
+   * Same as above, for a container.
+   */
+  template<typename Container>
+  std::size_t distanceBounded(const Container& b, std::size_t maxDist) {
+    typedef LevenshteinContainer<has_data_and_size<Container>::value> Range;
+    return distanceBounded(Range::begin(b), Range::end(b), maxDist);
+  }
+
+  /**
+   * Find the k containers in [first, last) closest to the query, see
+   * levenshteinTopK().
+   */
+  template<typename InputIterator>
+  std::vector<LevenshteinMatch> topK(InputIterator first, InputIterator last, std::size_t k,
+    std::size_t maxDist = std::numeric_limits<std::size_t>::max()) {
+    // a max-heap, so that the worst of the k best candidates is at the front
+    std::vector<LevenshteinMatch> best;
+    const auto worse = [](const LevenshteinMatch& x, const LevenshteinMatch& y) {
+      return x.distance < y.distance || (x.distance == y.distance && x.index < y.index);
+    };
+
+    if (k == 0) {
+      return best;
+    }
+
+    for (std::size_t index = 0; first != last; ++first, ++index) {
+      std::size_t bound = maxDist;
+      if (best.size() == k) {
+        // only strictly better candidates replace one of the current ones
+        if (best.front().distance == 0) {
+          break;
+        }
+
+        bound = std::min(bound, best.front().distance - 1);
+      }
+
+      const std::size_t distance = distanceBounded(*first, bound);
+      if (distance > bound) {
+        continue;
+      }
+
+      if (best.size() == k) {
+        std::pop_heap(best.begin(), best.end(), worse);
+        best.pop_back();
+      }
+
+      best.push_back(LevenshteinMatch { index, distance });
+      std::push_heap(best.begin(), best.end(), worse);
+    }
+
+    std::sort_heap(best.begin(), best.end(), worse);
+    return best;
+  }
+
+  const std::vector<T>& query() const { return query_; }
+
+private:
+  // Number of buckets for the histograms of integral types.
+  static constexpr std::size_t histogramSize = 64;
+
+  static inline std::size_t histogramBucket(const T& c) {
+    return (static_cast<std::uint64_t>(c) * 0x9e3779b97f4a7c15ull) >> 58;
+  }
+
+  void init(std::true_type) {
+    bitParallel_ = peq_.assign(query_.begin(), query_.end());
+    vp_.resize(peq_.words());
+    vn_.resize(peq_.words());
+
+    histogram_.assign(histogramSize, 0);
+    for (const T& c : query_) {
+      ++histogram_[histogramBucket(c)];
+    }
+  }
+
+  void init(std::false_type) {}
+
+  template<typename Iterator>
+  std::size_t distance(Iterator b, Iterator bEnd, std::true_type) {
+    const std::size_t aLen = query_.size();
+
+    if (!bitParallel_) {
+      return distance(b, bEnd, std::false_type());
+    }
+
+    if (aLen == 0) {
+      return std::distance(b, bEnd);
+    }
+
+    if (aLen <= 64) {
+      return levenshteinMyers64(peq_, aLen, b, bEnd);
+    }
+
+    return levenshteinMyersBlocked(peq_, aLen, b, bEnd, vp_.data(), vn_.data());
+  }
+
+  template<typename Iterator>
+  std::size_t distance(Iterator b, Iterator bEnd, std::false_type) {
+    return levenshtein(query_.data(), query_.data() + query_.size(), b, bEnd);
+  }
+
+  template<typename Iterator>
+  std::size_t distanceBounded(Iterator b, Iterator bEnd, std::size_t maxDist, std::true_type) {
+    const std::size_t aLen = query_.size();
+
+    if (!bitParallel_) {
+      return distanceBounded(b, bEnd, maxDist, std::false_type());
+    }
+
+    assert(aLen > 0);
+
+    if (aLen <= 64) {
+      return std::min(levenshteinMyers64(peq_, aLen, b, bEnd, maxDist), maxDist + 1);
+    }
+
+    return std::min(levenshteinMyersBlocked(peq_, aLen, b, bEnd, vp_.data(), vn_.data(), maxDist),
+      maxDist + 1);
+  }
+
+  template<typename Iterator>
+  std::size_t distanceBounded(Iterator b, Iterator bEnd, std::size_t maxDist, std::false_type) {
+    return levenshteinBounded(query_.data(), query_.data() + query_.size(), b, bEnd, maxDist);
+  }
+
+  /**
+   * Every edit operation changes the number of occurrences of at most two
+   * elements, by one each, so if query has x more occurrences of some
+   * elements than b (in total) and b has y more occurrences of others,
+   * the distance is at least max(x, y). This still holds if the elements
+   * are grouped into buckets.
+   */
+  template<typename Iterator>
+  std::size_t histogramBound(Iterator b, Iterator bEnd, std::true_type) const {
+    std::ptrdiff_t difference[histogramSize];
+    std::copy(histogram_.begin(), histogram_.end(), difference);
+
+    for (; b != bEnd; ++b) {
+      --difference[histogramBucket(*b)];
+    }
+
+    std::size_t x = 0, y = 0;
+    for (std::size_t i = 0; i < histogramSize; ++i) {
+      if (difference[i] > 0) {
+        x += difference[i];
+      } else {
+        y -= difference[i];
+      }
+    }
+
+    return std::max(x, y);
+  }
+
+  template<typename Iterator>
+  std::size_t histogramBound(Iterator, Iterator, std::false_type) const {
+    return 0;
+  }
+
+  std::vector<T> query_;
+  bool bitParallel_;
+  MyersPatternMatchVector<T> peq_;
+  std::vector<std::uint64_t> vp_;
+  std::vector<std::uint64_t> vn_;
+  std::vector<std::size_t> histogram_;
+};
+
+template<typename Container, typename InputIterator>
+std::vector<LevenshteinMatch> levenshteinTopK(const Container& query,
+  InputIterator first, InputIterator last, std::size_t k, std::size_t maxDist) {
+  typedef typename std::decay<decltype(*std::begin(query))>::type T;
+  return LevenshteinMatcher<T>(query).topK(first, last, k, maxDist);
+}
+
+template<typename Container, typename Candidates>
+std::vector<LevenshteinMatch> levenshteinTopK(const Container& query,
+  const Candidates& candidates, std::size_t k, std::size_t maxDist) {
+  return levenshteinTopK(query, std::begin(candidates), std::end(candidates), k, maxDist);
+}
+
+/**
+ * Levenshtein distance with one of the inputs arriving in chunks.
+ *
+ * The table is computed column by column, one column per element of b,
+ * so only the last column needs to be kept between chunks. For integral
+ * types, that is the bit vector representation of the bit-parallel
+ * algorithm (VP and VN, plus the last entry); otherwise the entries
+ * themselves, and each chunk is computed as one block with
+ * levenshteinDiagonalTile(), using the SIMD variants of the diagonal
+ * algorithm. The state is O(len(a)) either way, plus the scratch space
+ * for the largest chunk for non-integral types.
+ */
+template<typename T>
+class LevenshteinStream {
+public:
+  /**
+   * Prepare for computing the distance of [a, aEnd) and the chunks.
+   * The iterators need to fulfill the requirements of InputIterator;
+   * the sequence is copied, so it does not need to outlive the stream.
+   */
+  template<typename Iterator>
+  LevenshteinStream(Iterator a, Iterator aEnd)
+    : a_(a, aEnd), bitParallel_(false)
+  {
+    init(std::integral_constant<bool, std::is_integral<T>::value>());
+    reset();
+  }
+
+  /**
+   * Same as above, for a container supporting std::begin() and std::end().
+   */
+  template<typename Container>
+  explicit LevenshteinStream(const Container& a)
+    : LevenshteinStream(std::begin(a), std::end(a)) {}
+
+  /**
+   * Append [chunk, chunkEnd) to b. The iterators need to fulfill the
+   * requirements of InputIterator, and their elements need to be Ts.
+   */
+  template<typename Iterator>
+  void feed(Iterator chunk, Iterator chunkEnd) {
+    static_assert(std::is_same<typename std::remove_cv<
+      typename std::iterator_traits<Iterator>::value_type>::type, T>::value,
+      "The elements of the chunks need to be of the same type as those of a");
+
+    feed(chunk, chunkEnd, std::integral_constant<bool, std::is_integral<T>::value>());
+  }
+
+  /**
+   * Same as above, for a container.
+   */
+  template<typename Container>
+  void feed(const Container& chunk) {
+    typedef LevenshteinContainer<has_data_and_size<Container>::value> Range;
+    feed(Range::begin(chunk), Range::end(chunk));
+  }
+
+  /**
+   * The Levenshtein distance of a and everything passed to feed() so far.
+   */
+  std::size_t currentDistance() const {
+    return bitParallel_ ? score_ : column_.back();
+  }
+
+  /**
+   * The number of elements passed to feed() so far, i.e. len(b).
+   */
+  std::size_t consumed() const { return consumed_; }
+
+  /**
+   * Start over with an empty b.
+   */
+  void reset() {
+    consumed_ = 0;
+    score_ = a_.size();
+    std::fill(vp_.begin(), vp_.end(), ~std::uint64_t(0));
+    std::fill(vn_.begin(), vn_.end(), std::uint64_t(0));
+
+    if (!bitParallel_) {
+      column_.resize(a_.size() + 1);
+      for (std::size_t i = 0; i <= a_.size(); ++i) {
+        column_[i] = std::uint32_t(i);
+      }
+    }
+  }
+
+private:
+  // Chunks shorter than this are computed one column at a time, since
+  // the diagonal algorithm has some overhead per diagonal.
+  static constexpr std::size_t minTileLength = 16;
+
+  void init(std::true_type) {
+    bitParallel_ = !a_.empty() && peq_.assign(a_.begin(), a_.end());
+    vp_.resize(peq_.words());
+    vn_.resize(peq_.words());
+  }
+
+  void init(std::false_type) {}
+
+  template<typename Iterator>
+  void feed(Iterator chunk, Iterator chunkEnd, std::true_type) {
+    if (bitParallel_) {
+      feedBitParallel(chunk, chunkEnd);
+    } else {
+      feed(chunk, chunkEnd, std::false_type());
+    }
+  }
+
+  // The SIMD variants of the diagonal algorithm need pointers,
+  // so copy everything else.
+  template<typename Iterator>
+  void feed(Iterator chunk, Iterator chunkEnd, std::false_type) {
+    chunk_.assign(chunk, chunkEnd);
+    feedColumns(chunk_.data(), chunk_.data() + chunk_.size());
+  }
+
+  void feed(const T* chunk, const T* chunkEnd, std::false_type) {
+    feedColumns(chunk, chunkEnd);
+  }
+
+  void feed(T* chunk, T* chunkEnd, std::false_type) {
+    feedColumns(chunk, chunkEnd);
+  }
+
+  template<typename Iterator>
+  void feedBitParallel(Iterator b, Iterator bEnd) {
+    const std::size_t words = peq_.words();
+    const std::uint64_t last = std::uint64_t(1) << ((a_.size() - 1) % 64);
+
+    for (; b != bEnd; ++b, ++consumed_) {
+      levenshteinMyersBlockedColumn(peq_.get(*b), words, last, vp_.data(), vn_.data(), score_);
+    }
+  }
+
+  void feedColumns(const T* b, const T* bEnd) {
+    const std::size_t aLen = a_.size();
+    const std::size_t bLen = bEnd - b;
+
+    // all entries are <= max(len(a), len(b))
+    if (consumed_ + bLen > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("LevenshteinStream: input too long");
+    }
+
+    if (aLen == 0 || bLen == 0) {
+      consumed_ += bLen;
+      column_[0] = std::uint32_t(consumed_);
+      return;
+    }
+
+    if (bLen < minTileLength) {
+      for (; b != bEnd; ++b) {
+        std::uint32_t diagonal = column_[0];
+        column_[0] = std::uint32_t(++consumed_);
+
+        for (std::size_t i = 1; i <= aLen; ++i) {
+          const std::uint32_t result = std::min(std::min(column_[i-1], column_[i]) + 1,
+            diagonal + (a_[i-1] != *b));
+          diagonal = column_[i];
+          column_[i] = result;
+        }
+      }
+      return;
+    }
+
+    top_.resize(bLen + 1);
+    for (std::size_t j = 0; j <= bLen; ++j) {
+      top_[j] = std::uint32_t(consumed_ + j);
+    }
+    diag_.resize(aLen + 1);
+    diag2_.resize(aLen + 1);
+
+    const T* a = a_.data();
+    levenshteinDiagonalTile<std::uint32_t>(a, a + aLen, b, bEnd,
+      top_.data(), column_.data(), diag_.data(), diag2_.data());
+    consumed_ += bLen;
+    column_[0] = std::uint32_t(consumed_);
+  }
+
+  friend class LevenshteinIncremental<T>;
+
+  // Everything that feed() changes, for LevenshteinIncremental's checkpoints.
+  struct State {
+    std::size_t consumed;
+    std::size_t score;
+    std::vector<std::uint64_t> vp;
+    std::vector<std::uint64_t> vn;
+    std::vector<std::uint32_t> column;
+  };
+
+  void save(State& state) const {
+    state.consumed = consumed_;
+    state.score = score_;
+    state.vp = vp_;
+    state.vn = vn_;
+    state.column = column_;
+  }
+
+  void restore(const State& state) {
+    consumed_ = state.consumed;
+    score_ = state.score;
+    vp_ = state.vp;
+    vn_ = state.vn;
+    column_ = state.column;
+  }
+
+  std::vector<T> a_;
+  bool bitParallel_;
+  std::size_t consumed_;
+
+  // bit-parallel state
+  MyersPatternMatchVector<T> peq_;
+  std::vector<std::uint64_t> vp_;
+  std::vector<std::uint64_t> vn_;
+  std::size_t score_;
+
+  // the last column otherwise, and scratch space
+  std::vector<std::uint32_t> column_;
+  std::vector<std::uint32_t> top_;
+  std::vector<std::uint32_t> diag_;
+  std::vector<std::uint32_t> diag2_;
+  std::vector<T> chunk_;
+};
+
+/**
+ * Levenshtein distance of a reference and a document that changes.
+ *
+ * The table is computed column by column like in LevenshteinStream, one
+ * column per element of the document, and the state after every
+ * checkpointInterval elements is kept. Since an edit at position p leaves
+ * the columns up to p unchanged, the next distance() call resumes from the
+ * last checkpoint before the first edited position, so updating costs
+ * O((len(doc) - p) * len(reference)) instead of O(len(doc) * len(reference)).
+ * Edits in between two distance() calls are handled together.
+ *
+ * Each checkpoint takes len(reference) / 4 bytes for integral types and
+ * 4 * len(reference) bytes otherwise.
+ */
+template<typename T>
+class LevenshteinIncremental {
+public:
+  static constexpr std::size_t defaultCheckpointInterval = 1024;
+
+  /**
+   * Start with an empty document. [reference, referenceEnd) is copied,
+   * and the iterators need to fulfill the requirements of InputIterator.
+   */
+  template<typename Iterator>
+  LevenshteinIncremental(Iterator reference, Iterator referenceEnd,
+    std::size_t checkpointInterval = defaultCheckpointInterval)
+    : stream_(reference, referenceEnd),
+      interval_(std::max<std::size_t>(checkpointInterval, 1)),
+      checkpoints_(1), checkpointCount_(1), unchanged_(0), upToDate_(true)
+  {
+    stream_.save(checkpoints_[0]);
+  }
+
+  /**
+   * Same as above, for a container supporting std::begin() and std::end().
+   */
+  template<typename Container>
+  explicit LevenshteinIncremental(const Container& reference,
+    std::size_t checkpointInterval = defaultCheckpointInterval)
+    : LevenshteinIncremental(std::begin(reference), std::end(reference), checkpointInterval) {}
+
+  /**
+   * Replace the whole document.
+   */
+  template<typename Iterator>
+  void assign(Iterator doc, Iterator docEnd) {
+    replace(0, doc_.size(), doc, docEnd);
+  }
+
+  template<typename Container>
+  void assign(const Container& doc) {
+    assign(std::begin(doc), std::end(doc));
+  }
+
+  /**
+   * Replace the (at most) count elements of the document starting at pos
+   * with [first, last), like std::string::replace(). With count == 0,
+   * this inserts [first, last) before pos.
+   */
+  template<typename Iterator>
+  void replace(std::size_t pos, std::size_t count, Iterator first, Iterator last) {
+    erase(pos, count);
+    doc_.insert(doc_.begin() + pos, first, last);
+  }
+
+  template<typename Container>
+  void replace(std::size_t pos, std::size_t count, const Container& replacement) {
+    replace(pos, count, std::begin(replacement), std::end(replacement));
+  }
+
+  /**
+   * Remove the (at most) count elements of the document starting at pos.
+   */
+  void erase(std::size_t pos, std::size_t count) {
+    if (pos > doc_.size()) {
+      throw std::out_of_range("LevenshteinIncremental: position out of range");
+    }
+
+    count = std::min(count, doc_.size() - pos);
+    doc_.erase(doc_.begin() + pos, doc_.begin() + pos + count);
+    unchanged_ = std::min(unchanged_, pos);
+    upToDate_ = false;
+  }
+
+  /**
+   * The Levenshtein distance of the reference and the current document.
+   */
+  std::size_t distance() {
+    if (!upToDate_) {
+      update();
+    }
+    return stream_.currentDistance();
+  }
+
+  const std::vector<T>& document() const { return doc_; }
+
+private:
+  void update() {
+    std::size_t pos = stream_.consumed();
+
+    // Typing at the end of the document only needs the new columns,
+    // otherwise go back to the last checkpoint before the edits.
+    if (pos > unchanged_) {
+      checkpointCount_ = std::min(checkpointCount_, unchanged_ / interval_ + 1);
+      stream_.restore(checkpoints_[checkpointCount_ - 1]);
+      pos = stream_.consumed();
+    }
+
+    while (pos < doc_.size()) {
+      const std::size_t end = std::min((pos / interval_ + 1) * interval_, doc_.size());
+      stream_.feed(doc_.data() + pos, doc_.data() + end);
+      pos = end;
+
+      if (pos % interval_ == 0) {
+        assert(checkpointCount_ == pos / interval_);
+        if (checkpoints_.size() == checkpointCount_) {
+          checkpoints_.emplace_back();
+        }
+        stream_.save(checkpoints_[checkpointCount_++]);
+      }
+    }
+
+    unchanged_ = doc_.size();
+    upToDate_ = true;
+  }
+
+  typedef typename LevenshteinStream<T>::State State;
+
+  LevenshteinStream<T> stream_;
+  std::vector<T> doc_;
+  std::size_t interval_;
+
+  // checkpoints_[c] is the state after c * interval_ elements; only the
+  // first checkpointCount_ ones are valid, the others are kept for reuse.
+  std::vector<State> checkpoints_;
+  std::size_t checkpointCount_;
+
+  // the number of leading elements not edited since the last update()
+  std::size_t unchanged_;
+  bool upToDate_;
+};
+
+/**
+ * Multi-threaded computation of all pairwise distances of n sequences.
+ *
+ * The upper triangle of the distance matrix is split into blocks of
+ * blockSize x blockSize pairs, so that each block only uses a few
+ * sequences, over and over again, and writes to a few contiguous ranges of
+ * the output. For each row of a block, the first sequence is prepared
+ * once in the LevenshteinMatcher of the thread and compared to all
+ * columns.
+ *
+ * The cost of a pair is roughly the product of the lengths of its
+ * sequences, so the cost of the blocks varies a lot. The blocks are
+ * ordered by their summed cost, and dealt out round-robin to one queue per
+ * thread, from the most to the least expensive. Each thread takes blocks
+ * from the front of its own queue, and when that is empty, steals them
+ * from the back of the other queues.
+ *
+ * (Sorting the sequences themselves by length, so that the blocks have
+ * uniform lengths, turned out to be slower, since the results are then
+ * written to scattered positions of the output.)
+ */
+template<typename RandomAccessIterator, typename OutputIterator>
+class LevenshteinMatrix {
+public:
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type Sequence;
+  typedef LevenshteinContainer<has_data_and_size<Sequence>::value> Range;
+  typedef typename std::decay<decltype(*Range::begin(std::declval<const Sequence&>()))>::type T;
+
+  LevenshteinMatrix(RandomAccessIterator first, std::size_t n, OutputIterator out,
+    unsigned threads, std::size_t blockSize)
+    : first_(first), n_(n), out_(out), blockSize_(blockSize), queues_(threads), failed_(false)
+  {
+    // the summed lengths of the sequences in each row/column of blocks
+    const std::size_t count = (n + blockSize - 1) / blockSize;
+    std::vector<double> sums(count, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+      const Sequence& sequence = first[i];
+      sums[i / blockSize] += std::distance(Range::begin(sequence), Range::end(sequence)) + 1;
+    }
+
+    std::vector<std::pair<double, std::size_t>> blocks;
+    for (std::size_t r = 0; r < count; ++r) {
+      for (std::size_t c = r; c < count; ++c) {
+        blocks.emplace_back(sums[r] * sums[c] / (r == c ? 2 : 1), r * count + c);
+      }
+    }
+
+    std::stable_sort(blocks.begin(), blocks.end(),
+      [](const std::pair<double, std::size_t>& x, const std::pair<double, std::size_t>& y) {
+        return x.first > y.first;
+      });
+
+    for (std::size_t b = 0; b < blocks.size(); ++b) {
+      queues_[b % threads].blocks.push_back(blocks[b].second);
+    }
+  }
+
+  void run() {
+    std::vector<std::thread> workers;
+    try {
+      workers.reserve(queues_.size() - 1);
+      for (unsigned t = 1; t < queues_.size(); ++t) {
+        workers.emplace_back([this, t] { work(t); });
+      }
+    } catch (...) {
+      // stop the workers that did start before giving up, like
+      // LevenshteinWavefront::run()
+      {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        failed_ = true;
+      }
+      for (std::thread& worker : workers) {
+        worker.join();
+      }
+      throw;
+    }
+
+    work(0);
+
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> blocks;
+  };
+
+  void work(unsigned t) {
+    std::size_t block;
+    // reset() for every row, so that its buffers are only allocated once
+    const Sequence& any = first_[0];
+    LevenshteinMatcher<T> matcher(Range::begin(any), Range::begin(any));
+
+    while (next(t, block)) {
+      try {
+        computeBlock(block, matcher);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        if (!failed_) {
+          error_ = std::current_exception();
+          failed_ = true;
+        }
+        return;
+      }
+    }
+  }
+
+  bool next(unsigned t, std::size_t& block) {
+    {
+      std::lock_guard<std::mutex> lock(errorMutex_);
+      if (failed_) {
+        return false;
+      }
+    }
+
+    {
+      Queue& own = queues_[t];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.blocks.empty()) {
+        block = own.blocks.front();
+        own.blocks.pop_front();
+        return true;
+      }
+    }
+
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      Queue& other = queues_[(t + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      if (!other.blocks.empty()) {
+        block = other.blocks.back();
+        other.blocks.pop_back();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void computeBlock(std::size_t block, LevenshteinMatcher<T>& matcher) {
+    const std::size_t count = (n_ + blockSize_ - 1) / blockSize_;
+    const std::size_t r = block / count, c = block % count;
+    const std::size_t rowEnd = std::min(n_, (r + 1) * blockSize_);
+    const std::size_t colEnd = std::min(n_, (c + 1) * blockSize_);
+
+    for (std::size_t i = r * blockSize_; i < rowEnd; ++i) {
+      const Sequence& a = first_[i];
+      const std::size_t j0 = std::max(c * blockSize_, i + 1);
+      if (j0 >= colEnd) {
+        continue;
+      }
+
+      matcher.reset(Range::begin(a), Range::end(a));
+      OutputIterator out = out_ + (i * (2 * n_ - i - 1) / 2 + j0 - i - 1);
+      for (std::size_t j = j0; j < colEnd; ++j, ++out) {
+        const Sequence& b = first_[j];
+        *out = matcher.distance(Range::begin(b), Range::end(b));
+      }
+    }
+  }
+
+  const RandomAccessIterator first_;
+  const std::size_t n_;
+  const OutputIterator out_;
+  const std::size_t blockSize_;
+  std::vector<Queue> queues_;
+
+  std::mutex errorMutex_;
+  bool failed_;
+  std::exception_ptr error_;
+};
+
+template<typename RandomAccessIterator, typename OutputIterator>
+OutputIterator levenshteinMatrix(RandomAccessIterator first, RandomAccessIterator last,
+  OutputIterator out, ParallelPolicy policy) {
+  const std::size_t n = last - first;
+  if (n < 2) {
+    return out;
+  }
+
+  unsigned threads = policy.threads;
+  if (threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  // aim for a few blocks per thread along each edge, since the blocks in
+  // the lower left corner are missing
+  std::size_t blockSize = policy.blockSize;
+  if (blockSize == 0) {
+    blockSize = std::max<std::size_t>(1, std::min<std::size_t>(64, n / (4 * threads)));
+  }
+
+  const std::size_t count = (n + blockSize - 1) / blockSize;
+  threads = static_cast<unsigned>(std::min<std::size_t>(threads, count * (count + 1) / 2));
+  LevenshteinMatrix<RandomAccessIterator, OutputIterator>(first, n, out, threads, blockSize).run();
+  return out + n * (n - 1) / 2;
+}
+
+template<typename Sequences, typename OutputIterator>
+OutputIterator levenshteinMatrix(const Sequences& sequences, OutputIterator out,
+  ParallelPolicy policy) {
+  return levenshteinMatrix(std::begin(sequences), std::end(sequences), out, policy);
+}
+
+/**
+ * BK-tree [5]: Every node holds one term, and the subtree below the edge
+ * labeled d holds the terms at distance d from it. Since the Levenshtein
+ * distance is a metric, terms within maxDist of a query q can only be
+ * below the edges labeled levenshtein(node, q) ± maxDist, so all other
+ * subtrees are skipped.
+ *
+ * The tree is stored in one buffer without any pointers:
+ *
+ *   Header, Node[nodeCount], (padding), T[elementCount]
+ *
+ * The nodes are in breadth-first order, so the children of each node are
+ * adjacent and sorted by the labels of their edges, and the terms are
+ * stored in the same order. The buffer can be written to a file and used
+ * again by memory-mapping it (on a machine with the same byte order).
+ *
+ * [5]: W. A. Burkhard, R. M. Keller, Some approaches to best-match file
+ *      searching, Comm. ACM 16 (1973)
+ */
+template<typename T>
+class LevenshteinIndex {
+  static_assert(std::is_trivially_copyable<T>::value,
+    "LevenshteinIndex stores its terms as raw memory");
+
+public:
+  /**
+   * Build the index of the terms in [first, last), each of which needs to
+   * support std::begin() and std::end(). The terms are copied.
+   * Throws std::length_error if there are 2^32 terms or more, or if a term
+   * has 2^32 elements or more.
+   */
+  template<typename InputIterator>
+  LevenshteinIndex(InputIterator first, InputIterator last)
+    : external_(nullptr)
+  {
+    std::vector<T> elements;
+    std::vector<std::size_t> offsets(1, 0);
+    for (; first != last; ++first) {
+      elements.insert(elements.end(), std::begin(*first), std::end(*first));
+      offsets.push_back(elements.size());
+    }
+
+    build(elements, offsets);
+  }
+
+  /**
+   * Use the index stored in [data, data + size), as returned by data() and
+   * dataSize() of another index. The memory is not copied, so it needs to
+   * outlive this object, and needs to be suitably aligned (as memory from
+   * mmap() is). Throws std::invalid_argument if it does not hold an index
+   * of terms with elements of type T. This includes a pass over all nodes,
+   * which checks that they form a tree in the layout that build() writes,
+   * with terms inside the buffer, so that a corrupted or truncated file is
+   * rejected instead of being read out of bounds.
+   */
+  LevenshteinIndex(const void* data, std::size_t size)
+    : external_(static_cast<const char*>(data))
+  {
+    if (size < sizeof(Header) ||
+        reinterpret_cast<std::uintptr_t>(data) % alignof(Node) != 0 ||
+        std::memcmp(header().magic, magic(), sizeof(Header::magic)) != 0 ||
+        header().elementSize != sizeof(T) ||
+        size < elementsOffset(header().nodeCount) ||
+        (size - elementsOffset(header().nodeCount)) / sizeof(T) < header().elementCount ||
+        !validNodes()) {
+      throw std::invalid_argument("LevenshteinIndex: invalid data");
+    }
+  }
+
+  /**
+   * Find all terms with a distance of at most maxDist to [term, termEnd).
+   * The result holds the positions of the terms in the input of the
+   * constructor and their distances, sorted by distance and then by
+   * position. The iterators need to fulfill the requirements of
+   * InputIterator.
+   * 
+   * Unlike LevenshteinMatcher, this can be called from multiple threads
+   * at the same time.
+   */
+  template<typename Iterator>
+  std::vector<LevenshteinMatch> query(Iterator term, Iterator termEnd, std::size_t maxDist) const {
+    std::vector<LevenshteinMatch> result;
+    if (size() == 0) {
+      return result;
+    }
+
+    LevenshteinMatcher<T> matcher(term, termEnd);
+    const Node* nodes = this->nodes();
+    const T* elements = this->elements();
+    std::vector<std::uint32_t> pending(1, 0);
+
+    while (!pending.empty()) {
+      const Node& node = nodes[pending.back()];
+      pending.pop_back();
+
+      const Node* child = nodes + node.firstChild;
+      const Node* childrenEnd = child + node.childCount;
+
+      // If the distance exceeds the largest label by more than maxDist,
+      // no child needs to be visited, so its exact value does not matter.
+      std::size_t bound = maxDist;
+      if (node.childCount > 0) {
+        bound = std::max(bound, saturatingAdd(childrenEnd[-1].label, maxDist));
+      }
+
+      const T* t = elements + node.offset;
+      const std::size_t distance = matcher.distanceBounded(t, t + node.length, bound);
+      if (distance <= maxDist) {
+        result.push_back(LevenshteinMatch { node.index, distance });
+      }
+
+      if (distance > bound) {
+        continue;
+      }
+
+      const std::size_t lowest = distance > maxDist ? distance - maxDist : 0;
+      child = std::lower_bound(child, childrenEnd, lowest,
+        [](const Node& n, std::size_t label) { return n.label < label; });
+      for (; child != childrenEnd && (child->label <= distance || child->label - distance <= maxDist); ++child) {
+        pending.push_back(static_cast<std::uint32_t>(child - nodes));
+      }
+    }
+
+    std::sort(result.begin(), result.end(), [](const LevenshteinMatch& x, const LevenshteinMatch& y) {
+      return x.distance < y.distance || (x.distance == y.distance && x.index < y.index);
+    });
+    return result;
+  }
+
+  /**
+   * Same as above, for any container supporting std::begin() and std::end().
+   */
+  template<typename Container>
+  std::vector<LevenshteinMatch> query(const Container& term, std::size_t maxDist) const {
+    return query(std::begin(term), std::end(term), maxDist);
+  }
+
+  /**
+   * The number of terms in the index.
+   */
+  std::size_t size() const { return header().nodeCount; }
+
+  /**
+   * The buffer holding the index, see LevenshteinIndex(data, size).
+   */
+  const void* data() const { return base(); }
+  std::size_t dataSize() const {
+    return elementsOffset(header().nodeCount) + header().elementCount * sizeof(T);
+  }
+
+private:
+  struct Header {
+    char magic[8];
+    std::uint32_t elementSize;
+    std::uint32_t nodeCount;
+    std::uint64_t elementCount;
+  };
+
+  struct Node {
+    std::uint64_t offset;     // of the term in the elements
+    std::uint32_t length;     // of the term
+    std::uint32_t index;      // of the term in the input
+    std::uint32_t firstChild;
+    std::uint32_t childCount;
+    std::uint32_t label;      // distance to the term of the parent
+    std::uint32_t reserved;
+  };
+
+  static const char* magic() { return "lstbk01"; }
+
+  static std::size_t elementsOffset(std::size_t nodeCount) {
+    const std::size_t end = sizeof(Header) + nodeCount * sizeof(Node);
+    return (end + alignof(T) - 1) / alignof(T) * alignof(T);
+  }
+
+  static std::size_t saturatingAdd(std::size_t x, std::size_t y) {
+    return x > std::numeric_limits<std::size_t>::max() - y ? std::numeric_limits<std::size_t>::max() : x + y;
+  }
+
+  /**
+   * Whether the nodes are in breadth-first order (the children of node n
+   * come after n, and after the children of the nodes before n), the
+   * children of each node are sorted by their labels, and all terms are
+   * within the elements. This makes sure that query() visits each node at
+   * most once and never reads outside of the buffer.
+   */
+  bool validNodes() const {
+    const std::size_t nodeCount = header().nodeCount;
+    const std::uint64_t elementCount = header().elementCount;
+    const Node* nodes = this->nodes();
+    std::size_t nextChild = 1;
+
+    for (std::size_t n = 0; n < nodeCount; ++n) {
+      const Node& node = nodes[n];
+      if (node.firstChild != nextChild || node.firstChild <= n ||
+          node.childCount > nodeCount - node.firstChild ||
+          node.offset > elementCount || node.length > elementCount - node.offset ||
+          node.index >= nodeCount) {
+        return false;
+      }
+
+      for (std::size_t c = node.firstChild + 1; c < node.firstChild + node.childCount; ++c) {
+        if (nodes[c - 1].label >= nodes[c].label) {
+          return false;
+        }
+      }
+
+      nextChild += node.childCount;
+    }
+
+    return nodeCount == 0 || nextChild == nodeCount;
+  }
+
+  const char* base() const { return external_ ? external_ : storage_.data(); }
+  const Header& header() const { return *reinterpret_cast<const Header*>(base()); }
+  const Node* nodes() const { return reinterpret_cast<const Node*>(base() + sizeof(Header)); }
+  const T* elements() const {
+    return reinterpret_cast<const T*>(base() + elementsOffset(header().nodeCount));
+  }
+
+  /**
+   * The term with index i is [elements[offsets[i]], elements[offsets[i+1]]).
+   * 
+   * Instead of inserting the terms one by one, the tree is built top-down:
+   * The first remaining term of a subtree becomes its root, and the others
+   * are grouped by their distance to it, computed with a LevenshteinMatcher.
+   */
+  void build(const std::vector<T>& elements, const std::vector<std::size_t>& offsets) {
+    const std::size_t count = offsets.size() - 1;
+    if (count > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("LevenshteinIndex: too many terms");
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+      if (offsets[i+1] - offsets[i] > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::length_error("LevenshteinIndex: term too long");
+      }
+    }
+
+    std::vector<Node> nodes;
+    nodes.reserve(count);
+    // the terms below nodes[n] are order[subtrees[n].first, subtrees[n].second)
+    std::vector<std::pair<std::size_t, std::size_t>> subtrees;
+    std::vector<std::uint32_t> order(count);
+    std::vector<std::size_t> distances(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+      order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    const auto addNode = [&](std::uint32_t index, std::size_t label, std::size_t first, std::size_t last) {
+      Node node = {};
+      node.length = static_cast<std::uint32_t>(offsets[index+1] - offsets[index]);
+      node.index = index;
+      node.label = static_cast<std::uint32_t>(label);
+      nodes.push_back(node);
+      subtrees.emplace_back(first, last);
+    };
+
+    if (count > 0) {
+      addNode(0, 0, 1, count);
+    }
+
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+      const std::size_t first = subtrees[n].first, last = subtrees[n].second;
+      nodes[n].firstChild = static_cast<std::uint32_t>(nodes.size());
+      if (first == last) {
+        continue;
+      }
+
+      const T* term = elements.data() + offsets[nodes[n].index];
+      LevenshteinMatcher<T> matcher(term, term + nodes[n].length);
+      for (std::size_t i = first; i < last; ++i) {
+        distances[order[i]] = matcher.distance(elements.data() + offsets[order[i]],
+          elements.data() + offsets[order[i]+1]);
+      }
+
+      std::sort(order.begin() + first, order.begin() + last, [&](std::uint32_t x, std::uint32_t y) {
+        return distances[x] < distances[y] || (distances[x] == distances[y] && x < y);
+      });
+
+      for (std::size_t i = first, j; i < last; i = j) {
+        for (j = i + 1; j < last && distances[order[j]] == distances[order[i]]; ++j) {}
+        addNode(order[i], distances[order[i]], i + 1, j);
+        ++nodes[n].childCount;
+      }
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, magic(), sizeof(header.magic));
+    header.elementSize = sizeof(T);
+    header.nodeCount = static_cast<std::uint32_t>(count);
+    header.elementCount = elements.size();
+
+    storage_.resize(elementsOffset(count) + elements.size() * sizeof(T));
+    std::memcpy(&storage_[0], &header, sizeof(header));
+
+    std::uint64_t offset = 0;
+    T* out = reinterpret_cast<T*>(&storage_[elementsOffset(count)]);
+    for (Node& node : nodes) {
+      node.offset = offset;
+      std::copy(elements.begin() + offsets[node.index], elements.begin() + offsets[node.index+1],
+        out + offset);
+      offset += node.length;
+    }
+
+    if (count > 0) {
+      std::memcpy(&storage_[sizeof(Header)], nodes.data(), count * sizeof(Node));
+    }
+  }
+
+  const char* external_;
+  std::vector<char, AlignmentAllocator<char, alignment>> storage_;
+};
+
+/**
+ * Trie search with a Levenshtein automaton.
+ *
+ * The trie is built by inserting the sorted terms one after another, so
+ * its nodes end up in depth-first order: The subtree of node n is
+ * [n, subtreeEnds_[n]), and skipping it means jumping to its end.
+ *
+ * While walking the trie, the state of the nondeterministic automaton that
+ * accepts everything within maxDist of the query is kept for each depth,
+ * simulated bit-parallel [6]: Bit i of state d is set iff the first i
+ * elements of the query are within d edits of the path to the node. Once
+ * state maxDist is empty, no term below the node can match. For queries
+ * with more than 63 elements, or maxDist > 63, a row of the table is kept
+ * for each depth instead.
+ *
+ * [6]: S. Wu, U. Manber, Fast text searching allowing errors,
+ *      Comm. ACM 35 (1992)
+ */
+template<typename T>
+class LevenshteinTrie {
+public:
+  /**
+   * Build the trie of the terms in [first, last), each of which needs to
+   * support std::begin() and std::end(). The terms are copied, and their
+   * elements need to be comparable with <.
+   * Throws std::length_error if there are 2^32 terms or nodes or more.
+   */
+  template<typename InputIterator>
+  LevenshteinTrie(InputIterator first, InputIterator last)
+    : maxDepth_(0)
+  {
+    std::vector<T> elements;
+    std::vector<std::size_t> offsets(1, 0);
+    for (; first != last; ++first) {
+      elements.insert(elements.end(), std::begin(*first), std::end(*first));
+      offsets.push_back(elements.size());
+    }
+
+    build(elements, offsets);
+  }
+
+  /**
+   * Find all terms with a distance of at most maxDist to [term, termEnd).
+   * The result holds the positions of the terms in the input of the
+   * constructor and their distances, sorted by distance and then by
+   * position. The iterators need to fulfill the requirements of
+   * InputIterator.
+   * 
+   * This can be called from multiple threads at the same time.
+   */
+  template<typename Iterator>
+  std::vector<LevenshteinMatch> query(Iterator term, Iterator termEnd, std::size_t maxDist) const {
+    const std::vector<T> q(term, termEnd);
+    std::vector<LevenshteinMatch> result;
+
+    if (q.size() <= 63 && maxDist <= 63) {
+      queryAutomaton(q, maxDist, result, std::integral_constant<bool, std::is_integral<T>::value>());
+    } else {
+      queryRows(q, maxDist, result);
+    }
+
+    std::sort(result.begin(), result.end(), [](const LevenshteinMatch& x, const LevenshteinMatch& y) {
+      return x.distance < y.distance || (x.distance == y.distance && x.index < y.index);
+    });
+    return result;
+  }
+
+  /**
+   * Same as above, for any container supporting std::begin() and std::end().
+   */
+  template<typename Container>
+  std::vector<LevenshteinMatch> query(const Container& term, std::size_t maxDist) const {
+    return query(std::begin(term), std::end(term), maxDist);
+  }
+
+  /**
+   * The number of terms in the trie.
+   */
+  std::size_t size() const { return terms_.size(); }
+
+private:
+  /**
+   * The term with index i is [elements[offsets[i]], elements[offsets[i+1]]).
+   */
+  void build(const std::vector<T>& elements, const std::vector<std::size_t>& offsets) {
+    const std::size_t count = offsets.size() - 1;
+    if (count > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::length_error("LevenshteinTrie: too many terms");
+    }
+
+    std::vector<std::uint32_t> order(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    const auto begin = [&](std::size_t i) { return elements.begin() + offsets[i]; };
+    const auto end = [&](std::size_t i) { return elements.begin() + offsets[i+1]; };
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t x, std::uint32_t y) {
+      return std::lexicographical_compare(begin(x), end(x), begin(y), end(y));
+    });
+
+    // the root
+    labels_.push_back(T());
+    depths_.push_back(0);
+    subtreeEnds_.push_back(0);
+    firstTerms_.push_back(0);
+
+    // the nodes on the path to the previous term
+    std::vector<std::uint32_t> path(1, 0);
+    std::size_t previous = 0;
+
+    for (std::size_t t = 0; t < count; ++t) {
+      const std::size_t index = order[t];
+      const std::size_t length = offsets[index+1] - offsets[index];
+      std::size_t common = 0;
+      if (t > 0) {
+        const std::size_t previousLength = offsets[previous+1] - offsets[previous];
+        while (common < length && common < previousLength &&
+               begin(index)[common] == begin(previous)[common]) {
+          ++common;
+        }
+      }
+
+      // the terms are sorted, so the rest of the previous path is finished
+      while (path.size() > common + 1) {
+        subtreeEnds_[path.back()] = static_cast<std::uint32_t>(labels_.size());
+        path.pop_back();
+      }
+
+      for (std::size_t i = common; i < length; ++i) {
+        if (labels_.size() >= std::numeric_limits<std::uint32_t>::max()) {
+          throw std::length_error("LevenshteinTrie: too many nodes");
+        }
+
+        path.push_back(static_cast<std::uint32_t>(labels_.size()));
+        labels_.push_back(begin(index)[i]);
+        depths_.push_back(static_cast<std::uint32_t>(i + 1));
+        subtreeEnds_.push_back(0);
+        firstTerms_.push_back(static_cast<std::uint32_t>(terms_.size()));
+      }
+
+      // the term ends at the last node created so far, since all terms
+      // that are longer and start with it come after it
+      terms_.push_back(static_cast<std::uint32_t>(index));
+      maxDepth_ = std::max(maxDepth_, length);
+      previous = index;
+    }
+
+    for (std::uint32_t n : path) {
+      subtreeEnds_[n] = static_cast<std::uint32_t>(labels_.size());
+    }
+
+    firstTerms_.push_back(static_cast<std::uint32_t>(terms_.size()));
+  }
+
+  void report(std::size_t node, std::size_t distance, std::vector<LevenshteinMatch>& result) const {
+    for (std::size_t t = firstTerms_[node]; t < firstTerms_[node+1]; ++t) {
+      result.push_back(LevenshteinMatch { terms_[t], distance });
+    }
+  }
+
+  /**
+   * Bit i + 1 of the result is set iff q[i] == c.
+   */
+  class MatchMasks {
+  public:
+    MatchMasks(const std::vector<T>& q, std::true_type) : q_(q), peq_(q.begin(), q.end()) {}
+    MatchMasks(const std::vector<T>& q, std::false_type) : q_(q) {}
+
+    std::uint64_t get(const T& c, std::true_type) const {
+      return q_.empty() ? 0 : peq_.get(c)[0] << 1;
+    }
+
+    std::uint64_t get(const T& c, std::false_type) const {
+      std::uint64_t mask = 0;
+      for (std::size_t i = 0; i < q_.size(); ++i) {
+        mask |= std::uint64_t(q_[i] == c) << (i + 1);
+      }
+      return mask;
+    }
+
+  private:
+    const std::vector<T>& q_;
+    MyersPatternMatchVector<T> peq_;
+  };
+
+  template<typename IsIntegral>
+  void queryAutomaton(const std::vector<T>& q, std::size_t maxDist,
+    std::vector<LevenshteinMatch>& result, IsIntegral isIntegral) const {
+    const std::size_t m = q.size();
+    const std::size_t k = maxDist;
+    const std::uint64_t all = (std::uint64_t(2) << m) - 1;
+    const std::uint64_t accept = std::uint64_t(1) << m;
+    const MatchMasks masks(q, isIntegral);
+
+    // states[depth * (k + 1) + d]
+    std::vector<std::uint64_t> states((maxDepth_ + 1) * (k + 1));
+    for (std::size_t d = 0; d <= k; ++d) {
+      // deleting the first d elements of the query
+      states[d] = (std::uint64_t(2) << std::min(d, m)) - 1;
+    }
+
+    if (m <= k) {
+      report(0, m, result);
+    }
+
+    for (std::size_t n = 1; n < labels_.size();) {
+      const std::uint64_t* prev = &states[(depths_[n] - 1) * (k + 1)];
+      std::uint64_t* cur = &states[depths_[n] * (k + 1)];
+      const std::uint64_t match = masks.get(labels_[n], isIntegral);
+
+      cur[0] = (prev[0] << 1) & match;
+      for (std::size_t d = 1; d <= k; ++d) {
+        // match, insertion, substitution, deletion
+        cur[d] = (((prev[d] << 1) & match) | prev[d-1] | (prev[d-1] << 1) | (cur[d-1] << 1)) & all;
+      }
+
+      if (cur[k] == 0) {
+        n = subtreeEnds_[n];
+        continue;
+      }
+
+      if ((cur[k] & accept) && firstTerms_[n] != firstTerms_[n+1]) {
+        std::size_t d = 0;
+        while (!(cur[d] & accept)) {
+          ++d;
+        }
+        report(n, d, result);
+      }
+
+      ++n;
+    }
+  }
+
+  void queryRows(const std::vector<T>& q, std::size_t maxDist, std::vector<LevenshteinMatch>& result) const {
+    const std::size_t m = q.size();
+
+    // rows[depth * (m + 1) + i]
+    std::vector<std::size_t> rows((maxDepth_ + 1) * (m + 1));
+    for (std::size_t i = 0; i <= m; ++i) {
+      rows[i] = i;
+    }
+
+    if (m <= maxDist) {
+      report(0, m, result);
+    }
+
+    for (std::size_t n = 1; n < labels_.size();) {
+      const std::size_t* prev = &rows[(depths_[n] - 1) * (m + 1)];
+      std::size_t* cur = &rows[depths_[n] * (m + 1)];
+
+      cur[0] = depths_[n];
+      std::size_t min = cur[0];
+      for (std::size_t i = 1; i <= m; ++i) {
+        cur[i] = std::min(std::min(prev[i], cur[i-1]) + 1, prev[i-1] + !(q[i-1] == labels_[n]));
+        min = std::min(min, cur[i]);
+      }
+
+      if (min > maxDist) {
+        n = subtreeEnds_[n];
+        continue;
+      }
+
+      if (cur[m] <= maxDist) {
+        report(n, cur[m], result);
+      }
+
+      ++n;
+    }
+  }
+
+  std::vector<T> labels_;
+  std::vector<std::uint32_t> depths_;
+  std::vector<std::uint32_t> subtreeEnds_;
+  // the terms ending at node n are terms_[firstTerms_[n], firstTerms_[n+1])
+  std::vector<std::uint32_t> firstTerms_;
+  std::vector<std::uint32_t> terms_;
+  std::size_t maxDepth_;
+};
+
+/**
+ * The reversed sequence [a, aEnd) for LevenshteinAligner: a copy in the
+ * given input buffer of the workspace for pointers (so that the SIMD
+ * kernels can be used on it), a reverse iterator otherwise.
+ */
+template<typename Iterator, typename T = typename std::remove_cv<
+  typename std::iterator_traits<Iterator>::value_type>::type,
+  bool copy = std::is_pointer<Iterator>::value && std::is_trivially_copyable<T>::value>
+struct LevenshteinReversed {
+  typedef std::reverse_iterator<Iterator> Reversed;
+
+  static Reversed make(Iterator a, Iterator aEnd, LevenshteinWorkspace&, std::size_t) {
+    return Reversed(aEnd);
+  }
+};
+
+template<typename Iterator, typename T>
+struct LevenshteinReversed<Iterator, T, true> {
+  typedef const T* Reversed;
+
+  static Reversed make(Iterator a, Iterator aEnd, LevenshteinWorkspace& workspace,
+    std::size_t index) {
+    T* reversed = workspace.inputBuffer<T>(index, aEnd - a);
+    std::reverse_copy(a, aEnd, reversed);
+    return reversed;
+  }
+};
+
+/**
+ * Linear-space alignment, based on Hirschberg’s algorithm [4].
+ *
+ * An optimal path through the table crosses row mid = len(a) / 2 in some
+ * column j. The cost of the path up to [mid,j] is D[mid][j], i.e. an entry
+ * of the last row of the table of a[0, mid) and b, and the cost of the
+ * rest is an entry of the last row of the table of the reversed a[mid, len(a))
+ * and the reversed b. So j is the column where their sum is smallest,
+ * and the two halves of the table can be aligned independently.
+ *
+ * Both rows are computed by levenshteinDiagonalTile(), i.e. using the SIMD
+ * kernels for pointers to suitable types, and common prefixes and
+ * suffixes are skipped at every level. Small subproblems are solved
+ * directly using the full table. For pointers, reversed copies of a and b
+ * are kept in input buffers 0 and 1 of the workspace, so that the second
+ * row can be computed with pointers as well. Otherwise, a and b are read
+ * through reverse iterators.
+ *
+ * [4]: D. S. Hirschberg, A linear space algorithm for computing maximal
+ *      common subsequences, Comm. ACM 18 (1975)
+ */
+template<typename Iterator1, typename Iterator2>
+class LevenshteinAligner {
+public:
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  // Subproblems with at most this many table entries are solved directly.
+  static constexpr std::size_t maxDirectSize = 4096;
+
+  LevenshteinAligner(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+    LevenshteinWorkspace& workspace)
+    : a_(a), b_(b), aLen_(aEnd - a), bLen_(bEnd - b),
+      aReversed_(LevenshteinReversed<Iterator1>::make(a, aEnd, workspace, 0)),
+      bReversed_(LevenshteinReversed<Iterator2>::make(b, bEnd, workspace, 1)),
+      workspace_(workspace) {}
+
+  std::vector<EditRun> run() {
+    align(0, aLen_, 0, bLen_);
+    return std::move(script_);
+  }
+
+private:
+  void push(EditOperation operation, std::size_t length) {
+    if (length == 0) {
+      return;
+    }
+
+    if (!script_.empty() && script_.back().operation == operation) {
+      script_.back().length += length;
+    } else {
+      script_.push_back(EditRun { operation, length });
+    }
+  }
+
+  /**
+   * Append the edit operations for a[aLo, aHi) and b[bLo, bHi).
+   */
+  void align(std::size_t aLo, std::size_t aHi, std::size_t bLo, std::size_t bHi) {
+    // skip common prefixes and suffixes
+    std::size_t prefix = 0, suffix = 0;
+    while (aLo + prefix < aHi && bLo + prefix < bHi &&
+      levenshteinElementsEqual(a_[aLo + prefix], b_[bLo + prefix]))
+      ++prefix;
+
+    push(editMatch, prefix);
+    aLo += prefix;
+    bLo += prefix;
+
+    while (aLo < aHi - suffix && bLo < bHi - suffix &&
+      levenshteinElementsEqual(a_[aHi - suffix - 1], b_[bHi - suffix - 1]))
+      ++suffix;
+
+    aHi -= suffix;
+    bHi -= suffix;
+
+    const std::size_t h = aHi - aLo;
+    const std::size_t w = bHi - bLo;
+
+    if (h == 0) {
+      push(editInsert, w);
+    } else if (w == 0) {
+      push(editDelete, h);
+    } else if (h == 1 || w == 1 || (h + 1) * (w + 1) <= maxDirectSize) {
+      alignDirect(aLo, aHi, bLo, bHi);
+    } else {
+      const std::size_t mid = aLo + h / 2;
+      const std::size_t j = split(aLo, mid, aHi, bLo, bHi);
+      align(aLo, mid, bLo, j);
+      align(mid, aHi, j, bHi);
+    }
+
+    push(editMatch, suffix);
+  }
+
+  /**
+   * Use the full table, computed from the bottom right so that the
+   * operations can be read off starting at the top left.
+   */
+  void alignDirect(std::size_t aLo, std::size_t aHi, std::size_t bLo, std::size_t bHi) {
+    const std::size_t h = aHi - aLo;
+    const std::size_t w = bHi - bLo;
+    std::size_t* d = workspace_.buffer<std::size_t>(4, (h + 1) * (w + 1));
+
+    // d[i * (w + 1) + j] is the distance of a[aLo + i, aHi) and b[bLo + j, bHi)
+    for (std::size_t j = 0; j <= w; ++j)
+      d[h * (w + 1) + j] = w - j;
+
+    for (std::size_t i = h; i-- > 0; ) {
+      std::size_t* row = d + i * (w + 1);
+      const std::size_t* next = row + (w + 1);
+      row[w] = h - i;
+
+      for (std::size_t j = w; j-- > 0; ) {
+        row[j] = std::min(next[j + 1] + !levenshteinElementsEqual(a_[aLo + i], b_[bLo + j]),
+          std::min(next[j], row[j + 1]) + 1);
+      }
+    }
+
+    std::size_t i = 0, j = 0;
+    while (i < h || j < w) {
+      const std::size_t current = d[i * (w + 1) + j];
+
+      if (i < h && j < w) {
+        const bool equal = levenshteinElementsEqual(a_[aLo + i], b_[bLo + j]);
+        if (current == d[(i + 1) * (w + 1) + j + 1] + !equal) {
+          push(equal ? editMatch : editSubstitute, 1);
+          ++i, ++j;
+          continue;
+        }
+      }
+
+      if (i < h && current == d[(i + 1) * (w + 1) + j] + 1) {
+        push(editDelete, 1);
+        ++i;
+      } else {
+        push(editInsert, 1);
+        ++j;
+      }
+    }
+  }
+
+  /**
+   * Find the column in which an optimal path crosses row mid.
+   * All entries of both rows are <= len(a) + len(b), so use the
+   * narrowest cells they fit into.
+   */
+  std::size_t split(std::size_t aLo, std::size_t mid, std::size_t aHi,
+    std::size_t bLo, std::size_t bHi) {
+    const std::size_t size = (aHi - aLo) + (bHi - bLo);
+
+#ifdef LSTSSE_SSE4_1
+    if (size < std::numeric_limits<std::uint16_t>::max())
+      return split<std::uint16_t>(aLo, mid, aHi, bLo, bHi);
+#endif
+
+    if (size <= std::numeric_limits<std::uint32_t>::max())
+      return split<std::uint32_t>(aLo, mid, aHi, bLo, bHi);
+
+    return split<std::size_t>(aLo, mid, aHi, bLo, bHi);
+  }
+
+  template<typename Cell>
+  std::size_t split(std::size_t aLo, std::size_t mid, std::size_t aHi,
+    std::size_t bLo, std::size_t bHi) {
+    const std::size_t w = bHi - bLo;
+    const std::size_t h = std::max(mid - aLo, aHi - mid);
+
+    Cell* forward = workspace_.buffer<Cell>(2, w + 1);
+    Cell* backward = workspace_.buffer<Cell>(3, w + 1);
+    Cell* left = workspace_.buffer<Cell>(4, h + 1);
+    Cell* diag = workspace_.buffer<Cell>(0, h + 1);
+    Cell* diag2 = workspace_.buffer<Cell>(1, h + 1);
+
+    lastRow(a_ + aLo, a_ + mid, b_ + bLo, b_ + bHi, forward, left, diag, diag2);
+    lastRow(aReversed_ + (aLen_ - aHi), aReversed_ + (aLen_ - mid),
+      bReversed_ + (bLen_ - bHi), bReversed_ + (bLen_ - bLo),
+      backward, left, diag, diag2);
+
+    std::size_t best = 0;
+    std::size_t bestCost = std::numeric_limits<std::size_t>::max();
+    for (std::size_t j = 0; j <= w; ++j) {
+      const std::size_t cost = std::size_t(forward[j]) + backward[w - j];
+      if (cost < bestCost) {
+        best = j;
+        bestCost = cost;
+      }
+    }
+
+    return bLo + best;
+  }
+
+  template<typename Cell, typename It1, typename It2>
+  static void lastRow(It1 a, It1 aEnd, It2 b, It2 bEnd, Cell* row, Cell* left,
+    Cell* diag, Cell* diag2) {
+    for (std::size_t j = 0; j <= std::size_t(bEnd - b); ++j)
+      row[j] = Cell(j);
+    for (std::size_t i = 0; i <= std::size_t(aEnd - a); ++i)
+      left[i] = Cell(i);
+
+    levenshteinDiagonalTile<Cell>(a, aEnd, b, bEnd, row, left, diag, diag2);
+    // the tile does not write the corner entries of its edges
+    row[0] = Cell(aEnd - a);
+  }
+
+  const Iterator1 a_;
+  const Iterator2 b_;
+  const std::size_t aLen_, bLen_;
+  const typename LevenshteinReversed<Iterator1>::Reversed aReversed_;
+  const typename LevenshteinReversed<Iterator2>::Reversed bReversed_;
+  LevenshteinWorkspace& workspace_;
+  std::vector<EditRun> script_;
+};
+
+/**
+ * Preamble for levenshteinAlignment(), random access version.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<EditRun> levenshteinAlignment(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  return LevenshteinAligner<Iterator1, Iterator2>(a, aEnd, b, bEnd, workspace).run();
 }
 
-#ifdef __SSSE3__
-static inline void performSSE(const T* a, const T* b,
-  std::size_t& i, std::size_t j, std::size_t bLen,
-  std::uint32_t* diag, const std::uint32_t* diag2)
-{
-  const __m128i one128_epi32 = _mm_set1_epi32(1);
-  const __m128i reversedIdentity128_epi8 = _mm_setr_epi8(
-    15, 14, 13, 12,
-    11, 10,  9,  8,
-     7,  6,  5,  4,
-     3,  2,  1,  0
-  );
-  const __m128i reversedIdentity128_epi16 = _mm_setr_epi8(
-    14, 15, 12, 13,
-    10, 11,  8,  9,
-     6,  7,  4,  5,
-     2,  3,  0,  1
-  );
-  const __m128i blockwiseReversed128_epi8_4 = _mm_setr_epi8(
-     3,  2,  1,  0,
-     7,  6,  5,  4,
-    11, 10,  9,  8,
-    15, 14, 13, 12
-  );
-  const __m128i blockwiseReversed128_epi16_4 = _mm_setr_epi8(
-     6,  7,  4,  5,
-     2,  3,  0,  1,
-    14, 15, 12, 13,
-    10, 11,  8,  9
-  );
+/**
+ * Preamble for levenshteinAlignment(), non-random access version.
+ * The inputs are copied, which does not change the memory requirements.
+ */
+template<typename Iterator1, typename Iterator2>
+std::vector<EditRun> levenshteinAlignment(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  const std::vector<T1> a_(a, aEnd);
+  const std::vector<T2> b_(b, bEnd);
+  return levenshteinAlignment(a_.data(), a_.data() + a_.size(), b_.data(), b_.data() + b_.size(),
+    workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::vector<EditRun> levenshteinAlignment(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshteinAlignment(a, aEnd, b, bEnd, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::vector<EditRun> levenshteinAlignment(const Container1& a, const Container2& b) {
+  return levenshteinAlignment(a, b, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::vector<EditRun> levenshteinAlignment(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinAlignment(a, aEnd, b, bEnd, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Container1, typename Container2>
+std::vector<EditRun> levenshteinAlignment(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value> Range1;
+  typedef LevenshteinContainer<has_data_and_size<Container2>::value> Range2;
+  return levenshteinAlignment(Range1::begin(a), Range1::end(a), Range2::begin(b), Range2::end(b),
+    workspace);
+}
+
+/**
+ * Weighted edit distance, using the diagonal algorithm.
+ *
+ * The recurrence is the same as for levenshtein(), except that the costs
+ * of the operations are added to the three neighbouring entries:
+ *
+ *   D[i,j] = min(D[i,j-1] + insertion(b[j-1]), D[i-1,j] + deletion(a[i-1]),
+ *                D[i-1,j-1] + substitution(a[i-1], b[j-1]))
+ *
+ * i.e. diag[i] = min(diag2[i] + ..., diag2[i-1] + ..., diag[i-1] + ...)
+ * with the notation of levenshteinDiagonal(). Unlike there, the first row
+ * and column of the table are not just 0, 1, 2, ..., so their entries are
+ * computed along with each diagonal. All entries are 32 bits wide.
+ *
+ * The rows of one diagonal are computed by levenshteinWeightedRows(),
+ * which is overloaded for the instruction sets and cost models that
+ * have SIMD kernels; the generic version takes one entry at a time.
+ */
+template<typename Iterator1, typename Iterator2, typename Costs>
+inline void levenshteinWeightedRows(Iterator1 a, Iterator2 b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Costs& costs, std::uint32_t* diag,
+  const std::uint32_t* diag2, IsaScalar) {
+  for (std::size_t i = endRow; i >= startRow; --i) {
+    const std::size_t j = k - i;
+    diag[i] = std::min(std::min(diag2[i] + costs.insertion(b[j-1]), diag2[i-1] + costs.deletion(a[i-1])),
+      diag[i-1] + costs.substitution(a[i-1], b[j-1]));
+  }
+}
+
+template<typename T>
+struct HasWeightedKernel {
+  static constexpr bool value = std::is_integral<T>::value &&
+    (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4);
+};
+
+#ifdef LSTSSE_SSE4_1
+// Load 4 elements, zero-extended to 32 bits each
+template<typename T>
+LSTSSE_TARGET("sse4.1")
+inline __m128i loadWeightedSSE41(const T* p) {
+  if (sizeof(T) == 1) {
+    std::int32_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(x));
+  } else if (sizeof(T) == 2) {
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+  } else {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+}
+
+// rows i-3 .. i at once, see levenshteinDiagonal() for the loads of b
+template<typename T>
+LSTSSE_TARGET("sse4.1")
+inline typename std::enable_if<HasWeightedKernel<T>::value>::type
+levenshteinWeightedRows(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const LevenshteinWeights& costs, std::uint32_t* diag,
+  const std::uint32_t* diag2, IsaSSE41) {
+  const __m128i insertion = _mm_set1_epi32(costs.insertionCost);
+  const __m128i deletion = _mm_set1_epi32(costs.deletionCost);
+  const __m128i substitution = _mm_set1_epi32(costs.substitutionCost);
+
+  std::size_t i = endRow;
+  for (; i >= startRow + 3; i -= 4) {
+    const std::size_t j = k - i;
+    const __m128i a_ = loadWeightedSSE41(&a[i-4]);
+    const __m128i b_ = _mm_shuffle_epi32(loadWeightedSSE41(&b[j-1]), 0x1b);
+    const __m128i substitutionCost = _mm_andnot_si128(_mm_cmpeq_epi32(a_, b_), substitution);
+
+    const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag2[i-3]));
+    const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag2[i-4]));
+    const __m128i corner = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag[i-4]));
+    const __m128i result = _mm_min_epu32(
+      _mm_min_epu32(_mm_add_epi32(left, insertion), _mm_add_epi32(up, deletion)),
+      _mm_add_epi32(corner, substitutionCost));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&diag[i-3]), result);
+  }
+
+  if (i >= startRow) {
+    levenshteinWeightedRows(a, b, startRow, i, k, costs, diag, diag2, IsaScalar());
+  }
+}
+#endif // LSTSSE_SSE4_1
+
+#ifdef LSTSSE_AVX2
+// Load 8 elements, zero-extended to 32 bits each
+template<typename T>
+LSTSSE_TARGET("avx2")
+inline __m256i loadWeightedAVX2(const T* p) {
+  if (sizeof(T) == 1) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+  } else if (sizeof(T) == 2) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  } else {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+}
+
+// rows i-7 .. i at once; substitutionCost(a_, b_) computes the costs for
+// the (zero-extended) elements
+template<typename T, typename SubstitutionCost>
+LSTSSE_TARGET("avx2")
+inline std::size_t levenshteinWeightedRowsAVX2(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, std::uint32_t insertionCost, std::uint32_t deletionCost,
+  std::uint32_t* diag, const std::uint32_t* diag2, SubstitutionCost substitutionCost) {
+  const __m256i insertion = _mm256_set1_epi32(insertionCost);
+  const __m256i deletion = _mm256_set1_epi32(deletionCost);
+  const __m256i reversed = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+  std::size_t i = endRow;
+  for (; i >= startRow + 7; i -= 8) {
+    const std::size_t j = k - i;
+    const __m256i a_ = loadWeightedAVX2(&a[i-8]);
+    const __m256i b_ = _mm256_permutevar8x32_epi32(loadWeightedAVX2(&b[j-1]), reversed);
+
+    const __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag2[i-7]));
+    const __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag2[i-8]));
+    const __m256i corner = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag[i-8]));
+    const __m256i result = _mm256_min_epu32(
+      _mm256_min_epu32(_mm256_add_epi32(left, insertion), _mm256_add_epi32(up, deletion)),
+      _mm256_add_epi32(corner, substitutionCost(a_, b_)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&diag[i-7]), result);
+  }
+
+  return i;
+}
+
+struct FixedSubstitutionAVX2 {
+  __m256i substitution;
+
+  LSTSSE_TARGET("avx2")
+  __m256i operator()(__m256i a_, __m256i b_) const {
+    return _mm256_andnot_si256(_mm256_cmpeq_epi32(a_, b_), substitution);
+  }
+};
+
+struct TableSubstitutionAVX2 {
+  const int* table;
+
+  LSTSSE_TARGET("avx2")
+  __m256i operator()(__m256i a_, __m256i b_) const {
+    return _mm256_i32gather_epi32(table, _mm256_add_epi32(_mm256_slli_epi32(a_, 8), b_), 4);
+  }
+};
+
+template<typename T>
+LSTSSE_TARGET("avx2")
+inline typename std::enable_if<HasWeightedKernel<T>::value>::type
+levenshteinWeightedRows(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const LevenshteinWeights& costs, std::uint32_t* diag,
+  const std::uint32_t* diag2, IsaAVX2) {
+  const FixedSubstitutionAVX2 substitution = { _mm256_set1_epi32(costs.substitutionCost) };
+  const std::size_t i = levenshteinWeightedRowsAVX2(a, b, startRow, endRow, k,
+    costs.insertionCost, costs.deletionCost, diag, diag2, substitution);
+
+  if (i >= startRow) {
+    levenshteinWeightedRows(a, b, startRow, i, k, costs, diag, diag2, IsaScalar());
+  }
+}
+
+// looks up the costs in the table with a gather
+template<typename T>
+LSTSSE_TARGET("avx2")
+inline typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 1>::type
+levenshteinWeightedRows(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const LevenshteinCostTable& costs, std::uint32_t* diag,
+  const std::uint32_t* diag2, IsaAVX2) {
+  const TableSubstitutionAVX2 substitution = { reinterpret_cast<const int*>(costs.table()) };
+  const std::size_t i = levenshteinWeightedRowsAVX2(a, b, startRow, endRow, k,
+    costs.insertion(a[0]), costs.deletion(a[0]), diag, diag2, substitution);
+
+  if (i >= startRow) {
+    levenshteinWeightedRows(a, b, startRow, i, k, costs, diag, diag2, IsaScalar());
+  }
+}
+#endif // LSTSSE_AVX2
+
+template<typename Iterator1, typename Iterator2, typename Costs>
+struct LevenshteinWeightedStep {
+typedef void (*Function)(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Costs& costs, std::uint32_t* diag, const std::uint32_t* diag2);
+
+static void runScalar(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Costs& costs, std::uint32_t* diag, const std::uint32_t* diag2) {
+  levenshteinWeightedRows(a, b, startRow, endRow, k, costs, diag, diag2, IsaScalar());
+}
+
+#ifdef LSTSSE_SSE4_1
+LSTSSE_TARGET("sse4.1") LSTSSE_FLATTEN
+static void runSSE41(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Costs& costs, std::uint32_t* diag, const std::uint32_t* diag2) {
+  levenshteinWeightedRows(a, b, startRow, endRow, k, costs, diag, diag2, IsaSSE41());
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2") LSTSSE_FLATTEN
+static void runAVX2(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Costs& costs, std::uint32_t* diag, const std::uint32_t* diag2) {
+  levenshteinWeightedRows(a, b, startRow, endRow, k, costs, diag, diag2, IsaAVX2());
+}
+#endif
+
+static Function select() {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return &runAVX2;
+#endif
+#ifdef LSTSSE_SSE4_1
+  if (cpuLevel() >= cpuSSE41)
+    return &runSSE41;
+#endif
+  return &runScalar;
+}
+};
+
+/**
+ * Outer loop of the weighted diagonal algorithm, for random access
+ * iterators. diag and diag2 need room for len(a) + 1 entries each.
+ */
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeightedDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs, std::uint32_t* diag, std::uint32_t* diag2) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+  const typename LevenshteinWeightedStep<Iterator1, Iterator2, Costs>::Function step =
+    LevenshteinWeightedStep<Iterator1, Iterator2, Costs>::select();
+
+  diag2[0] = 0;
+
+  for (std::size_t k = 1; k <= aLen + bLen; ++k) {
+    const std::size_t startRow = k > bLen ? k - bLen : 1;
+    const std::size_t endRow = std::min(k - 1, aLen);
+    if (startRow <= endRow) {
+      step(a, b, startRow, endRow, k, costs, diag, diag2);
+    }
+
+    // the first column and the first row; diag[0] is only overwritten
+    // here since row 1 still needs its old value
+    if (k <= aLen) {
+      diag[k] = diag2[k-1] + costs.deletion(a[k-1]);
+    }
+
+    if (k <= bLen) {
+      diag[0] = diag2[0] + costs.insertion(b[k-1]);
+    }
+
+    std::swap(diag, diag2);
+  }
+
+  return diag2[aLen];
+}
+
+/**
+ * Whether common prefixes and suffixes can be skipped, which is the case
+ * if matching elements cost nothing and insertions and deletions have
+ * fixed costs.
+ */
+template<typename Costs>
+struct LevenshteinSkipsAffixes {
+  static constexpr bool value = std::is_same<Costs, LevenshteinWeights>::value ||
+    std::is_same<Costs, LevenshteinCostTable>::value;
+};
+
+/**
+ * Preamble for levenshteinWeighted(), random access version.
+ */
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs, LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  if (LevenshteinSkipsAffixes<Costs>::value) {
+    levenshteinSkipAffixes(a, aEnd, b, bEnd);
+  }
+
+  const std::size_t aLen = aEnd - a;
+  return levenshteinWeightedDiagonal(a, aEnd, b, bEnd, costs,
+    workspace.buffer<std::uint32_t>(0, aLen + 1), workspace.buffer<std::uint32_t>(1, aLen + 1));
+}
+
+/**
+ * Preamble for levenshteinWeighted(), non-random access version.
+ */
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs, LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  const std::vector<T1> a_(a, aEnd);
+  const std::vector<T2> b_(b, bEnd);
+  return levenshteinWeighted(a_.data(), a_.data() + a_.size(), b_.data(), b_.data() + b_.size(),
+    costs, workspace);
+}
+
+/**
+ * Unit costs use the unweighted algorithms.
+ */
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const LevenshteinUnitCosts&, LevenshteinWorkspace& workspace) {
+  return levenshtein(a, aEnd, b, bEnd, workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const LevenshteinWeights& costs, LevenshteinWorkspace& workspace) {
+  if (costs.insertionCost == 1 && costs.deletionCost == 1 && costs.substitutionCost == 1) {
+    return levenshtein(a, aEnd, b, bEnd, workspace);
+  }
+
+  return levenshteinWeighted(a, aEnd, b, bEnd, costs, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs, LevenshteinWorkspace& workspace) {
+  return levenshteinWeighted(a, aEnd, b, bEnd, costs, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Iterator1, typename Iterator2, typename Costs>
+std::size_t levenshteinWeighted(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  const Costs& costs) {
+  return levenshteinWeighted(a, aEnd, b, bEnd, costs, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2, typename Costs>
+std::size_t levenshteinWeighted(const Container1& a, const Container2& b, const Costs& costs) {
+  return levenshteinWeighted(a, b, costs, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2, typename Costs>
+std::size_t levenshteinWeighted(const Container1& a, const Container2& b, const Costs& costs,
+  LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value> Range1;
+  typedef LevenshteinContainer<has_data_and_size<Container2>::value> Range2;
+  return levenshteinWeighted(Range1::begin(a), Range1::end(a), Range2::begin(b), Range2::end(b),
+    costs, workspace);
+}
+/**
+ * Optimal string alignment distance
+ *
+ * The table gets one more candidate for each entry, the transposition
+ * of a[i-2..i-1] and b[j-2..j-1]:
+ *
+ *   D[i,j] = min(<same as for levenshtein()>,
+ *                D[i-2,j-2] + 1 if a[i-1] == b[j-2] and a[i-2] == b[j-1])
+ *
+ * For the bit-parallel variant, this is Hyyrö’s extension [3] of the
+ * algorithm above: a transposition at row i is possible where row i-1
+ * matched b[j-1], row i matches b[j-2] and the diagonal difference at
+ * row i-1 in the previous column was +1, which adds the bit vector
+ *
+ *   TR = (((~D0') & PM[b[j-1]]) << 1) & PM[b[j-2]]
+ *
+ * (with D0' the D0 vector of the previous column) to D0. Like VP and
+ * VN, D0' is kept per block for the blocked variant, and the bit
+ * shifted out of the previous block is carried into the next one.
+ */
+template<typename PatternMatchVector, typename Iterator2>
+std::size_t levenshteinOSAHyyro64(const PatternMatchVector& peq, std::size_t aLen,
+  Iterator2 b, Iterator2 bEnd) {
+  assert(0 < aLen && aLen <= 64);
+  assert(peq.words() == 1);
+
+  const std::uint64_t last = std::uint64_t(1) << (aLen - 1);
+  std::uint64_t vp = ~std::uint64_t(0);
+  std::uint64_t vn = 0;
+  std::uint64_t d0 = 0;
+  std::uint64_t xPrev = 0;
+  std::size_t score = aLen;
+
+  for (; b != bEnd; ++b) {
+    const std::uint64_t x = *peq.get(*b);
+    const std::uint64_t tr = (((~d0) & x) << 1) & xPrev;
+    d0 = (((x & vp) + vp) ^ vp) | x | vn | tr;
+    std::uint64_t hp = vn | ~(d0 | vp);
+    std::uint64_t hn = d0 & vp;
+
+    score += (hp & last) != 0;
+    score -= (hn & last) != 0;
+
+    hp = (hp << 1) | 1;
+    hn = (hn << 1);
+    vp = hn | ~(d0 | hp);
+    vn = hp & d0;
+    xPrev = x;
+  }
+
+  return score;
+}
+
+/**
+ * Blocked variant for len(a) > 64. vp, vn and d0 need to point to
+ * peq.words() words of scratch space each.
+ */
+template<typename PatternMatchVector, typename Iterator2>
+std::size_t levenshteinOSAHyyroBlocked(const PatternMatchVector& peq, std::size_t aLen,
+  Iterator2 b, Iterator2 bEnd, std::uint64_t* vp, std::uint64_t* vn, std::uint64_t* d0) {
+  const std::size_t words = peq.words();
+
+  assert(0 < aLen);
+  assert(words == (aLen + 63) / 64);
+
+  const std::uint64_t last = std::uint64_t(1) << ((aLen - 1) % 64);
+  std::fill(vp, vp + words, ~std::uint64_t(0));
+  std::fill(vn, vn + words, std::uint64_t(0));
+  std::fill(d0, d0 + words, std::uint64_t(0));
+  std::size_t score = aLen;
+  // PM[b[j-2]], all zeros for the first column
+  const std::uint64_t* eqPrev = nullptr;
+
+  for (; b != bEnd; ++b) {
+    const std::uint64_t* eq = peq.get(*b);
+    std::uint64_t hpCarry = 1;
+    std::uint64_t hnCarry = 0;
+    std::uint64_t trCarry = 0;
+
+    for (std::size_t w = 0; w < words; ++w) {
+      const std::uint64_t notD0AndEq = ~d0[w] & eq[w];
+      const std::uint64_t tr = eqPrev ? ((notD0AndEq << 1) | trCarry) & eqPrev[w] : 0;
+      trCarry = notD0AndEq >> 63;
+
+      const std::uint64_t x = eq[w] | hnCarry;
+      const std::uint64_t d0_ = (((x & vp[w]) + vp[w]) ^ vp[w]) | x | vn[w] | tr;
+      std::uint64_t hp = vn[w] | ~(d0_ | vp[w]);
+      std::uint64_t hn = d0_ & vp[w];
+
+      if (w == words - 1) {
+        score += (hp & last) != 0;
+        score -= (hn & last) != 0;
+      }
+
+      const std::uint64_t hpOut = hp >> 63;
+      const std::uint64_t hnOut = hn >> 63;
+      hp = (hp << 1) | hpCarry;
+      hn = (hn << 1) | hnCarry;
+      vp[w] = hn | ~(d0_ | hp);
+      vn[w] = hp & d0_;
+      d0[w] = d0_;
+      hpCarry = hpOut;
+      hnCarry = hnOut;
+    }
+
+    eqPrev = eq;
+  }
+
+  return score;
+}
+
+/**
+ * Rows startRow .. endRow of diagonal k for the diagonal variant.
+ *
+ * D[i-2,j-2] lies on diagonal k-4, so four diagonals are kept: diag2
+ * is k-1 and diag is k-2 like for levenshteinDiagonal(), and diag4 is
+ * k-4, which is overwritten with diagonal k (row i is written after
+ * rows < i are done reading index i-2 of it, since the rows are still
+ * handled in descending order).
+ */
+template<typename Iterator1, typename Iterator2, typename Cell>
+inline void levenshteinOSARows(Iterator1 a, Iterator2 b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4,
+  IsaScalar) {
+  for (std::size_t i = endRow; i >= startRow; --i) {
+    const std::size_t j = k - i;
+    Cell result = std::min(Cell(std::min(diag2[i], diag2[i-1]) + 1),
+      Cell(diag[i-1] + (a[i-1] != b[j-1])));
+    if (i >= 2 && j >= 2 && a[i-1] == b[j-2] && a[i-2] == b[j-1]) {
+      result = std::min(result, Cell(diag4[i-2] + 1));
+    }
+    diag4[i] = result;
+  }
+}
+
+template<typename T, typename Cell>
+struct HasOSAKernel {
+  static constexpr bool value = std::is_scalar<T>::value &&
+    (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4) &&
+    (std::is_same<Cell, std::uint8_t>::value || std::is_same<Cell, std::uint16_t>::value);
+};
+
+/**
+ * SIMD variant, using the narrow cell kernels (Ops is
+ * LevenshteinNarrowSSE or LevenshteinNarrowAVX2). The transposition
+ * needs rows >= 2 and columns >= 2, so the rows outside of that are
+ * left to the scalar variant.
+ */
+template<typename Ops, typename T, typename Cell>
+inline void levenshteinOSARowsSIMD(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4) {
+  const std::size_t lanes = Ops::lanes;
+
+  // rows with j < 2 first
+  std::size_t i = endRow;
+  if (k - i < 2) {
+    const std::size_t last = std::max(startRow, k - 1);
+    levenshteinOSARows(a, b, last, i, k, diag, diag2, diag4, IsaScalar());
+    i = last - 1;
+  }
+
+  for (; i >= startRow + lanes - 1 && i > lanes; i -= lanes) {
+    Ops::stepOSA(a, b, i, k - i, diag, diag2, diag4);
+  }
+
+  if (i >= startRow) {
+    levenshteinOSARows(a, b, startRow, i, k, diag, diag2, diag4, IsaScalar());
+  }
+}
+
+#ifdef LSTSSE_SSE4_1
+template<typename T, typename Cell>
+inline typename std::enable_if<HasOSAKernel<T, Cell>::value>::type
+levenshteinOSARows(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4,
+  IsaSSE41) {
+  levenshteinOSARowsSIMD<LevenshteinNarrowSSE<Cell>>(a, b, startRow, endRow, k,
+    diag, diag2, diag4);
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+template<typename T, typename Cell>
+inline typename std::enable_if<HasOSAKernel<T, Cell>::value>::type
+levenshteinOSARows(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4,
+  IsaAVX2) {
+  levenshteinOSARowsSIMD<LevenshteinNarrowAVX2<Cell>>(a, b, startRow, endRow, k,
+    diag, diag2, diag4);
+}
+#endif
+
+template<typename Iterator1, typename Iterator2, typename Cell>
+struct LevenshteinOSAStep {
+typedef void (*Function)(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4);
+
+static void runScalar(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4) {
+  levenshteinOSARows(a, b, startRow, endRow, k, diag, diag2, diag4, IsaScalar());
+}
+
+#ifdef LSTSSE_SSE4_1
+LSTSSE_TARGET("sse4.1") LSTSSE_FLATTEN
+static void runSSE41(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4) {
+  levenshteinOSARows(a, b, startRow, endRow, k, diag, diag2, diag4, IsaSSE41());
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2") LSTSSE_FLATTEN
+static void runAVX2(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, Cell* diag4) {
+  levenshteinOSARows(a, b, startRow, endRow, k, diag, diag2, diag4, IsaAVX2());
+}
+#endif
+
+static Function select() {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return &runAVX2;
+#endif
+#ifdef LSTSSE_SSE4_1
+  if (cpuLevel() >= cpuSSE41)
+    return &runSSE41;
+#endif
+  return &runScalar;
+}
+};
+
+/**
+ * Outer loop of the diagonal variant. buffers needs to hold four
+ * scratch buffers with room for len(a) + 1 entries each.
+ */
+template<typename Cell, typename Iterator1, typename Iterator2>
+std::size_t levenshteinOSADiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  Cell* buffers[4]) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+  const typename LevenshteinOSAStep<Iterator1, Iterator2, Cell>::Function step =
+    LevenshteinOSAStep<Iterator1, Iterator2, Cell>::select();
 
-  __m128i substitutionCost32[4];
-  std::size_t k;
-  
-  // We support 1, 2, and 4 byte objects for SSE comparison.
-  // We always process 16 entries at once, so we may need multiple fetches
-  // depending on object size.
-  if (sizeof(T) <= 2) {
-    __m128i substitutionCost16LX, substitutionCost16HX;
-    
-    if (sizeof(T) == 1) {
-      __m128i a_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-16]));
-      __m128i b_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-1]));
-      a_ = _mm_shuffle_epi8(a_, reversedIdentity128_epi8);
-      
-      // int substitutionCost = a[i-1] == b[j-1] ? -1 : 0;
-      
-      // diag/diag2 will contain the following entries from the diagonal:
-      // index  [0]0 [0]1 [0]2 [0]3 [1]0 [1]1 [1]2 [1]3 ... [4]0 [4]1 [4]2 [4]3
-      // diag+i   -3   -2   -1    0   -7   -6   -5   -4 ...  -19  -18  -17  -16
-      
-      // substitutionCost8 contains the comparisons for the following indices in a and b:
-      // index  0   1   2   3   4   5   6   7   8   9  10  11  12  13  14  15
-      // a+i   -1  -2  -3  -4  -5  -6  -7  -8  -9 -10 -11 -12 -13 -14 -15 -16
-      // b+j   -1   0   1   2   3   4   5   6   7   8   9  10  11  12  13  14
-      // in substitutionCost8X we shuffle this so that it matches up with diag/diag2
-      // (barring the offset induces by comparing i-1 against j-1)
-      __m128i substitutionCost8 = _mm_cmpeq_epi8(a_, b_);
-      __m128i substitutionCost8X = _mm_shuffle_epi8(substitutionCost8, blockwiseReversed128_epi8_4);
-      // unpack with self so that 00 -> 00 00 and ff -> ff ff
-      substitutionCost16LX = _mm_unpacklo_epi8(substitutionCost8X, substitutionCost8X);
-      substitutionCost16HX = _mm_unpackhi_epi8(substitutionCost8X, substitutionCost8X);
-    } else {
-      __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-8]));
-      __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-16]));
-      __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-1]));
-      __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j+7]));
-      a0 = _mm_shuffle_epi8(a0, reversedIdentity128_epi16);
-      a1 = _mm_shuffle_epi8(a1, reversedIdentity128_epi16);
-      __m128i substitutionCost16L = _mm_cmpeq_epi16(a0, b0);
-      __m128i substitutionCost16H = _mm_cmpeq_epi16(a1, b1);
-      substitutionCost16LX = _mm_shuffle_epi8(substitutionCost16L, blockwiseReversed128_epi16_4);
-      substitutionCost16HX = _mm_shuffle_epi8(substitutionCost16H, blockwiseReversed128_epi16_4);
+  // diagonals k-1, k-2, k-3 and k-4
+  Cell* diag2 = buffers[0];
+  Cell* diag = buffers[1];
+  Cell* diag3 = buffers[2];
+  Cell* diag4 = buffers[3];
+  diag2[0] = 0;
+
+  for (std::size_t k = 1; k <= aLen + bLen; ++k) {
+    const std::size_t startRow = k > bLen ? k - bLen : 1;
+    const std::size_t endRow = std::min(k - 1, aLen);
+    if (startRow <= endRow) {
+      step(a, b, startRow, endRow, k, diag, diag2, diag4);
     }
-    
-    substitutionCost32[0] = _mm_unpacklo_epi16(substitutionCost16LX, substitutionCost16LX);
-    substitutionCost32[1] = _mm_unpackhi_epi16(substitutionCost16LX, substitutionCost16LX);
-    substitutionCost32[2] = _mm_unpacklo_epi16(substitutionCost16HX, substitutionCost16HX);
-    substitutionCost32[3] = _mm_unpackhi_epi16(substitutionCost16HX, substitutionCost16HX);
-  } else {
-    assert(sizeof(T) == 4);
-    
-    for (k = 0; k < 4; ++k) {
-      __m128i a_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i-4-k*4]));
-      __m128i b_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-1+k*4]));
-      b_ = _mm_shuffle_epi32(b_, 0x1b); // simple reverse
-      substitutionCost32[k] = _mm_cmpeq_epi32(a_, b_);
+
+    diag4[0] = Cell(k);
+    if (k <= aLen) {
+      diag4[k] = Cell(k);
     }
+
+    Cell* next = diag4;
+    diag4 = diag3;
+    diag3 = diag;
+    diag = diag2;
+    diag2 = next;
   }
-  
-  __m128i diag_[5], diag2_[5];
-  for (k = 0; k < 5; ++k) {
-    diag_ [k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag [i-3-k*4]));
+
+  return diag2[aLen];
+}
+
+/**
+ * Damerau–Levenshtein distance
+ *
+ * This is the linear space variant of the Lowrance–Wagner algorithm by
+ * Zhao and Sahni [7], computed row by row. A transposition at [i,j]
+ * goes back to the last row k < i with a[k-1] == b[j-1] and the last
+ * column l < j with a[i-1] == b[l-1], and costs
+ * D[k-1,l-1] + (i - k - 1) + 1 + (j - l - 1); it only needs to be
+ * considered if k == i - 1 or l == j - 1, in which case D[k-1,l-1] is
+ * available from the row two above (saved as fr[j] when the match in
+ * row k - 1 was seen) or from the previous row (saved as t).
+ *
+ * The last row with a[k-1] == b[j-1] is kept per column j in lastRow[],
+ * so that the elements only need to be compared for equality.
+ *
+ * [7]: C. Zhao, S. Sahni, String correction using the Damerau-Levenshtein
+ *      distance, BMC Bioinformatics 20 (2019)
+ */
+template<typename Cell, typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerauZhao(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  Cell* buffers[4]) {
+  typedef typename std::make_signed<Cell>::type Signed;
+  const Signed aLen = aEnd - a;
+  const Signed bLen = bEnd - b;
+  const Cell outside = Cell(std::max(aLen, bLen) + 1);
+
+  // all arrays start at index -1
+  Cell* r = buffers[0] + 1;
+  Cell* r1 = buffers[1] + 1;
+  Cell* fr = buffers[2] + 1;
+  Signed* lastRow = reinterpret_cast<Signed*>(buffers[3]);
+
+  r[-1] = outside;
+  for (Signed j = 0; j <= bLen; ++j) {
+    r[j] = Cell(j);
   }
-  for (k = 0; k < 5; ++k) {
-    diag2_[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&diag2[i-3-k*4]));
+  std::fill(r1 - 1, r1 + bLen + 1, outside);
+  std::fill(fr - 1, fr + bLen + 1, outside);
+  std::fill(lastRow, lastRow + bLen, Signed(-1));
+
+  for (Signed i = 1; i <= aLen; ++i) {
+    std::swap(r, r1);
+    Signed lastColumn = -1;
+    Cell lastLeft = r[0];
+    Cell t = outside;
+    r[0] = Cell(i);
+
+    for (Signed j = 1; j <= bLen; ++j) {
+      const bool match = a[i-1] == b[j-1];
+      Cell result = std::min(Cell(std::min(r[j-1], r1[j]) + 1), Cell(r1[j-1] + !match));
+
+      if (match) {
+        lastColumn = j;
+        fr[j] = r1[j-2];
+        t = lastLeft;
+        lastRow[j-1] = i;
+      } else {
+        const Signed k = lastRow[j-1];
+        if (j - lastColumn == 1) {
+          result = std::min(result, Cell(fr[j] + (i - k)));
+        } else if (i - k == 1) {
+          result = std::min(result, Cell(t + (j - lastColumn)));
+        }
+      }
+
+      lastLeft = r[j];
+      r[j] = result;
+    }
   }
-  
-  // There’s a ton of debug stuff down here. You can use it for reference
-  // or, of course, compile with -DLSTSSE_DEBUG if you’re feeling funny.
-#ifdef LSTSSE_DEBUG
-  for (k = 0; k < 5; ++k) {
-    std::uint32_t diag0 = _mm_extract_epi32(diag_[k], 0);
-    std::uint32_t diag1 = _mm_extract_epi32(diag_[k], 1);
-    std::uint32_t diag2 = _mm_extract_epi32(diag_[k], 2);
-    std::uint32_t diag3 = _mm_extract_epi32(diag_[k], 3);
-    assert(diag0 == diag[i-k*4-3]);
-    assert(diag1 == diag[i-k*4-2]);
-    assert(diag2 == diag[i-k*4-1]);
-    assert(diag3 == diag[i-k*4-0]);
+
+  return r[bLen];
+}
+
+/**
+ * Damerau–Levenshtein distance, diagonal variant
+ *
+ * The same recurrence as levenshteinDamerauZhao(), along the diagonals:
+ * they are first computed like in levenshteinOSADiagonal() (with the
+ * same kernels), and then the two other transposition candidates are
+ * added:
+ *
+ * - if a[i-1] == b[j-2]: D[k-1,j-2] + (i - k), where k and D[k-1,j-2]
+ *   were saved for column j at the last match in it
+ * - if a[i-2] == b[j-1]: D[i-2,l-1] + (j - l), where l and D[i-2,l-1]
+ *   were saved for row i at the last match in it
+ *
+ * The saved entries lie three diagonals before the match, so they are
+ * still around when it is seen. Each entry only reads and writes the
+ * state of its own row and column, so the entries of a diagonal are
+ * independent, and with the column state stored backwards, both run
+ * along the lanes of the SIMD variant. All state fits into a Cell; the
+ * saved entries start out as its maximum, which saturates.
+ *
+ * Without SIMD, this is slower than levenshteinDamerauZhao(), which only
+ * needs to keep a single entry per column.
+ */
+template<typename Cell>
+struct LevenshteinDamerauState {
+  std::size_t bLen;
+  // per column j, at index bLen - j
+  Cell* lastRow;
+  Cell* fromRow;
+  // per row i
+  Cell* lastColumn;
+  Cell* fromColumn;
+};
+
+/**
+ * Rows startRow .. endRow of diagonal k, after levenshteinOSARows():
+ * diag3 holds diagonal k-3 and diag4 diagonal k.
+ */
+template<typename Iterator1, typename Iterator2, typename Cell>
+inline void levenshteinDamerauRows(Iterator1 a, Iterator2 b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Cell* diag3, Cell* diag4,
+  const LevenshteinDamerauState<Cell>& state, IsaScalar) {
+  for (std::size_t i = endRow; i >= startRow; --i) {
+    const std::size_t j = k - i;
+    const std::size_t column = state.bLen - j;
+    std::size_t result = diag4[i];
+    if (j >= 2 && state.lastRow[column] != 0 && levenshteinElementsEqual(a[i-1], b[j-2])) {
+      result = std::min(result, std::size_t(state.fromRow[column]) + (i - state.lastRow[column]));
+    }
+    if (i >= 2 && state.lastColumn[i] != 0 && levenshteinElementsEqual(a[i-2], b[j-1])) {
+      result = std::min(result, std::size_t(state.fromColumn[i]) + (j - state.lastColumn[i]));
+    }
+    diag4[i] = Cell(result);
+
+    // (D[i-1,j-2] is only read for j >= 2, D[i-2,j-1] for i >= 2)
+    if (levenshteinElementsEqual(a[i-1], b[j-1])) {
+      state.lastRow[column] = Cell(i);
+      state.fromRow[column] = diag3[i-1];
+      state.lastColumn[i] = Cell(j);
+      state.fromColumn[i] = i >= 2 ? diag3[i-2] : 0;
+    }
   }
-  for (k = 0; k < 5; ++k) {
-    std::uint32_t diag20 = _mm_extract_epi32(diag2_[k], 0);
-    std::uint32_t diag21 = _mm_extract_epi32(diag2_[k], 1);
-    std::uint32_t diag22 = _mm_extract_epi32(diag2_[k], 2);
-    std::uint32_t diag23 = _mm_extract_epi32(diag2_[k], 3);
-    assert(diag20 == diag2[i-k*4-3]);
-    assert(diag21 == diag2[i-k*4-2]);
-    assert(diag22 == diag2[i-k*4-1]);
-    assert(diag23 == diag2[i-k*4-0]);
+}
+
+/**
+ * SIMD variant, like levenshteinOSARowsSIMD().
+ */
+template<typename Ops, typename T, typename Cell>
+inline void levenshteinDamerauRowsSIMD(const T* a, const T* b, std::size_t startRow,
+  std::size_t endRow, std::size_t k, const Cell* diag3, Cell* diag4,
+  const LevenshteinDamerauState<Cell>& state) {
+  const std::size_t lanes = Ops::lanes;
+
+  // rows with j < 2 first
+  std::size_t i = endRow;
+  if (k - i < 2) {
+    const std::size_t last = std::max(startRow, k - 1);
+    levenshteinDamerauRows(a, b, last, i, k, diag3, diag4, state, IsaScalar());
+    i = last - 1;
   }
-  
-  for (k = 0; k < 4; ++k) {
-    int sc0 = _mm_extract_epi32(substitutionCost32[k], 0);
-    int sc1 = _mm_extract_epi32(substitutionCost32[k], 1);
-    int sc2 = _mm_extract_epi32(substitutionCost32[k], 2);
-    int sc3 = _mm_extract_epi32(substitutionCost32[k], 3);
-    assert(sc0 == ((a[i-1-k*4-3] == b[j-1+k*4+3]) ? -1 : 0));
-    assert(sc1 == ((a[i-1-k*4-2] == b[j-1+k*4+2]) ? -1 : 0));
-    assert(sc2 == ((a[i-1-k*4-1] == b[j-1+k*4+1]) ? -1 : 0));
-    assert(sc3 == ((a[i-1-k*4-0] == b[j-1+k*4+0]) ? -1 : 0));
+
+  for (; i >= startRow + lanes - 1 && i > lanes; i -= lanes) {
+    const std::size_t row = i - lanes + 1;
+    const std::size_t column = state.bLen - (k - row);
+    Ops::stepDamerau(a, b, i, k - i, diag3, diag4, &state.lastRow[column],
+      &state.fromRow[column], &state.lastColumn[row], &state.fromColumn[row]);
   }
-#endif // LSTSSE_DEBUG
 
-  // reminders:
-  // the arrays (diag, diag2, substitutionCost32) correspond to i:
-  // index  [0]0 [0]1 [0]2 [0]3 [1]0 [1]1 [1]2 [1]3 ... [4]0 [4]1 [4]2 [4]3
-  // i+       -3   -2   -1    0   -7   -6   -5   -4 ...  -19  -18  -17  -16
-  // so when we need to access ...[i-1], we need to align the entries
-  // in *reverse* order
-  
-  // diag[i] = min(
-  //  diag2[i-1],
-  //  diag2[i],
-  //  diag[i-1] + substitutionCost
-  // ) + 1;
-  // 
-  for (k = 0; k < 4; ++k) {
-    __m128i diag2_i_m1 = _mm_alignr_epi8(diag2_[k], diag2_[k+1], 12);
-    __m128i diag_i_m1  = _mm_alignr_epi8(diag_ [k], diag_ [k+1], 12);
-    
-    __m128i result3 = _mm_add_epi32(diag_i_m1,  substitutionCost32[k]);
-    __m128i min = _mm_min_epi32(_mm_min_epi32(diag2_i_m1, diag2_[k]), result3);
-    min = _mm_add_epi32(min, one128_epi32);
-    
-#ifdef LSTSSE_DEBUG
-    std::uint32_t diag_i_m10 = _mm_extract_epi32(diag_i_m1, 0);
-    std::uint32_t diag_i_m11 = _mm_extract_epi32(diag_i_m1, 1);
-    std::uint32_t diag_i_m12 = _mm_extract_epi32(diag_i_m1, 2);
-    std::uint32_t diag_i_m13 = _mm_extract_epi32(diag_i_m1, 3);
-    assert(diag_i_m10 == diag[i-k*4-4]);
-    assert(diag_i_m11 == diag[i-k*4-3]);
-    assert(diag_i_m12 == diag[i-k*4-2]);
-    assert(diag_i_m13 == diag[i-k*4-1]);
-    
-    std::uint32_t diag2_i_m10 = _mm_extract_epi32(diag2_i_m1, 0);
-    std::uint32_t diag2_i_m11 = _mm_extract_epi32(diag2_i_m1, 1);
-    std::uint32_t diag2_i_m12 = _mm_extract_epi32(diag2_i_m1, 2);
-    std::uint32_t diag2_i_m13 = _mm_extract_epi32(diag2_i_m1, 3);
-    assert(diag2_i_m10 == diag2[i-k*4-4]);
-    assert(diag2_i_m11 == diag2[i-k*4-3]);
-    assert(diag2_i_m12 == diag2[i-k*4-2]);
-    assert(diag2_i_m13 == diag2[i-k*4-1]);
-    
-    std::uint32_t result30 = _mm_extract_epi32(result3, 0);
-    std::uint32_t result31 = _mm_extract_epi32(result3, 1);
-    std::uint32_t result32 = _mm_extract_epi32(result3, 2);
-    std::uint32_t result33 = _mm_extract_epi32(result3, 3);
-    
-    assert(result30 == diag[i-1-k*4-3] + ((a[i-1-k*4-3] == b[j-1+k*4+3]) ? -1 : 0));
-    assert(result31 == diag[i-1-k*4-2] + ((a[i-1-k*4-2] == b[j-1+k*4+2]) ? -1 : 0));
-    assert(result32 == diag[i-1-k*4-1] + ((a[i-1-k*4-1] == b[j-1+k*4+1]) ? -1 : 0));
-    assert(result33 == diag[i-1-k*4-0] + ((a[i-1-k*4-0] == b[j-1+k*4+0]) ? -1 : 0));
-#endif // LSTSSE_DEBUG
+  if (i >= startRow) {
+    levenshteinDamerauRows(a, b, startRow, i, k, diag3, diag4, state, IsaScalar());
+  }
+}
 
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(&diag[i-k*4-3]), min);
+#ifdef LSTSSE_SSE4_1
+template<typename T, typename Cell>
+inline typename std::enable_if<HasOSAKernel<T, Cell>::value>::type
+levenshteinDamerauRows(const T* a, const T* b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag3, Cell* diag4, const LevenshteinDamerauState<Cell>& state,
+  IsaSSE41) {
+  levenshteinDamerauRowsSIMD<LevenshteinNarrowSSE<Cell>>(a, b, startRow, endRow, k,
+    diag3, diag4, state);
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+template<typename T, typename Cell>
+inline typename std::enable_if<HasOSAKernel<T, Cell>::value>::type
+levenshteinDamerauRows(const T* a, const T* b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag3, Cell* diag4, const LevenshteinDamerauState<Cell>& state,
+  IsaAVX2) {
+  levenshteinDamerauRowsSIMD<LevenshteinNarrowAVX2<Cell>>(a, b, startRow, endRow, k,
+    diag3, diag4, state);
+}
+#endif
+
+template<typename Iterator1, typename Iterator2, typename Cell>
+struct LevenshteinDamerauStep {
+typedef void (*Function)(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, const Cell* diag3, Cell* diag4,
+  const LevenshteinDamerauState<Cell>& state);
+
+static void runScalar(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, const Cell* diag3, Cell* diag4,
+  const LevenshteinDamerauState<Cell>& state) {
+  levenshteinOSARows(a, b, startRow, endRow, k, diag, diag2, diag4, IsaScalar());
+  levenshteinDamerauRows(a, b, startRow, endRow, k, diag3, diag4, state, IsaScalar());
+}
+
+#ifdef LSTSSE_SSE4_1
+LSTSSE_TARGET("sse4.1") LSTSSE_FLATTEN
+static void runSSE41(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, const Cell* diag3, Cell* diag4,
+  const LevenshteinDamerauState<Cell>& state) {
+  levenshteinOSARows(a, b, startRow, endRow, k, diag, diag2, diag4, IsaSSE41());
+  levenshteinDamerauRows(a, b, startRow, endRow, k, diag3, diag4, state, IsaSSE41());
+}
+#endif
+
+#ifdef LSTSSE_AVX2
+LSTSSE_TARGET("avx2") LSTSSE_FLATTEN
+static void runAVX2(Iterator1 a, Iterator2 b, std::size_t startRow, std::size_t endRow,
+  std::size_t k, const Cell* diag, const Cell* diag2, const Cell* diag3, Cell* diag4,
+  const LevenshteinDamerauState<Cell>& state) {
+  levenshteinOSARows(a, b, startRow, endRow, k, diag, diag2, diag4, IsaAVX2());
+  levenshteinDamerauRows(a, b, startRow, endRow, k, diag3, diag4, state, IsaAVX2());
+}
+#endif
+
+static Function select() {
+#ifdef LSTSSE_AVX2
+  if (cpuLevel() >= cpuAVX2)
+    return &runAVX2;
+#endif
+#ifdef LSTSSE_SSE4_1
+  if (cpuLevel() >= cpuSSE41)
+    return &runSSE41;
+#endif
+  return &runScalar;
+}
+};
+
+/**
+ * Whether levenshteinDamerauDiagonal() has SIMD kernels for the iterators.
+ */
+template<typename Iterator1, typename Iterator2>
+struct HasDamerauKernel : std::false_type {};
+
+template<typename T1, typename T2>
+struct HasDamerauKernel<T1*, T2*> : std::integral_constant<bool,
+  std::is_same<typename std::remove_cv<T1>::type, typename std::remove_cv<T2>::type>::value &&
+  HasOSAKernel<typename std::remove_cv<T1>::type, std::uint16_t>::value> {};
+
+/**
+ * Outer loop, like levenshteinOSADiagonal(). state needs room for
+ * 2 * (len(a) + len(b) + 2) entries.
+ */
+template<typename Cell, typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerauDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  Cell* buffers[4], Cell* state_) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+  const typename LevenshteinDamerauStep<Iterator1, Iterator2, Cell>::Function step =
+    LevenshteinDamerauStep<Iterator1, Iterator2, Cell>::select();
+
+  LevenshteinDamerauState<Cell> state;
+  state.bLen = bLen;
+  state.lastRow = state_;
+  state.fromRow = state.lastRow + (bLen + 1);
+  state.lastColumn = state.fromRow + (bLen + 1);
+  state.fromColumn = state.lastColumn + (aLen + 1);
+  std::fill(state.lastRow, state.lastRow + (bLen + 1), Cell(0));
+  std::fill(state.fromRow, state.fromRow + (bLen + 1), std::numeric_limits<Cell>::max());
+  std::fill(state.lastColumn, state.lastColumn + (aLen + 1), Cell(0));
+  std::fill(state.fromColumn, state.fromColumn + (aLen + 1), std::numeric_limits<Cell>::max());
+
+  // diagonals k-1, k-2, k-3 and k-4
+  Cell* diag2 = buffers[0];
+  Cell* diag = buffers[1];
+  Cell* diag3 = buffers[2];
+  Cell* diag4 = buffers[3];
+  diag2[0] = 0;
+
+  for (std::size_t k = 1; k <= aLen + bLen; ++k) {
+    const std::size_t startRow = k > bLen ? k - bLen : 1;
+    const std::size_t endRow = std::min(k - 1, aLen);
+    if (startRow <= endRow) {
+      step(a, b, startRow, endRow, k, diag, diag2, diag3, diag4, state);
+    }
+
+    diag4[0] = Cell(k);
+    if (k <= aLen) {
+      diag4[k] = Cell(k);
+    }
+
+    Cell* next = diag4;
+    diag4 = diag3;
+    diag3 = diag;
+    diag = diag2;
+    diag2 = next;
   }
-  
-  // We just handled 16 entries at once. Yay!
-  i -= 16;
+
+  return diag2[aLen];
+}
+
+template<typename Cell>
+inline Cell** levenshteinBuffers(LevenshteinWorkspace& workspace, std::size_t n, Cell* buffers[4]) {
+  for (std::size_t index = 0; index < 4; ++index) {
+    buffers[index] = workspace.buffer<Cell>(index, n);
+  }
+  return buffers;
+}
+
+/**
+ * Pick the algorithm for the (already trimmed) random-access case,
+ * like LevenshteinEngine.
+ */
+template<bool useBitParallel>
+struct LevenshteinOSAEngine {};
+
+template<>
+struct LevenshteinOSAEngine<false> {
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calc(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  std::size_t aLen = aEnd - a;
+  std::size_t bLen = bEnd - b;
+
+  // All entries are <= bLen; the maximum value of a cell is needed
+  // for the SIMD variant, see levenshteinOSARowsSIMD().
+  if (bLen < std::numeric_limits<std::uint8_t>::max())
+    return calcDiagonal<std::uint8_t>(a, aEnd, b, bEnd, workspace);
+
+  if (bLen < std::numeric_limits<std::uint16_t>::max())
+    return calcDiagonal<std::uint16_t>(a, aEnd, b, bEnd, workspace);
+
+  if (aLen + bLen <= std::numeric_limits<std::uint32_t>::max())
+    return calcDiagonal<std::uint32_t>(a, aEnd, b, bEnd, workspace);
+
+  return calcDiagonal<std::size_t>(a, aEnd, b, bEnd, workspace);
+}
+
+template<typename Cell, typename Iterator1, typename Iterator2>
+static inline std::size_t calcDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  Cell* buffers[4];
+  return levenshteinOSADiagonal(a, aEnd, b, bEnd,
+    levenshteinBuffers(workspace, (aEnd - a) + 1, buffers));
+}
+};
+
+template<>
+struct LevenshteinOSAEngine<true> {
+template<typename Iterator1, typename Iterator2>
+static inline std::size_t calc(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  typedef typename std::iterator_traits<Iterator1>::value_type T;
+  const std::size_t aLen = aEnd - a;
+
+  auto& peq = workspace.patternMatchVector<T>();
+  if (!peq.assign(a, aEnd)) {
+    return LevenshteinOSAEngine<false>::calc(a, aEnd, b, bEnd, workspace);
+  }
+
+  if (aLen <= 64) {
+    return levenshteinOSAHyyro64(peq, aLen, b, bEnd);
+  }
+
+  return levenshteinOSAHyyroBlocked(peq, aLen, b, bEnd,
+    workspace.buffer<std::uint64_t>(0, peq.words()),
+    workspace.buffer<std::uint64_t>(1, peq.words()),
+    workspace.buffer<std::uint64_t>(2, peq.words()));
+}
+};
+
+/**
+ * Diagonals in buffers 0 to 3 of the workspace, and the per row and
+ * column state in buffer 4.
+ */
+template<typename Cell, typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerauCells(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
+  Cell* buffers[4];
+  return levenshteinDamerauDiagonal(a, aEnd, b, bEnd,
+    levenshteinBuffers(workspace, aLen + 1, buffers),
+    workspace.buffer<Cell>(4, 2 * (aLen + bLen + 2)));
 }
-#endif // __SSSE3__
 
+// Below this length of the longer input, levenshteinDamerauZhao() is faster.
+constexpr std::size_t levenshteinDamerauMinDiagonal = 64;
 
-#ifdef __AVX2__
-static inline void performSSE_AVX2(const T* a, const T* b,
-  std::size_t& i, std::size_t j, std::size_t bLen,
-  std::uint32_t* diag, const std::uint32_t* diag2)
-{
-  const __m256i one256_epi32 = _mm256_set1_epi32(1);
-  const __m256i reversedIdentity256_epi8 = _mm256_setr_epi8(
-    15, 14, 13, 12,
-    11, 10,  9,  8,
-     7,  6,  5,  4,
-     3,  2,  1,  0,
-    15, 14, 13, 12,
-    11, 10,  9,  8,
-     7,  6,  5,  4,
-     3,  2,  1,  0
-  );
+/**
+ * Edge cases and skipping common prefixes/suffixes, which is valid for
+ * transpositions as well, for both distances.
+ */
+template<bool damerau, typename Iterator1, typename Iterator2>
+std::size_t levenshteinTransposition(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  if (aEnd - a > bEnd - b) {
+    return levenshteinTransposition<damerau>(b, bEnd, a, aEnd, workspace,
+      std::random_access_iterator_tag(), std::random_access_iterator_tag());
+  }
 
-  const __m256i blockwiseReversed256_epi8_8 = _mm256_setr_epi8(
-     7,  6,  5,  4,
-     3,  2,  1,  0,
-    15, 14, 13, 12,
-    11, 10,  9,  8,
-     7,  6,  5,  4,
-     3,  2,  1,  0,
-    15, 14, 13, 12,
-    11, 10,  9,  8
-  );
+  levenshteinSkipAffixes(a, aEnd, b, bEnd);
 
-  const __m256i blockwiseReversed256_epi16_8 = _mm256_setr_epi8(
-    14, 15, 12, 13,
-    10, 11,  8,  9,
-     6,  7,  4,  5,
-     2,  3,  0,  1,
-    14, 15, 12, 13,
-    10, 11,  8,  9,
-     6,  7,  4,  5,
-     2,  3,  0,  1
-  );
+  const std::size_t aLen = aEnd - a;
+  const std::size_t bLen = bEnd - b;
 
-  __m256i substitutionCost32[4];
-  std::size_t k;
+  if (aLen == 0) {
+    return bLen;
+  }
 
-  if (sizeof(T) <= 2) {
-    if (sizeof(T) == 1) {
-      __m256i a_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-32]));
-      __m256i b_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j-1]));
-      a_ = _mm256_shuffle_epi8(a_, reversedIdentity256_epi8);
-      a_ = _mm256_permute2x128_si256(a_, a_, 1); // swap hi/lo
+  if (aLen == 1) {
+    return bLen - (levenshteinContains(b, bEnd, *a) ? 1 : 0);
+  }
 
-      __m256i substitutionCost8 = _mm256_cmpeq_epi8(a_, b_);
-      __m256i substitutionCost8X = _mm256_shuffle_epi8(substitutionCost8, blockwiseReversed256_epi8_8);
-      __m128i sc8Xlo  = _mm256_extracti128_si256(substitutionCost8X, 0);
-      __m128i sc8Xhi  = _mm256_extracti128_si256(substitutionCost8X, 1);
-      substitutionCost32[0] = _mm256_cvtepi8_epi32(sc8Xlo);
-      substitutionCost32[1] = _mm256_cvtepi8_epi32(_mm_srli_si128(sc8Xlo, 8));
-      substitutionCost32[2] = _mm256_cvtepi8_epi32(sc8Xhi);
-      substitutionCost32[3] = _mm256_cvtepi8_epi32(_mm_srli_si128(sc8Xhi, 8));
-    } else {
-      __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-16]));
-      __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-32]));
-      __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j-1]));
-      __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j+15]));
-      a0 = _mm256_permute2x128_si256(a0, a0, 1); // swap hi/lo
-      a1 = _mm256_permute2x128_si256(a1, a1, 1); // swap hi/lo
-      b0 = _mm256_shuffle_epi8(b0, blockwiseReversed256_epi16_8);
-      b1 = _mm256_shuffle_epi8(b1, blockwiseReversed256_epi16_8);
-      __m256i substitutionCost16L = _mm256_cmpeq_epi16(a0, b0);
-      __m256i substitutionCost16H = _mm256_cmpeq_epi16(a1, b1);
-      __m128i sc16Llo = _mm256_extracti128_si256(substitutionCost16L, 0);
-      __m128i sc16Lhi = _mm256_extracti128_si256(substitutionCost16L, 1);
-      __m128i sc16Hlo = _mm256_extracti128_si256(substitutionCost16H, 0);
-      __m128i sc16Hhi = _mm256_extracti128_si256(substitutionCost16H, 1);
-      substitutionCost32[0] = _mm256_cvtepi16_epi32(sc16Llo);
-      substitutionCost32[1] = _mm256_cvtepi16_epi32(sc16Lhi);
-      substitutionCost32[2] = _mm256_cvtepi16_epi32(sc16Hlo);
-      substitutionCost32[3] = _mm256_cvtepi16_epi32(sc16Hhi);
+  if (damerau) {
+#ifdef LSTSSE_SSE4_1
+    // the diagonals only pay off with the narrow SIMD kernels, and for
+    // inputs that fill a few vectors
+    if (HasDamerauKernel<Iterator1, Iterator2>::value && cpuLevel() >= cpuSSE41 &&
+        bLen >= levenshteinDamerauMinDiagonal) {
+      if (bLen < std::numeric_limits<std::uint8_t>::max())
+        return levenshteinDamerauCells<std::uint8_t>(a, aEnd, b, bEnd, workspace);
+
+      if (bLen < std::numeric_limits<std::uint16_t>::max())
+        return levenshteinDamerauCells<std::uint16_t>(a, aEnd, b, bEnd, workspace);
     }
-  } else {
-    assert(sizeof(T) == 4);
+#endif
 
-    for (k = 0; k < 4; ++k) {
-      __m256i a_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a[i-8-k*8]));
-      __m256i b_ = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&b[j-1+k*8]));
-      b_ = _mm256_shuffle_epi32(b_, 0x1b); // simple reverse
-      b_ = _mm256_permute2x128_si256(b_, b_, 1); // swap hi/lo
-      substitutionCost32[k] = _mm256_cmpeq_epi32(a_, b_);
+    // 4 buffers with room for len(b) + 2 entries each
+    if (bLen + 2 <= std::size_t(std::numeric_limits<std::int32_t>::max())) {
+      std::uint32_t* buffers[4];
+      return levenshteinDamerauZhao(a, aEnd, b, bEnd,
+        levenshteinBuffers(workspace, bLen + 2, buffers));
     }
-  }
 
-  __m256i diag_[5], diag2_[5];
-  for (k = 0; k < 5; ++k) {
-    diag_ [k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag [i-7-k*8]));
-  }
-  for (k = 0; k < 5; ++k) {
-    diag2_[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&diag2[i-7-k*8]));
+    std::size_t* buffers[4];
+    return levenshteinDamerauZhao(a, aEnd, b, bEnd,
+      levenshteinBuffers(workspace, bLen + 2, buffers));
   }
 
-#ifdef LSTSSE_DEBUG
-  for (k = 0; k < 5; ++k) {
-    std::uint32_t diag0 = _mm256_extract_epi32(diag_[k], 0);
-    std::uint32_t diag1 = _mm256_extract_epi32(diag_[k], 1);
-    std::uint32_t diag2 = _mm256_extract_epi32(diag_[k], 2);
-    std::uint32_t diag3 = _mm256_extract_epi32(diag_[k], 3);
-    std::uint32_t diag4 = _mm256_extract_epi32(diag_[k], 4);
-    std::uint32_t diag5 = _mm256_extract_epi32(diag_[k], 5);
-    std::uint32_t diag6 = _mm256_extract_epi32(diag_[k], 6);
-    std::uint32_t diag7 = _mm256_extract_epi32(diag_[k], 7);
-    assert(diag0 == diag[i-k*8-7]);
-    assert(diag1 == diag[i-k*8-6]);
-    assert(diag2 == diag[i-k*8-5]);
-    assert(diag3 == diag[i-k*8-4]);
-    assert(diag4 == diag[i-k*8-3]);
-    assert(diag5 == diag[i-k*8-2]);
-    assert(diag6 == diag[i-k*8-1]);
-    assert(diag7 == diag[i-k*8-0]);
-  }
-  for (k = 0; k < 5; ++k) {
-    std::uint32_t diag20 = _mm256_extract_epi32(diag2_[k], 0);
-    std::uint32_t diag21 = _mm256_extract_epi32(diag2_[k], 1);
-    std::uint32_t diag22 = _mm256_extract_epi32(diag2_[k], 2);
-    std::uint32_t diag23 = _mm256_extract_epi32(diag2_[k], 3);
-    std::uint32_t diag24 = _mm256_extract_epi32(diag2_[k], 4);
-    std::uint32_t diag25 = _mm256_extract_epi32(diag2_[k], 5);
-    std::uint32_t diag26 = _mm256_extract_epi32(diag2_[k], 6);
-    std::uint32_t diag27 = _mm256_extract_epi32(diag2_[k], 7);
-    assert(diag20 == diag2[i-k*8-7]);
-    assert(diag21 == diag2[i-k*8-6]);
-    assert(diag22 == diag2[i-k*8-5]);
-    assert(diag23 == diag2[i-k*8-4]);
-    assert(diag24 == diag2[i-k*8-3]);
-    assert(diag25 == diag2[i-k*8-2]);
-    assert(diag26 == diag2[i-k*8-1]);
-    assert(diag27 == diag2[i-k*8-0]);
-  }
-  
-  for (k = 0; k < 4; ++k) {
-    int sc0 = _mm256_extract_epi32(substitutionCost32[k], 0);
-    int sc1 = _mm256_extract_epi32(substitutionCost32[k], 1);
-    int sc2 = _mm256_extract_epi32(substitutionCost32[k], 2);
-    int sc3 = _mm256_extract_epi32(substitutionCost32[k], 3);
-    int sc4 = _mm256_extract_epi32(substitutionCost32[k], 4);
-    int sc5 = _mm256_extract_epi32(substitutionCost32[k], 5);
-    int sc6 = _mm256_extract_epi32(substitutionCost32[k], 6);
-    int sc7 = _mm256_extract_epi32(substitutionCost32[k], 7);
-    assert(sc0 == ((a[i-1-k*8-7] == b[j-1+k*8+7]) ? -1 : 0));
-    assert(sc1 == ((a[i-1-k*8-6] == b[j-1+k*8+6]) ? -1 : 0));
-    assert(sc2 == ((a[i-1-k*8-5] == b[j-1+k*8+5]) ? -1 : 0));
-    assert(sc3 == ((a[i-1-k*8-4] == b[j-1+k*8+4]) ? -1 : 0));
-    assert(sc4 == ((a[i-1-k*8-3] == b[j-1+k*8+3]) ? -1 : 0));
-    assert(sc5 == ((a[i-1-k*8-2] == b[j-1+k*8+2]) ? -1 : 0));
-    assert(sc6 == ((a[i-1-k*8-1] == b[j-1+k*8+1]) ? -1 : 0));
-    assert(sc7 == ((a[i-1-k*8-0] == b[j-1+k*8+0]) ? -1 : 0));
-  }
-#endif // LSTSSE_DEBUG
+  return LevenshteinOSAEngine<UseBitParallel<Iterator1, Iterator2>::value>
+    ::calc(a, aEnd, b, bEnd, workspace);
+}
 
-  for (k = 0; k < 4; ++k) {
-    __m256i diag2_i_m1 = _mm256_alignr_epi32_7(diag2_[k], diag2_[k+1]);
-    __m256i diag_i_m1  = _mm256_alignr_epi32_7(diag_ [k], diag_ [k+1]);
+template<bool damerau, typename Iterator1, typename Iterator2>
+std::size_t levenshteinTransposition(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
 
-    __m256i result3 = _mm256_add_epi32(diag_i_m1,  substitutionCost32[k]);
-    __m256i min = _mm256_min_epi32(_mm256_min_epi32(diag2_i_m1, diag2_[k]), result3);
-    min = _mm256_add_epi32(min, one256_epi32);
+  const std::vector<T1> a_(a, aEnd);
+  const std::vector<T2> b_(b, bEnd);
+  return levenshteinTransposition<damerau>(a_.data(), a_.data() + a_.size(),
+    b_.data(), b_.data() + b_.size(), workspace,
+    std::random_access_iterator_tag(), std::random_access_iterator_tag());
+}
 
-#ifdef LSTSSE_DEBUG
-    std::uint32_t diag_i_m10 = _mm256_extract_epi32(diag_i_m1, 0);
-    std::uint32_t diag_i_m11 = _mm256_extract_epi32(diag_i_m1, 1);
-    std::uint32_t diag_i_m12 = _mm256_extract_epi32(diag_i_m1, 2);
-    std::uint32_t diag_i_m13 = _mm256_extract_epi32(diag_i_m1, 3);
-    std::uint32_t diag_i_m14 = _mm256_extract_epi32(diag_i_m1, 4);
-    std::uint32_t diag_i_m15 = _mm256_extract_epi32(diag_i_m1, 5);
-    std::uint32_t diag_i_m16 = _mm256_extract_epi32(diag_i_m1, 6);
-    std::uint32_t diag_i_m17 = _mm256_extract_epi32(diag_i_m1, 7);
-    assert(diag_i_m10 == diag[i-k*8-8]);
-    assert(diag_i_m11 == diag[i-k*8-7]);
-    assert(diag_i_m12 == diag[i-k*8-6]);
-    assert(diag_i_m13 == diag[i-k*8-5]);
-    assert(diag_i_m14 == diag[i-k*8-4]);
-    assert(diag_i_m15 == diag[i-k*8-3]);
-    assert(diag_i_m16 == diag[i-k*8-2]);
-    assert(diag_i_m17 == diag[i-k*8-1]);
-    
-    std::uint32_t diag2_i_m10 = _mm256_extract_epi32(diag2_i_m1, 0);
-    std::uint32_t diag2_i_m11 = _mm256_extract_epi32(diag2_i_m1, 1);
-    std::uint32_t diag2_i_m12 = _mm256_extract_epi32(diag2_i_m1, 2);
-    std::uint32_t diag2_i_m13 = _mm256_extract_epi32(diag2_i_m1, 3);
-    std::uint32_t diag2_i_m14 = _mm256_extract_epi32(diag2_i_m1, 4);
-    std::uint32_t diag2_i_m15 = _mm256_extract_epi32(diag2_i_m1, 5);
-    std::uint32_t diag2_i_m16 = _mm256_extract_epi32(diag2_i_m1, 6);
-    std::uint32_t diag2_i_m17 = _mm256_extract_epi32(diag2_i_m1, 7);
-    assert(diag2_i_m10 == diag2[i-k*8-8]);
-    assert(diag2_i_m11 == diag2[i-k*8-7]);
-    assert(diag2_i_m12 == diag2[i-k*8-6]);
-    assert(diag2_i_m13 == diag2[i-k*8-5]);
-    assert(diag2_i_m14 == diag2[i-k*8-4]);
-    assert(diag2_i_m15 == diag2[i-k*8-3]);
-    assert(diag2_i_m16 == diag2[i-k*8-2]);
-    assert(diag2_i_m17 == diag2[i-k*8-1]);
-    
-    std::uint32_t result30 = _mm256_extract_epi32(result3, 0);
-    std::uint32_t result31 = _mm256_extract_epi32(result3, 1);
-    std::uint32_t result32 = _mm256_extract_epi32(result3, 2);
-    std::uint32_t result33 = _mm256_extract_epi32(result3, 3);
-    std::uint32_t result34 = _mm256_extract_epi32(result3, 4);
-    std::uint32_t result35 = _mm256_extract_epi32(result3, 5);
-    std::uint32_t result36 = _mm256_extract_epi32(result3, 6);
-    std::uint32_t result37 = _mm256_extract_epi32(result3, 7);
-    
-    assert(result30 == diag[i-1-k*8-7] + ((a[i-1-k*8-7] == b[j-1+k*8+7]) ? -1 : 0));
-    assert(result31 == diag[i-1-k*8-6] + ((a[i-1-k*8-6] == b[j-1+k*8+6]) ? -1 : 0));
-    assert(result32 == diag[i-1-k*8-5] + ((a[i-1-k*8-5] == b[j-1+k*8+5]) ? -1 : 0));
-    assert(result33 == diag[i-1-k*8-4] + ((a[i-1-k*8-4] == b[j-1+k*8+4]) ? -1 : 0));
-    assert(result34 == diag[i-1-k*8-3] + ((a[i-1-k*8-3] == b[j-1+k*8+3]) ? -1 : 0));
-    assert(result35 == diag[i-1-k*8-2] + ((a[i-1-k*8-2] == b[j-1+k*8+2]) ? -1 : 0));
-    assert(result36 == diag[i-1-k*8-1] + ((a[i-1-k*8-1] == b[j-1+k*8+1]) ? -1 : 0));
-    assert(result37 == diag[i-1-k*8-0] + ((a[i-1-k*8-0] == b[j-1+k*8+0]) ? -1 : 0));
-#endif // LSTSSE_DEBUG
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinOSA(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinTransposition<false>(a, aEnd, b, bEnd, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
 
-    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&diag[i-k*8-7]), min);
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinOSA(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshteinOSA(a, aEnd, b, bEnd, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinOSA(const Container1& a, const Container2& b) {
+  return levenshteinOSA(a, b, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinOSA(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value> Range1;
+  typedef LevenshteinContainer<has_data_and_size<Container2>::value> Range2;
+  return levenshteinOSA(Range1::begin(a), Range1::end(a), Range2::begin(b), Range2::end(b),
+    workspace);
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerau(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinTransposition<true>(a, aEnd, b, bEnd, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::size_t levenshteinDamerau(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
+  return levenshteinDamerau(a, aEnd, b, bEnd, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinDamerau(const Container1& a, const Container2& b) {
+  return levenshteinDamerau(a, b, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::size_t levenshteinDamerau(const Container1& a, const Container2& b,
+  LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value> Range1;
+  typedef LevenshteinContainer<has_data_and_size<Container2>::value> Range2;
+  return levenshteinDamerau(Range1::begin(a), Range1::end(a), Range2::begin(b), Range2::end(b),
+    workspace);
+}
+
+/**
+ * Searching, i.e. the semi-global variant of the distance: The first row of
+ * the table is all 0, so that an occurrence may start anywhere in the text,
+ * and the last row D[len(pattern)][e] is the distance of the best occurrence
+ * ending at e. The columns are the same as for the distance otherwise.
+ *
+ * The bit-parallel variant reports each entry of the last row that is
+ * <= maxDist, for e >= 1. vp and vn need room for peq.words() words each.
+ */
+template<typename PatternMatchVector, typename Iterator2>
+void levenshteinSearchMyers(const PatternMatchVector& peq, std::size_t patternLen,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist,
+  std::uint64_t* vp, std::uint64_t* vn, std::vector<LevenshteinMatch>& matches) {
+  const std::size_t words = peq.words();
+  const std::uint64_t last = std::uint64_t(1) << ((patternLen - 1) % 64);
+  std::fill(vp, vp + words, ~std::uint64_t(0));
+  std::fill(vn, vn + words, std::uint64_t(0));
+  std::size_t score = patternLen;
+
+  // (with a constant number of words, the compiler can drop the loop)
+  if (words == 1) {
+    for (std::size_t end = 1; text != textEnd; ++text, ++end) {
+      levenshteinMyersBlockedColumn(peq.get(*text), 1, last, vp, vn, score, 0);
+
+      if (score <= maxDist) {
+        matches.push_back(LevenshteinMatch { end, score });
+      }
+    }
+    return;
   }
 
-  // We just handled 32 entries at once. Yay!
-  i -= 32;
-}
-#endif // __AVX2__
+  for (std::size_t end = 1; text != textEnd; ++text, ++end) {
+    levenshteinMyersBlockedColumn(peq.get(*text), words, last, vp, vn, score, 0);
 
-};
+    if (score <= maxDist) {
+      matches.push_back(LevenshteinMatch { end, score });
+    }
+  }
+}
 
 /**
- * Default: If we don’t know better, just use the trivial implementation.
- * 
- * This is overloaded in multiple places and is the struct whose `perform`
- * method will ultimately be called from the outer loop.
- * 
- * Vec1 and Vec2 correspond to `diag` and `diag2`, respectively.
+ * Same with the diagonal algorithm, on blocks of up to chunkSize columns:
+ * The row above each block is all 0, and the one below it is the part of
+ * the last row that belongs to the block. left carries the last column of
+ * one block over to the next one.
+ *
+ * top needs room for chunkSize + 1 entries, the others for
+ * len(pattern) + 1 entries.
  */
-template<typename Vec1, typename Vec2, typename Iterator1, typename Iterator2>
-struct LevenshteinIteration : LevenshteinIterationBase<Vec1, Vec2, Iterator1, Iterator2> {
-};
+template<typename Cell, typename Iterator1, typename Iterator2>
+void levenshteinSearchDiagonal(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist, std::size_t chunkSize,
+  Cell* top, Cell* left, Cell* diag, Cell* diag2, std::vector<LevenshteinMatch>& matches) {
+  const std::size_t patternLen = patternEnd - pattern;
+  const std::size_t textLen = textEnd - text;
 
-/**
- * Use a wrapper to decay the `diag` and `diag2` entries into pointers.
- */
-template<typename Alloc1, typename Alloc2, typename T>
-struct LevenshteinIterationSIMDWrap : private LevenshteinIterationSIMD<T> {
-static inline void perform(const T* a, const T* b,
-  std::size_t& i, std::size_t j, std::size_t bLen,
-  std::vector<std::uint32_t, Alloc1>& diag,
-  const std::vector<std::uint32_t, Alloc2>& diag2) {
-  return LevenshteinIterationSIMD<T>::performSIMD(a, b, i, j, bLen, diag.data(), diag2.data());
+  for (std::size_t i = 0; i <= patternLen; ++i) {
+    left[i] = Cell(i);
+  }
+
+  for (std::size_t start = 0; start < textLen; start += chunkSize) {
+    const std::size_t length = std::min(chunkSize, textLen - start);
+
+    std::fill(top, top + length + 1, Cell(0));
+    left[0] = 0;
+    levenshteinDiagonalTile<Cell>(pattern, patternEnd, text + start, text + start + length,
+      top, left, diag, diag2);
+
+    for (std::size_t j = 1; j <= length; ++j) {
+      if (top[j] <= maxDist) {
+        matches.push_back(LevenshteinMatch { start + j, top[j] });
+      }
+    }
+  }
 }
-};
 
 /**
- * Use a wrapper to test whether we can use SSE instuctions.
- * 
- * T needs to be a scalar of size 1, 2 or 4.
+ * Where a best occurrence ending at end starts: the distances of the
+ * reversed pattern to the reversed text, read backwards from end, are the
+ * same table with its rows and columns in reverse order. The longest
+ * prefix of the reversed text (of length at most len(pattern) + distance)
+ * that has the given distance to the reversed pattern is the occurrence.
+ *
+ * The bit-parallel variant gets peq for the reversed pattern.
  */
-template<typename Alloc1, typename Alloc2, typename T>
-struct LevenshteinIteration<std::vector<std::uint32_t, Alloc1>, std::vector<std::uint32_t, Alloc2>, const T*, const T*>
-  : std::conditional<std::is_scalar<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4),
-    LevenshteinIterationSIMDWrap<Alloc1, Alloc2, T>,
-    LevenshteinIterationBase<std::vector<std::uint32_t, Alloc1>, std::vector<std::uint32_t, Alloc2>, const T*, const T*>
-  >::type
-{ };
+template<typename PatternMatchVector, typename Iterator2>
+std::size_t levenshteinSearchStartMyers(const PatternMatchVector& peq, std::size_t patternLen,
+  Iterator2 text, std::size_t end, std::size_t distance,
+  std::uint64_t* vp, std::uint64_t* vn) {
+  const std::size_t words = peq.words();
+  const std::uint64_t last = std::uint64_t(1) << ((patternLen - 1) % 64);
+  const std::size_t window = std::min(end, patternLen + distance);
+  std::fill(vp, vp + words, ~std::uint64_t(0));
+  std::fill(vn, vn + words, std::uint64_t(0));
+  std::size_t score = patternLen;
+  std::size_t best = 0;
 
-/**
- * Always decay pointers to const.
- */
-template<typename Alloc1, typename Alloc2, typename T>
-struct LevenshteinIteration<std::vector<std::uint32_t, Alloc1>, std::vector<std::uint32_t, Alloc2>, T*, T*>
-  : LevenshteinIteration<std::vector<std::uint32_t, Alloc1>, std::vector<std::uint32_t, Alloc2>, const T*, const T*>
-{ };
+  for (std::size_t j = 1; j <= window; ++j) {
+    levenshteinMyersBlockedColumn(peq.get(text[end - j]), words, last, vp, vn, score);
 
-/**
- * Outer loop of the diagonal algorithm variant.
- */
-template<typename T, typename Iterator1, typename Iterator2>
-T levenshteinDiagonal(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
-  const std::size_t aLen = aEnd - a;
-  const std::size_t bLen = bEnd - b;
-  
-  assert(0 < aLen);
-  assert(aLen <= bLen);
-  
-  typedef AlignmentAllocator<T, alignment> Alloc;
-  std::vector<T, Alloc> diag  (aLen + 1, T(0));
-  std::vector<T, Alloc> diag2 (aLen + 1, T(0));
-  
-  std::size_t i, j, k;
-  
-  k = 0;
-  for (k = 1; ; ++k) {
-    assert(k <= aLen + bLen);
-    
-    std::size_t startRow = k > bLen ? k - bLen : 1;
-    std::size_t endRow = k > aLen ? aLen : k - 1;
-    
-    assert(endRow >= startRow || k == 1);
-    
-    for (i = endRow; i >= startRow; ) {
-      assert(i < k);
-      j = k - i;
-      
-      assert(bLen >= j);
-      assert(aLen >= i);
-      
-      LevenshteinIteration<std::vector<T, Alloc>, std::vector<T, Alloc>, Iterator1, Iterator2>
-        ::perform(a, b, i, j, bLen, diag, diag2);
-    }
-    
-    diag[0] = k;
-    
-    if (k <= aLen) {
-      diag[k] = k;
-    }
-    
-    if (k == aLen + bLen) {
-      assert(startRow == endRow);
-      return diag[startRow];
+    if (score == distance) {
+      best = j;
     }
-    
-    // switch buffers
-    std::swap(diag, diag2);
   }
-  
-  assert(0);
+
+  assert(best > 0 || patternLen == distance);
+  return end - best;
 }
 
 /**
- * Outer loop of the row-based variant, used for non-random-access iterators.
- * 
- * based on https://github.com/sindresorhus/leven
+ * Same with the diagonal algorithm; reversedPattern points to the reversed
+ * pattern, and reversedText needs room for len(pattern) + distance elements.
+ * top needs room for len(pattern) + distance + 1 entries, the other buffers
+ * for len(pattern) + 1 entries.
  */
-template<typename T, typename Iterator1, typename Iterator2>
-T levenshteinRowBased(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
-  std::vector<T> arr;
-  
-  std::size_t i = 0, j = 0;
-  T ret(0);
-  
-  for (Iterator1 it = a; it != aEnd; ++it) {
-    arr.push_back(++i);
+template<typename Cell, typename T1, typename Iterator2, typename T2>
+std::size_t levenshteinSearchStartDiagonal(const T1* reversedPattern, std::size_t patternLen,
+  Iterator2 text, std::size_t end, std::size_t distance, T2* reversedText,
+  Cell* top, Cell* left, Cell* diag, Cell* diag2) {
+  const std::size_t window = std::min(end, patternLen + distance);
+  if (window == 0) {
+    return end;
   }
-  
-  arr.shrink_to_fit();
 
-  for (; b != bEnd; ++b) {
-    T tmp = j++;
-    ret = j;
-    i = 0;
-    
-    for (Iterator1 it = a; it != aEnd; ++it, ++i) {
-      T tmp2 = *b == *it ? tmp : tmp + 1;
-      tmp = arr[i];
-      ret = arr[i] = tmp > ret ? tmp2 > ret ? ret + 1 : tmp2 : tmp2 > tmp ? tmp + 1 : tmp2;
+  for (std::size_t j = 0; j < window; ++j) {
+    reversedText[j] = text[end - 1 - j];
+  }
+  for (std::size_t j = 0; j <= window; ++j) {
+    top[j] = Cell(j);
+  }
+  for (std::size_t i = 0; i <= patternLen; ++i) {
+    left[i] = Cell(i);
+  }
+
+  const T2* b = reversedText;
+  levenshteinDiagonalTile<Cell>(reversedPattern, reversedPattern + patternLen,
+    b, b + window, top, left, diag, diag2);
+
+  std::size_t best = 0;
+  for (std::size_t j = 1; j <= window; ++j) {
+    if (top[j] == distance) {
+      best = j;
     }
   }
 
-  return ret;
+  assert(best > 0 || patternLen == distance);
+  return end - best;
 }
 
-/**
- * Preable for edge cases and skipping common prefixes/suffixes,
- * random access version.
- */
+template<bool useBitParallel>
+struct LevenshteinSearchEngine {};
+
+template<>
+struct LevenshteinSearchEngine<false> {
+// The number of columns per block; the fixed cost of a block is small
+// compared to a block of this size.
+static constexpr std::size_t chunkSize = 4096;
+
 template<typename Iterator1, typename Iterator2>
-std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
-  std::random_access_iterator_tag, std::random_access_iterator_tag) {
-  if (aEnd - a > bEnd - b) {
-    return levenshtein(b, bEnd, a, aEnd);
+static inline void search(Iterator1 pattern, Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace, std::vector<LevenshteinMatch>& matches) {
+  const std::size_t patternLen = patternEnd - pattern;
+
+#ifdef LSTSSE_SSE4_1
+  // All entries are <= len(pattern), so narrow cells can be used, but
+  // the diagonals are at most len(pattern) long, and narrower cells only
+  // pay off if they fill the wider SIMD registers (64 or 32 lanes).
+  if (patternLen >= 64 && patternLen < std::numeric_limits<std::uint8_t>::max())
+    return searchDiagonal<std::uint8_t>(pattern, patternEnd, text, textEnd, maxDist, workspace, matches);
+
+  if (patternLen >= 32 && patternLen < std::numeric_limits<std::uint16_t>::max())
+    return searchDiagonal<std::uint16_t>(pattern, patternEnd, text, textEnd, maxDist, workspace, matches);
+#endif
+
+  if (patternLen < std::numeric_limits<std::uint32_t>::max())
+    return searchDiagonal<std::uint32_t>(pattern, patternEnd, text, textEnd, maxDist, workspace, matches);
+
+  return searchDiagonal<std::size_t>(pattern, patternEnd, text, textEnd, maxDist, workspace, matches);
+}
+
+template<typename Cell, typename Iterator1, typename Iterator2>
+static inline void searchDiagonal(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist,
+  LevenshteinWorkspace& workspace, std::vector<LevenshteinMatch>& matches) {
+  const std::size_t patternLen = patternEnd - pattern;
+  levenshteinSearchDiagonal(pattern, patternEnd, text, textEnd, maxDist, chunkSize,
+    workspace.buffer<Cell>(0, chunkSize + 1), workspace.buffer<Cell>(1, patternLen + 1),
+    workspace.buffer<Cell>(2, patternLen + 1), workspace.buffer<Cell>(3, patternLen + 1),
+    matches);
+}
+
+template<typename Iterator1, typename Iterator2>
+static inline void starts(Iterator1 pattern, Iterator1 patternEnd, Iterator2 text,
+  const std::vector<LevenshteinMatch>& ends, LevenshteinWorkspace& workspace,
+  std::vector<LevenshteinOccurrence>& occurrences) {
+  const std::size_t patternLen = patternEnd - pattern;
+  std::size_t maxDist = 0;
+  for (const LevenshteinMatch& match : ends) {
+    maxDist = std::max(maxDist, match.distance);
   }
-  
-  // skip common prefixes and suffixes
-  while (a < aEnd && a[0] == b[0])
-    ++a, ++b;
-  
-  while (a < aEnd && aEnd[-1] == bEnd[-1])
-    --aEnd, --bEnd;
-  
-  std::size_t aLen = aEnd - a;
-  std::size_t bLen = bEnd - b;
-  
-  if (aLen == 0) {
-    return bLen;
+
+  // all entries are <= len(pattern) + the length of the window
+  if (2 * patternLen + maxDist > std::numeric_limits<std::uint32_t>::max()) {
+    return startsDiagonal<std::size_t>(pattern, patternEnd, text, ends, maxDist, workspace, occurrences);
   }
-  
-  if (aLen == 1) {
-    return bLen - (std::find(b, bEnd, *a) == bEnd ? 0 : 1);
+
+  return startsDiagonal<std::uint32_t>(pattern, patternEnd, text, ends, maxDist, workspace, occurrences);
+}
+
+template<typename Cell, typename Iterator1, typename Iterator2>
+static inline void startsDiagonal(Iterator1 pattern, Iterator1 patternEnd, Iterator2 text,
+  const std::vector<LevenshteinMatch>& ends, std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::vector<LevenshteinOccurrence>& occurrences) {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  const std::size_t patternLen = patternEnd - pattern;
+  typedef std::reverse_iterator<Iterator1> Reverse1;
+  const std::vector<T1> reversedPattern = std::vector<T1>(Reverse1(patternEnd), Reverse1(pattern));
+  std::vector<T2> reversedText(patternLen + maxDist);
+  Cell* top = workspace.buffer<Cell>(0, patternLen + maxDist + 1);
+  Cell* left = workspace.buffer<Cell>(1, patternLen + 1);
+  Cell* diag = workspace.buffer<Cell>(2, patternLen + 1);
+  Cell* diag2 = workspace.buffer<Cell>(3, patternLen + 1);
+
+  for (const LevenshteinMatch& match : ends) {
+    const std::size_t start = levenshteinSearchStartDiagonal(reversedPattern.data(), patternLen,
+      text, match.index, match.distance, reversedText.data(), top, left, diag, diag2);
+    occurrences.push_back(LevenshteinOccurrence { start, match.index, match.distance });
   }
-  
-  if (aLen + bLen <= std::numeric_limits<std::uint32_t>::max())
-    return levenshteinDiagonal<std::uint32_t>(a, aEnd, b, bEnd);
-  
-  return levenshteinDiagonal<std::size_t>(a, aEnd, b, bEnd);
 }
+};
 
-/**
- * Preable for edge cases and skipping common prefixes/suffixes,
- * non-random access version.
- */
+template<>
+struct LevenshteinSearchEngine<true> {
 template<typename Iterator1, typename Iterator2>
-std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd,
-  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
-  // skip common prefixes and suffixes
-  while (a != aEnd && b != bEnd && *a == *b)
-    ++a, ++b;
-  
-  while (a != aEnd && b != bEnd && *std::prev(aEnd) == *std::prev(bEnd))
-    --aEnd, --bEnd;
-  
-  if (a == aEnd) {
-    return std::distance(b, bEnd);
+static inline void search(Iterator1 pattern, Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd,
+  std::size_t maxDist, LevenshteinWorkspace& workspace, std::vector<LevenshteinMatch>& matches) {
+  typedef typename std::iterator_traits<Iterator1>::value_type T;
+
+  auto& peq = workspace.patternMatchVector<T>();
+  if (!peq.assign(pattern, patternEnd)) {
+    return LevenshteinSearchEngine<false>::search(pattern, patternEnd, text, textEnd, maxDist,
+      workspace, matches);
   }
-  
-  if (b == bEnd) {
-    return std::distance(a, aEnd);
+
+  levenshteinSearchMyers(peq, patternEnd - pattern, text, textEnd, maxDist,
+    workspace.buffer<std::uint64_t>(0, peq.words()),
+    workspace.buffer<std::uint64_t>(1, peq.words()), matches);
+}
+
+template<typename Iterator1, typename Iterator2>
+static inline void starts(Iterator1 pattern, Iterator1 patternEnd, Iterator2 text,
+  const std::vector<LevenshteinMatch>& ends, LevenshteinWorkspace& workspace,
+  std::vector<LevenshteinOccurrence>& occurrences) {
+  typedef typename std::iterator_traits<Iterator1>::value_type T;
+
+  auto& peq = workspace.patternMatchVector<T>();
+  if (!peq.assign(std::reverse_iterator<Iterator1>(patternEnd),
+      std::reverse_iterator<Iterator1>(pattern))) {
+    return LevenshteinSearchEngine<false>::starts(pattern, patternEnd, text, ends, workspace,
+      occurrences);
   }
-  
-  if (std::next(a) == aEnd) {
-    std::size_t ret = 0, found = 0;
-    for (; b != bEnd; ++b, ++ret)
-      if (*b == *a)
-        found = 1;
-    return ret - found;
+
+  std::uint64_t* vp = workspace.buffer<std::uint64_t>(0, peq.words());
+  std::uint64_t* vn = workspace.buffer<std::uint64_t>(1, peq.words());
+
+  for (const LevenshteinMatch& match : ends) {
+    const std::size_t start = levenshteinSearchStartMyers(peq, patternEnd - pattern,
+      text, match.index, match.distance, vp, vn);
+    occurrences.push_back(LevenshteinOccurrence { start, match.index, match.distance });
   }
-  
-  if (std::next(b) == bEnd) {
-    std::size_t ret = 0, found = 0;
-    for (; a != aEnd; ++a, ++ret)
-      if (*b == *a)
-        found = 1;
-    return ret - found;
+}
+};
+
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinMatch> levenshteinSearch(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  const std::size_t patternLen = patternEnd - pattern;
+  const std::size_t textLen = textEnd - text;
+  std::vector<LevenshteinMatch> matches;
+
+  if (patternLen <= maxDist) {
+    matches.push_back(LevenshteinMatch { 0, patternLen });
   }
-  
-  return levenshteinRowBased<std::size_t>(a, aEnd, b, bEnd);
+
+  if (patternLen == 0) {
+    for (std::size_t end = 1; end <= textLen; ++end) {
+      matches.push_back(LevenshteinMatch { end, 0 });
+    }
+    return matches;
+  }
+
+  LevenshteinSearchEngine<UseBitParallel<Iterator1, Iterator2>::value>
+    ::search(pattern, patternEnd, text, textEnd, maxDist, workspace, matches);
+  return matches;
 }
 
-// SFINAE checker for .data() and .size()
-template<typename T>
-struct has_data_and_size {
-private:
-  struct char2 { char _[2]; };
-  template<typename U> static auto test(U* a) -> decltype(a->data() + a->size(), char(0));
-  template<typename U> static auto test(const U* a) -> char2;
-public:
-  static constexpr bool value = sizeof(test(static_cast<T*>(nullptr))) == 1;
-};
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(Iterator1 pattern,
+  Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd, std::size_t maxDist,
+  LevenshteinWorkspace& workspace,
+  std::random_access_iterator_tag, std::random_access_iterator_tag) {
+  const std::vector<LevenshteinMatch> ends = levenshteinSearch(pattern, patternEnd,
+    text, textEnd, maxDist, workspace,
+    std::random_access_iterator_tag(), std::random_access_iterator_tag());
+  std::vector<LevenshteinOccurrence> occurrences;
+  occurrences.reserve(ends.size());
 
-template<bool useDataAndSize>
-struct LevenshteinContainer {};
+  if (pattern == patternEnd) {
+    for (const LevenshteinMatch& match : ends) {
+      occurrences.push_back(LevenshteinOccurrence { match.index, match.index, 0 });
+    }
+    return occurrences;
+  }
+
+  LevenshteinSearchEngine<UseBitParallel<Iterator1, Iterator2>::value>
+    ::starts(pattern, patternEnd, text, ends, workspace, occurrences);
+  return occurrences;
+}
+
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinMatch> levenshteinSearch(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist, LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  const std::vector<T1> pattern_(pattern, patternEnd);
+  const std::vector<T2> text_(text, textEnd);
+  return levenshteinSearch(pattern_.data(), pattern_.data() + pattern_.size(),
+    text_.data(), text_.data() + text_.size(), maxDist, workspace,
+    std::random_access_iterator_tag(), std::random_access_iterator_tag());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(Iterator1 pattern,
+  Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd, std::size_t maxDist,
+  LevenshteinWorkspace& workspace,
+  std::bidirectional_iterator_tag, std::bidirectional_iterator_tag) {
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator1>::value_type>::type T1;
+  typedef typename std::remove_cv<typename std::iterator_traits<Iterator2>::value_type>::type T2;
+
+  const std::vector<T1> pattern_(pattern, patternEnd);
+  const std::vector<T2> text_(text, textEnd);
+  return levenshteinSearchOccurrences(pattern_.data(), pattern_.data() + pattern_.size(),
+    text_.data(), text_.data() + text_.size(), maxDist, workspace,
+    std::random_access_iterator_tag(), std::random_access_iterator_tag());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinMatch> levenshteinSearch(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  return levenshteinSearch(pattern, patternEnd, text, textEnd, maxDist, workspace,
+    typename std::iterator_traits<Iterator1>::iterator_category(),
+    typename std::iterator_traits<Iterator2>::iterator_category());
+}
+
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinMatch> levenshteinSearch(Iterator1 pattern, Iterator1 patternEnd,
+  Iterator2 text, Iterator2 textEnd, std::size_t maxDist) {
+  return levenshteinSearch(pattern, patternEnd, text, textEnd, maxDist,
+    LevenshteinWorkspace::threadLocal());
+}
 
-/**
- * Use .data(), .size() when available.
- */
-template<>
-struct LevenshteinContainer<true> {
 template<typename Container1, typename Container2>
-static inline std::size_t calc(const Container1& a, const Container2& b) {
-  return levenshtein(a.data(), a.data() + a.size(), b.data(), b.data() + b.size());
+std::vector<LevenshteinMatch> levenshteinSearch(const Container1& pattern,
+  const Container2& text, std::size_t maxDist) {
+  return levenshteinSearch(pattern, text, maxDist, LevenshteinWorkspace::threadLocal());
 }
-};
 
-/**
- * Use std::begin(), std::end() otherwise.
- */
-template<>
-struct LevenshteinContainer<false> {
 template<typename Container1, typename Container2>
-static inline std::size_t calc(const Container1& a, const Container2& b) {
-  return levenshtein(std::begin(a), std::end(a), std::begin(b), std::end(b));
+std::vector<LevenshteinMatch> levenshteinSearch(const Container1& pattern,
+  const Container2& text, std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value> Range1;
+  typedef LevenshteinContainer<has_data_and_size<Container2>::value> Range2;
+  return levenshteinSearch(Range1::begin(pattern), Range1::end(pattern),
+    Range2::begin(text), Range2::end(text), maxDist, workspace);
 }
-};
 
 template<typename Iterator1, typename Iterator2>
-std::size_t levenshtein(Iterator1 a, Iterator1 aEnd, Iterator2 b, Iterator2 bEnd) {
-  return levenshtein(a, aEnd, b, bEnd,
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(Iterator1 pattern,
+  Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd, std::size_t maxDist,
+  LevenshteinWorkspace& workspace) {
+  return levenshteinSearchOccurrences(pattern, patternEnd, text, textEnd, maxDist, workspace,
     typename std::iterator_traits<Iterator1>::iterator_category(),
     typename std::iterator_traits<Iterator2>::iterator_category());
 }
 
+template<typename Iterator1, typename Iterator2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(Iterator1 pattern,
+  Iterator1 patternEnd, Iterator2 text, Iterator2 textEnd, std::size_t maxDist) {
+  return levenshteinSearchOccurrences(pattern, patternEnd, text, textEnd, maxDist,
+    LevenshteinWorkspace::threadLocal());
+}
+
 template<typename Container1, typename Container2>
-std::size_t levenshtein(const Container1& a, const Container2& b) {
-  return LevenshteinContainer<has_data_and_size<Container1>::value &&
-    has_data_and_size<Container2>::value>::calc(a, b);
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(const Container1& pattern,
+  const Container2& text, std::size_t maxDist) {
+  return levenshteinSearchOccurrences(pattern, text, maxDist, LevenshteinWorkspace::threadLocal());
+}
+
+template<typename Container1, typename Container2>
+std::vector<LevenshteinOccurrence> levenshteinSearchOccurrences(const Container1& pattern,
+  const Container2& text, std::size_t maxDist, LevenshteinWorkspace& workspace) {
+  typedef LevenshteinContainer<has_data_and_size<Container1>::value> Range1;
+  typedef LevenshteinContainer<has_data_and_size<Container2>::value> Range2;
+  return levenshteinSearchOccurrences(Range1::begin(pattern), Range1::end(pattern),
+    Range2::begin(text), Range2::end(text), maxDist, workspace);
 }
 }
 
@@ -0,0 +1,375 @@
+/* Benchmarking */
+#include "levenshtein-sse.hpp"
+#include "FileMappedString.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Sweeps over input lengths, alphabet sizes, similarities and element types
+ * and prints one line per combination, as CSV or as JSON (one object per
+ * line). The instruction set is the one picked by the library, so build
+ * this once per instruction set to compare them (see `make bench`).
+ *
+ * Options (lists are comma-separated):
+ *   --inputs=synthetic,loremipsum
+ *                          the generated inputs below and/or the pairs of
+ *                          test/assets/loremipsum_* files (UTF-8 as char,
+ *                          UTF-16 as char16_t and, just to exercise the
+ *                          4-byte kernels, as uint32_t)
+ *   --lengths=8,64,...     length of the first input of each pair
+ *   --alphabets=4,26,...   number of distinct elements in the inputs
+ *   --similarities=0.5,... fraction of the first input that is left
+ *                          unchanged in the second one (0 means unrelated)
+ *   --types=char,char16_t,uint32_t
+ *   --algorithms=levenshtein,diagonal,osa,damerau
+ *                          levenshtein(), the diagonal kernels on the
+ *                          whole table (without the adaptive band and
+ *                          without skipping common prefixes and suffixes),
+ *                          levenshteinOSA(), or levenshteinDamerau()
+ *                          (which skips synthetic lengths above 65536:
+ *                          it stops using SIMD at 65535 elements, and
+ *                          these would take minutes per pair)
+ *   --repetitions=N        timed repetitions, the median is reported
+ *   --min-time=MS          minimum duration of one repetition
+ *   --format=csv|json
+ *   --no-header            omit the CSV header
+ *
+ * cells_per_second is the size of the whole table divided by the time, so
+ * for the diagonal algorithm it is the throughput of the kernels, while
+ * for levenshtein() it also reflects the parts of the table that were
+ * skipped. Pairs that take longer than repetitions * min-time are only
+ * computed once.
+ *
+ * The inputs are generated from a fixed seed, so the results are
+ * reproducible across builds and machines. The longest default lengths
+ * take most of the time; pass e.g. --lengths=8,1024 for a quick run.
+ */
+
+static const char* const isaNames[] = { "scalar", "sse2", "ssse3", "sse4.1", "avx2", "avx512" };
+static const char* const isa = isaNames[levenshteinSSE::cpuLevel()];
+
+struct Options {
+  std::vector<std::string> inputs { "synthetic", "loremipsum" };
+  std::vector<std::size_t> lengths { 8, 16, 64, 256, 1024, 4096, 16384, 65536, 300000 };
+  std::vector<std::size_t> alphabets { 4, 26, 128 };
+  std::vector<double> similarities { 0.5, 0.9 };
+  std::vector<std::string> types { "char", "char16_t", "uint32_t" };
+  std::vector<std::string> algorithms { "levenshtein", "diagonal", "osa", "damerau" };
+  int repetitions = 5;
+  double minTime = 20;
+  bool json = false;
+  bool header = true;
+};
+
+struct Result {
+  std::size_t distance; // of the first pair
+  std::size_t pairs;    // per repetition
+  int repetitions;
+  double cells;         // table entries per pair
+  double nsPerPair;
+};
+
+template<typename T>
+static std::vector<T> parseList(const std::string& list) {
+  std::vector<T> result;
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    std::istringstream itemIn(item);
+    T value;
+    if (!(itemIn >> value)) {
+      std::cerr << "invalid list entry: " << item << "\n";
+      std::exit(1);
+    }
+    result.push_back(value);
+  }
+  return result;
+}
+
+/**
+ * count pairs of inputs, as a[0], b[0], a[1], b[1], ...
+ */
+template<typename T>
+static std::vector<std::vector<T>> makePairs(std::size_t length, std::size_t alphabet,
+  double similarity, std::size_t count) {
+  std::mt19937 rng(length * 1000003 + alphabet * 101 + std::size_t(similarity * 100));
+  std::uniform_int_distribution<std::size_t> element(0, alphabet - 1);
+  std::vector<std::vector<T>> inputs;
+
+  for (std::size_t p = 0; p < count; ++p) {
+    std::vector<T> a(length), b;
+    for (T& x : a)
+      x = T(' ' + element(rng));
+
+    if (similarity <= 0) {
+      b.resize(length);
+      for (T& x : b)
+        x = T(' ' + element(rng));
+    } else {
+      // (1 - similarity) * length random edits
+      b = a;
+      const std::size_t edits = std::size_t((1 - similarity) * length + 0.5);
+      for (std::size_t e = 0; e < edits; ++e) {
+        const std::size_t pos = b.empty() ? 0 : rng() % b.size();
+        switch (b.empty() ? 1 : rng() % 3) {
+          case 0: b[pos] = T(' ' + element(rng)); break;
+          case 1: b.insert(b.begin() + pos, T(' ' + element(rng))); break;
+          case 2: b.erase(b.begin() + pos); break;
+        }
+      }
+    }
+
+    inputs.push_back(std::move(a));
+    inputs.push_back(std::move(b));
+  }
+
+  return inputs;
+}
+
+template<typename T>
+static std::size_t distance(const std::vector<T>& a, const std::vector<T>& b,
+  const std::string& algorithm, levenshteinSSE::LevenshteinWorkspace& workspace) {
+  if (algorithm == "osa") {
+    return levenshteinSSE::levenshteinOSA(a, b, workspace);
+  }
+
+  if (algorithm == "damerau") {
+    return levenshteinSSE::levenshteinDamerau(a, b, workspace);
+  }
+
+  if (algorithm != "diagonal" || a.empty() || b.empty()) {
+    return levenshteinSSE::levenshtein(a, b, workspace);
+  }
+
+  // The bit-parallel engine is preferred for these inputs when calling
+  // levenshtein(), and the diagonal engine would try narrow bands first,
+  // so call the diagonal kernels on the whole table directly.
+  const std::vector<T>& shorter = a.size() <= b.size() ? a : b;
+  const std::vector<T>& longer = a.size() <= b.size() ? b : a;
+  return levenshteinSSE::LevenshteinEngine<false>::calcFull(shorter.data(),
+    shorter.data() + shorter.size(), longer.data(), longer.data() + longer.size(), workspace);
+}
+
+/**
+ * Time the given pairs of inputs (as a[0], b[0], a[1], b[1], ...).
+ */
+template<typename T>
+static Result measure(const Options& options, const std::vector<std::vector<T>>& inputs,
+  const std::string& algorithm) {
+  typedef std::chrono::steady_clock Clock;
+  levenshteinSSE::LevenshteinWorkspace workspace;
+  const std::size_t count = inputs.size() / 2;
+
+  Result result;
+  result.cells = 0;
+  for (std::size_t p = 0; p < count; ++p)
+    result.cells += double(inputs[2 * p].size()) * inputs[2 * p + 1].size() / count;
+
+  // warm-up, which also tells how many pairs make up one repetition
+  auto start = Clock::now();
+  for (std::size_t p = 0; p < count; ++p) {
+    const std::size_t d = distance(inputs[2 * p], inputs[2 * p + 1], algorithm, workspace);
+    if (p == 0)
+      result.distance = d;
+  }
+  const double msPerPair = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / count;
+  result.pairs = std::max<std::size_t>(1, std::size_t(options.minTime / std::max(msPerPair, 1e-6)));
+
+  // (a single long pair is its own repetition)
+  if (count == 1 && msPerPair > options.minTime * options.repetitions) {
+    result.repetitions = 1;
+    result.nsPerPair = msPerPair * 1e6;
+    return result;
+  }
+
+  result.repetitions = options.repetitions;
+  std::vector<double> times;
+  std::size_t checksum = 0;
+  for (int r = 0; r < options.repetitions; ++r) {
+    start = Clock::now();
+    for (std::size_t i = 0; i < result.pairs; ++i) {
+      const std::size_t p = i % count;
+      checksum += distance(inputs[2 * p], inputs[2 * p + 1], algorithm, workspace);
+    }
+    times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+  }
+
+  // (so that the computations cannot be optimized away)
+  if (checksum == std::size_t(-1))
+    std::cerr << checksum;
+
+  std::sort(times.begin(), times.end());
+  result.nsPerPair = times[times.size() / 2] / result.pairs;
+  return result;
+}
+
+/**
+ * Print one result; alphabet and similarity are empty for the assets.
+ */
+static void print(const Options& options, const std::string& input, const std::string& algorithm,
+  const std::string& type, std::size_t length, const std::string& alphabet,
+  const std::string& similarity, const Result& r) {
+  const double cellsPerSecond = r.cells / r.nsPerPair * 1e9;
+
+  if (options.json) {
+    std::cout << "{\"isa\": \"" << isa << "\", \"input\": \"" << input
+              << "\", \"algorithm\": \"" << algorithm
+              << "\", \"type\": \"" << type << "\", \"length\": " << length
+              << ", \"alphabet\": " << (alphabet.empty() ? "null" : alphabet)
+              << ", \"similarity\": " << (similarity.empty() ? "null" : similarity)
+              << ", \"distance\": " << r.distance << ", \"pairs\": " << r.pairs
+              << ", \"repetitions\": " << r.repetitions
+              << ", \"ns_per_pair\": " << r.nsPerPair
+              << ", \"cells_per_second\": " << cellsPerSecond << "}" << std::endl;
+  } else {
+    std::cout << isa << "," << input << "," << algorithm << "," << type << "," << length << ","
+              << alphabet << "," << similarity << "," << r.distance << ","
+              << r.pairs << "," << r.repetitions << "," << r.nsPerPair << ","
+              << cellsPerSecond << std::endl;
+  }
+}
+
+template<typename T>
+static std::string str(const T& value) {
+  std::ostringstream out;
+  out << value;
+  return out.str();
+}
+
+template<typename T>
+static void runSynthetic(const Options& options, const std::string& type) {
+  for (const std::string& algorithm : options.algorithms) {
+    for (std::size_t length : options.lengths) {
+      if (algorithm == "damerau" && length > 65536)
+        continue;
+
+      for (std::size_t alphabet : options.alphabets) {
+        for (double similarity : options.similarities) {
+          // a few different pairs, so that short inputs are not always the same
+          const std::size_t count = length <= 1024 ? 16 : 1;
+          const Result r = measure<T>(options, makePairs<T>(length, alphabet, similarity, count),
+            algorithm);
+          print(options, "synthetic", algorithm, type, length, str(alphabet), str(similarity), r);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * The pairs of test/assets/loremipsum_* files with the given suffix,
+ * read as elements of type T.
+ */
+template<typename T>
+static void runAssets(const Options& options, const std::string& type,
+  const std::vector<std::string>& sizes, const std::string& suffix) {
+  for (const std::string& algorithm : options.algorithms) {
+    for (const std::string& size : sizes) {
+      const std::string name = "loremipsum_" + size + "." + suffix;
+      FileMappedString<T> a("test/assets/loremipsum_1-" + size + "." + suffix);
+      FileMappedString<T> b("test/assets/loremipsum_2-" + size + "." + suffix);
+      const std::vector<std::vector<T>> inputs {
+        std::vector<T>(a.begin(), a.end()), std::vector<T>(b.begin(), b.end()) };
+      const Result r = measure<T>(options, inputs, algorithm);
+      print(options, name, algorithm, type, inputs[0].size(), "", "", r);
+    }
+  }
+}
+
+template<typename T>
+static void run(const Options& options, const std::string& type) {
+  for (const std::string& input : options.inputs) {
+    if (input == "synthetic") {
+      runSynthetic<T>(options, type);
+    } else if (std::is_same<T, char>::value) {
+      runAssets<T>(options, type, { "16k", "64k" }, "utf8");
+    } else if (std::is_same<T, char16_t>::value) {
+      runAssets<T>(options, type, { "16k", "64k" }, "utf16");
+    } else {
+      runAssets<T>(options, type, { "16k" }, "utf16");
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const std::size_t eq = arg.find('=');
+    const std::string name = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (name == "--inputs") {
+      options.inputs = parseList<std::string>(value);
+    } else if (name == "--lengths") {
+      options.lengths = parseList<std::size_t>(value);
+    } else if (name == "--alphabets") {
+      options.alphabets = parseList<std::size_t>(value);
+    } else if (name == "--similarities") {
+      options.similarities = parseList<double>(value);
+    } else if (name == "--types") {
+      options.types = parseList<std::string>(value);
+    } else if (name == "--algorithms") {
+      options.algorithms = parseList<std::string>(value);
+    } else if (name == "--repetitions") {
+      options.repetitions = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--min-time") {
+      options.minTime = std::atof(value.c_str());
+    } else if (name == "--format" && (value == "csv" || value == "json")) {
+      options.json = value == "json";
+    } else if (name == "--no-header") {
+      options.header = false;
+    } else {
+      std::cerr << "unknown option: " << arg << "\n";
+      return 1;
+    }
+  }
+
+  for (const std::string& input : options.inputs) {
+    if (input != "synthetic" && input != "loremipsum") {
+      std::cerr << "unknown input: " << input << "\n";
+      return 1;
+    }
+  }
+
+  for (const std::string& algorithm : options.algorithms) {
+    if (algorithm != "levenshtein" && algorithm != "diagonal" && algorithm != "osa" &&
+        algorithm != "damerau") {
+      std::cerr << "unknown algorithm: " << algorithm << "\n";
+      return 1;
+    }
+  }
+
+  for (std::size_t alphabet : options.alphabets) {
+    // the elements are ' ' + [0, alphabet), which needs to fit into a char
+    if (alphabet == 0 || alphabet > 224) {
+      std::cerr << "alphabet sizes need to be between 1 and 224\n";
+      return 1;
+    }
+  }
+
+  if (!options.json && options.header) {
+    std::cout << "isa,input,algorithm,type,length,alphabet,similarity,distance,pairs,repetitions,"
+                 "ns_per_pair,cells_per_second" << std::endl;
+  }
+
+  for (const std::string& type : options.types) {
+    if (type == "char") {
+      run<char>(options, type);
+    } else if (type == "char16_t") {
+      run<char16_t>(options, type);
+    } else if (type == "uint32_t") {
+      run<std::uint32_t>(options, type);
+    } else {
+      std::cerr << "unknown type: " << type << "\n";
+      return 1;
+    }
+  }
+}
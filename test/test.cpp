@@ -2,13 +2,48 @@
 #include "levenshtein-sse.hpp"
 #include "FileMappedString.hpp"
 #include <chrono>
+#include <tuple>
 #include <list>
 #include <deque>
 #include <array>
 #include <iostream>
 #include <typeinfo>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 
 using levenshteinSSE::levenshtein;
+using levenshteinSSE::levenshteinBounded;
+using levenshteinSSE::levenshteinLowerBound;
+using levenshteinSSE::levenshteinUpperBound;
+using levenshteinSSE::levenshteinIfWithin;
+using levenshteinSSE::levenshteinUtf8;
+using levenshteinSSE::LevenshteinExact;
+using levenshteinSSE::LevenshteinAsciiCaseInsensitive;
+using levenshteinSSE::LevenshteinFoldTable;
+using levenshteinSSE::LevenshteinMatcher;
+using levenshteinSSE::levenshteinBatch;
+using levenshteinSSE::ParallelPolicy;
+using levenshteinSSE::LevenshteinWorkspace;
+using levenshteinSSE::levenshteinAlignment;
+using levenshteinSSE::EditRun;
+using levenshteinSSE::levenshteinTopK;
+using levenshteinSSE::LevenshteinMatch;
+using levenshteinSSE::LevenshteinIndex;
+using levenshteinSSE::LevenshteinTrie;
+using levenshteinSSE::levenshteinMatrix;
+using levenshteinSSE::levenshteinWeighted;
+using levenshteinSSE::LevenshteinUnitCosts;
+using levenshteinSSE::LevenshteinWeights;
+using levenshteinSSE::LevenshteinCostTable;
+using levenshteinSSE::levenshteinOSA;
+using levenshteinSSE::levenshteinDamerau;
+using levenshteinSSE::LevenshteinStream;
+using levenshteinSSE::LevenshteinIncremental;
+using levenshteinSSE::levenshteinSearch;
+using levenshteinSSE::levenshteinSearchOccurrences;
+using levenshteinSSE::LevenshteinOccurrence;
 
 template<typename CharT>
 void levenshteinStringExpect(const std::string& a, const std::string& b, std::uint32_t expected) {
@@ -58,6 +93,456 @@ void levenshteinFileExpect(const std::string& a, const std::string& b, std::uint
     std::exit(1);
 }
 
+template<typename CharT>
+void levenshteinParallelFileExpect(const std::string& a, const std::string& b, ParallelPolicy policy,
+  std::uint32_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto distance = levenshtein(FileMappedString<CharT>(a), FileMappedString<CharT>(b), policy);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+  
+  std::cerr << "A = " << a << "\nB = " << b << "\nT = " << typeid(CharT).name()
+            << "\nthreads = " << policy.threads << ", tileSize = " << policy.tileSize
+            << "\ndistance = " << distance << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+  
+  if (distance != expected)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinWorkspaceExpect(LevenshteinWorkspace& workspace, const Container& a, const Container& b,
+  std::uint32_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto distance = levenshtein(a, b, workspace);
+  auto bounded = levenshteinBounded(a, b, expected, workspace);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nContainer = " << typeid(Container).name() << " (with workspace)"
+            << "\ndistance = " << distance << ", bounded = " << bounded << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+  
+  if (distance != expected || bounded != expected)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinBoundedExpect(const Container& a, const Container& b, std::size_t maxDist, std::size_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto distance = levenshteinBounded(a, b, maxDist);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nContainer = " << typeid(Container).name()
+            << "\nmaxDist = " << maxDist
+            << "\ndistance = " << distance << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+  
+  if (distance != expected)
+    std::exit(1);
+}
+
+template<typename CharT>
+void levenshteinBoundedFileExpect(const std::string& a, const std::string& b, std::size_t maxDist, std::size_t expected) {
+  FileMappedString<CharT> a_(a), b_(b);
+  levenshteinBoundedExpect(std::vector<CharT>(a_.begin(), a_.end()), std::vector<CharT>(b_.begin(), b_.end()),
+    maxDist, expected);
+}
+
+template<typename Container>
+void levenshteinBoundsExpect(const Container& a, const Container& b, std::size_t expectedLower,
+  std::size_t expectedUpper) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto lower = levenshteinLowerBound(a, b);
+  auto upper = levenshteinUpperBound(a, b);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+  auto distance = levenshtein(a, b);
+  bool within = levenshteinIfWithin(a, b, distance);
+  bool below = distance > 0 && levenshteinIfWithin(a, b, distance - 1);
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nContainer = " << typeid(Container).name()
+            << "\nlower = " << lower << ", expected = " << expectedLower
+            << "\nupper = " << upper << ", expected = " << expectedUpper
+            << "\ndistance = " << distance << ", within = " << within << ", below = " << below
+            << "\nTime: " << diff.count() << " ms\n";
+
+  if (lower != expectedLower || upper != expectedUpper || lower > distance || upper < distance ||
+    !within || below)
+    std::exit(1);
+}
+
+void levenshteinUtf8Expect(const std::string& a, const std::string& b, std::size_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto distance = levenshteinUtf8(a, b);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "A = " << a.substr(0, 80) << "\nB = " << b.substr(0, 80)
+            << "\ndistance = " << distance << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+
+  if (distance != expected)
+    std::exit(1);
+}
+
+void levenshteinUtf8InvalidExpect(const std::string& a) {
+  std::cerr << "invalid UTF-8 of " << a.size() << " bytes\n";
+  try {
+    levenshteinUtf8(a, std::string("x"));
+  } catch (const std::invalid_argument&) {
+    return;
+  }
+  std::exit(1);
+}
+
+template<typename Container1, typename Container2, typename Equality>
+void levenshteinEqualityExpect(const Container1& a, const Container2& b, const Equality& equal,
+  std::size_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto distance = levenshtein(a, b, equal);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+  auto bounded = levenshteinBounded(a, b, expected, equal);
+  auto below = expected > 0 ? levenshteinBounded(a, b, expected - 1, equal) : 0;
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nEquality = " << typeid(Equality).name()
+            << "\ndistance = " << distance << ", expected = " << expected
+            << "\nbounded = " << bounded << ", below = " << below
+            << "\nTime: " << diff.count() << " ms\n";
+
+  if (distance != expected || bounded != expected || below != expected)
+    std::exit(1);
+}
+
+template<typename Container1, typename Container2>
+void levenshteinAlignmentExpect(const Container1& a, const Container2& b, std::size_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<EditRun> script = levenshteinAlignment(a, b);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  // check that the script actually turns a into b
+  std::vector<typename std::decay<decltype(*std::begin(a))>::type> a_(std::begin(a), std::end(a));
+  std::vector<typename std::decay<decltype(*std::begin(b))>::type> b_(std::begin(b), std::end(b));
+  std::size_t i = 0, j = 0, distance = 0;
+  bool valid = true;
+  for (const EditRun& run : script) {
+    for (std::size_t k = 0; k < run.length && valid; ++k) {
+      const bool consumesA = run.operation != levenshteinSSE::editInsert;
+      const bool consumesB = run.operation != levenshteinSSE::editDelete;
+      valid = (!consumesA || i < a_.size()) && (!consumesB || j < b_.size());
+      if (valid && consumesA && consumesB)
+        valid = levenshteinSSE::levenshteinElementsEqual(a_[i], b_[j]) ==
+          (run.operation == levenshteinSSE::editMatch);
+      i += consumesA;
+      j += consumesB;
+      distance += run.operation != levenshteinSSE::editMatch;
+    }
+  }
+  valid = valid && i == a_.size() && j == b_.size();
+
+  std::cerr << "a.size() = " << a_.size() << "\nb.size() = " << b_.size()
+            << "\nContainer = " << typeid(Container1).name() << " (alignment)"
+            << "\nruns = " << script.size() << ", valid = " << valid
+            << "\ndistance = " << distance << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+  
+  if (!valid || distance != expected)
+    std::exit(1);
+}
+
+template<typename Container, typename Costs>
+void levenshteinWeightedExpect(const Container& a, const Container& b, const Costs& costs, std::size_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto distance = levenshteinWeighted(a, b, costs);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nContainer = " << typeid(Container).name()
+            << "\nCosts = " << typeid(Costs).name()
+            << "\ndistance = " << distance << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+  
+  if (distance != expected)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinTranspositionExpect(const Container& a, const Container& b,
+  std::size_t expectedOSA, std::size_t expectedDamerau) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto osa = levenshteinOSA(a, b);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto damerau = levenshteinDamerau(a, b);
+  auto end2 = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+  auto diff2 = std::chrono::duration_cast<std::chrono::milliseconds>(end2-end);
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nContainer = " << typeid(Container).name()
+            << "\nOSA = " << osa << ", expected = " << expectedOSA
+            << "\nDamerau = " << damerau << ", expected = " << expectedDamerau
+            << "\nTime: " << diff.count() << " ms (OSA), " << diff2.count() << " ms (Damerau)\n";
+  
+  if (osa != expectedOSA || damerau != expectedDamerau)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinStreamExpect(const Container& a, const Container& b,
+  std::size_t chunkSize, std::size_t expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  LevenshteinStream<typename Container::value_type> stream(a);
+  std::size_t fed = 0;
+  for (auto it = b.begin(); it != b.end(); ) {
+    Container chunk;
+    for (std::size_t i = 0; i < chunkSize && it != b.end(); ++i, ++it, ++fed)
+      chunk.insert(chunk.end(), *it);
+    stream.feed(chunk);
+    if (stream.consumed() != fed)
+      std::exit(1);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "a.size() = " << a.size() << "\nb.size() = " << b.size()
+            << "\nchunkSize = " << chunkSize << "\nContainer = " << typeid(Container).name()
+            << "\nresult = " << stream.currentDistance() << ", expected = " << expected
+            << "\nTime: " << diff.count() << " ms\n";
+  
+  if (stream.currentDistance() != expected)
+    std::exit(1);
+
+  stream.reset();
+  if (stream.consumed() != 0 || stream.currentDistance() != a.size())
+    std::exit(1);
+}
+
+// Apply edits (position, number of removed elements, inserted elements)
+// one at a time and compare to levenshtein() after each of them.
+template<typename Container>
+void levenshteinIncrementalExpect(const Container& reference, Container doc,
+  std::size_t checkpointInterval,
+  const std::vector<std::tuple<std::size_t, std::size_t, Container>>& edits) {
+  LevenshteinIncremental<typename Container::value_type> incremental(reference, checkpointInterval);
+  incremental.assign(doc);
+  std::chrono::high_resolution_clock::duration time(0);
+
+  for (const auto& edit : edits) {
+    const std::size_t pos = std::get<0>(edit), count = std::get<1>(edit);
+    const Container& inserted = std::get<2>(edit);
+    doc.erase(doc.begin() + pos, doc.begin() + pos + std::min(count, doc.size() - pos));
+    doc.insert(doc.begin() + pos, inserted.begin(), inserted.end());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    incremental.replace(pos, count, inserted);
+    const std::size_t result = incremental.distance();
+    time += std::chrono::high_resolution_clock::now() - start;
+
+    const std::size_t expected = levenshtein(reference, doc);
+    if (result != expected) {
+      std::cerr << "reference.size() = " << reference.size() << "\ndoc.size() = " << doc.size()
+                << "\ncheckpointInterval = " << checkpointInterval
+                << "\nContainer = " << typeid(Container).name()
+                << "\nedit = " << pos << ", " << count << ", " << inserted.size()
+                << "\nresult = " << result << ", expected = " << expected << "\n";
+      std::exit(1);
+    }
+  }
+
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(time);
+  std::cerr << "reference.size() = " << reference.size() << "\ndoc.size() = " << doc.size()
+            << "\ncheckpointInterval = " << checkpointInterval << "\nedits = " << edits.size()
+            << "\nContainer = " << typeid(Container).name()
+            << "\nTime: " << diff.count() << " ms\n";
+}
+
+// expected holds (start, end, distance) for each end position
+template<typename Container>
+void levenshteinSearchExpect(const Container& pattern, const Container& text, std::size_t maxDist,
+  const std::vector<std::tuple<std::size_t, std::size_t, std::size_t>>& expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<LevenshteinMatch> ends = levenshteinSearch(pattern, text, maxDist);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::vector<LevenshteinOccurrence> occurrences = levenshteinSearchOccurrences(pattern, text, maxDist);
+  auto end2 = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+  auto diff2 = std::chrono::duration_cast<std::chrono::milliseconds>(end2-end);
+
+  std::vector<std::tuple<std::size_t, std::size_t, std::size_t>> actual;
+  for (const LevenshteinOccurrence& occurrence : occurrences)
+    actual.emplace_back(occurrence.start, occurrence.end, occurrence.distance);
+
+  std::cerr << "pattern.size() = " << pattern.size() << "\ntext.size() = " << text.size()
+            << "\nmaxDist = " << maxDist << "\nContainer = " << typeid(Container).name()
+            << "\noccurrences =";
+  for (std::size_t i = 0; i < actual.size() && i < 16; ++i)
+    std::cerr << " [" << std::get<0>(actual[i]) << ", " << std::get<1>(actual[i]) << "):" << std::get<2>(actual[i]);
+  std::cerr << "\nexpected =";
+  for (std::size_t i = 0; i < expected.size() && i < 16; ++i)
+    std::cerr << " [" << std::get<0>(expected[i]) << ", " << std::get<1>(expected[i]) << "):" << std::get<2>(expected[i]);
+  std::cerr << "\nTime: " << diff.count() << " ms (ends), " << diff2.count() << " ms (occurrences)\n";
+
+  if (actual != expected || ends.size() != expected.size())
+    std::exit(1);
+  for (std::size_t i = 0; i < ends.size(); ++i) {
+    if (ends[i].index != std::get<1>(expected[i]) || ends[i].distance != std::get<2>(expected[i]))
+      std::exit(1);
+  }
+}
+
+// substituting one vowel for another is cheap
+struct VowelCosts {
+  static bool vowel(char c) { return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u'; }
+  std::uint32_t insertion(char) const { return 2; }
+  std::uint32_t deletion(char) const { return 2; }
+  std::uint32_t substitution(char x, char y) const { return x == y ? 0 : vowel(x) && vowel(y) ? 1 : 3; }
+};
+
+template<typename Container>
+void levenshteinMatcherExpect(const Container& query, const std::vector<Container>& candidates,
+  const std::vector<std::size_t>& expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  LevenshteinMatcher<typename Container::value_type> matcher(query);
+  std::vector<std::size_t> distances(candidates.size());
+  matcher.distances(candidates.begin(), candidates.end(), distances.begin());
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "query.size() = " << query.size() << "\ncandidates.size() = " << candidates.size()
+            << "\nContainer = " << typeid(Container).name() << "\ndistances =";
+  for (std::size_t i = 0; i < distances.size(); ++i)
+    std::cerr << " " << distances[i] << " (expected " << expected[i] << ")";
+  std::cerr << "\nTime: " << diff.count() << " ms\n";
+  
+  if (distances != expected)
+    std::exit(1);
+
+  // a matcher reset() from another query gives the same results
+  Container other(query);
+  other.insert(other.end(), query.begin(), query.end());
+  LevenshteinMatcher<typename Container::value_type> reused(other);
+  reused.reset(query.begin(), query.end());
+  reused.distances(candidates.begin(), candidates.end(), distances.begin());
+  if (distances != expected)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinTopKExpect(const Container& query, const std::vector<Container>& candidates,
+  std::size_t k, std::size_t maxDist, const std::vector<std::pair<std::size_t, std::size_t>>& expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<LevenshteinMatch> matches = levenshteinTopK(query, candidates, k, maxDist);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::vector<std::pair<std::size_t, std::size_t>> actual;
+  for (const LevenshteinMatch& match : matches)
+    actual.emplace_back(match.index, match.distance);
+
+  std::cerr << "query.size() = " << query.size() << "\ncandidates.size() = " << candidates.size()
+            << "\nk = " << k << "\nmaxDist = " << maxDist
+            << "\nContainer = " << typeid(Container).name() << "\nmatches =";
+  for (std::size_t i = 0; i < actual.size() && i < 16; ++i)
+    std::cerr << " " << actual[i].first << ":" << actual[i].second;
+  std::cerr << "\nexpected =";
+  for (std::size_t i = 0; i < expected.size() && i < 16; ++i)
+    std::cerr << " " << expected[i].first << ":" << expected[i].second;
+  std::cerr << "\nTime: " << diff.count() << " ms\n";
+
+  if (actual != expected)
+    std::exit(1);
+}
+
+template<typename Container, typename Index>
+void levenshteinIndexExpect(const Index& index,
+  const std::vector<Container>& terms, const Container& query, std::size_t maxDist) {
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<LevenshteinMatch> matches = index.query(query, maxDist);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end-start);
+
+  std::vector<std::pair<std::size_t, std::size_t>> actual, expected;
+  for (const LevenshteinMatch& match : matches)
+    actual.emplace_back(match.distance, match.index);
+  for (std::size_t i = 0; i < terms.size(); ++i) {
+    const std::size_t distance = levenshtein(query, terms[i]);
+    if (distance <= maxDist)
+      expected.emplace_back(distance, i);
+  }
+  std::sort(expected.begin(), expected.end());
+
+  std::cerr << "terms.size() = " << terms.size() << "\nquery.size() = " << query.size()
+            << "\nmaxDist = " << maxDist << "\nIndex = " << typeid(Index).name()
+            << "\nmatches = " << actual.size() << " (expected " << expected.size() << ")"
+            << "\nTime: " << diff.count() << " us\n";
+
+  if (actual != expected)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinMatrixExpect(const std::vector<Container>& sequences, ParallelPolicy policy) {
+  const std::size_t n = sequences.size();
+  std::vector<std::size_t> expected;
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = i + 1; j < n; ++j)
+      expected.push_back(levenshtein(sequences[i], sequences[j]));
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::size_t> distances(expected.size() + 1, std::size_t(-1));
+  const auto last = levenshteinMatrix(sequences, distances.begin(), policy);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "sequences.size() = " << n << "\nthreads = " << policy.threads
+            << "\ntileSize = " << policy.tileSize << "\nContainer = " << typeid(Container).name()
+            << "\ndistances =";
+  for (std::size_t i = 0; i < expected.size() && i < 16; ++i)
+    std::cerr << " " << distances[i] << " (expected " << expected[i] << ")";
+  std::cerr << "\nTime: " << diff.count() << " ms\n";
+
+  // nothing is written past the triangle
+  if (last != distances.end() - 1 || distances.back() != std::size_t(-1))
+    std::exit(1);
+  distances.pop_back();
+  if (distances != expected)
+    std::exit(1);
+}
+
+template<typename Container>
+void levenshteinBatchExpect(const std::vector<std::pair<Container, Container>>& pairs,
+  const std::vector<std::size_t>& expected) {
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::size_t> distances;
+  levenshteinBatch(pairs, std::back_inserter(distances));
+  auto end = std::chrono::high_resolution_clock::now();
+  auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(end-start);
+
+  std::cerr << "pairs.size() = " << pairs.size() << "\nContainer = " << typeid(Container).name()
+            << "\ndistances =";
+  for (std::size_t i = 0; i < distances.size() && i < 16; ++i)
+    std::cerr << " " << distances[i] << " (expected " << expected[i] << ")";
+  std::cerr << "\nTime: " << diff.count() << " ms\n";
+  
+  if (distances != expected)
+    std::exit(1);
+
+  LevenshteinWorkspace workspace;
+  distances.clear();
+  levenshteinBatch(pairs.begin(), pairs.end(), std::back_inserter(distances), workspace);
+  if (distances != expected)
+    std::exit(1);
+}
+
 int main() {
   levenshteinStringExpect<char>("Saturday", "Sunday", 3);
   levenshteinStringExpect<char>("Sitting", "Kittens", 3);
@@ -79,7 +564,19 @@ int main() {
   levenshteinStringExpect<char>("A", "Sitting", 7);
   levenshteinStringExpect<char>("", "Sitting", 7);
   levenshteinStringExpect<char>("Sitting", "Sitting", 0);
-  
+  levenshteinStringExpect<char>(
+    "Sphinx of black quartz, judge my vow; pack my box with liquor 64",
+    "Kphinx of black quartz: judge my vow, pack my box with liquor jugs", 7);
+  levenshteinStringExpect<char16_t>(
+    "Sphinx of black quartz, judge my vow; pack my box with liquor 64",
+    "Kphinx of black quartz: judge my vow, pack my box with liquor jugs", 7);
+  levenshteinStringExpect<char>(
+    "The quick brown fox jumps over the lazy dog. The five boxing wizards jump quickly. Sphinx of black quartz, judge my vow",
+    "A quick brown dog jumps over the lazy fox. Five boxing wizards jumped quickly! Sphinx of black quartz: judge my vow, please.", 25);
+  levenshteinStringExpect<char32_t>(
+    "The quick brown fox jumps over the lazy dog. The five boxing wizards jump quickly. Sphinx of black quartz, judge my vow",
+    "A quick brown dog jumps over the lazy fox. Five boxing wizards jumped quickly! Sphinx of black quartz: judge my vow, please.", 25);
+
   levenshteinContainerExpect<std::vector<char>>(
     {'S', 'i', 't', 't', 'i', 'n', 'g'},
     {'K', 'i', 't', 't', 'e', 'n'},
@@ -114,6 +611,24 @@ int main() {
     {2, 3, 5, 7, 11, 13, 17, 19, 23, 29},
     {1, 3, 5, 7, 9, 11, 13, 15, 17, 19},
     5);
+
+  {
+    // long common prefixes and suffixes, with differences at all offsets
+    // within a SIMD register
+    FileMappedString<char> file("test/assets/loremipsum_1-16k.utf8");
+    const std::string a(file.begin(), file.end());
+    for (std::size_t at : {0, 1, 15, 16, 17, 31, 32, 33, 8000, 16000}) {
+      std::string b = a;
+      b[at] = '#';
+      b.insert(b.size() - at % 40, "##");
+      levenshteinContainerExpect(a, b, 3);
+      levenshteinContainerExpect(std::u16string(a.begin(), a.end()), std::u16string(b.begin(), b.end()), 3);
+      levenshteinContainerExpect(std::vector<std::uint64_t>(a.begin(), a.end()),
+        std::vector<std::uint64_t>(b.begin(), b.end()), 3);
+    }
+    levenshteinContainerExpect(std::u32string(U"x"), std::u32string(a.begin(), a.end()), 16383);
+    levenshteinContainerExpect(std::u32string(U"#"), std::u32string(a.begin(), a.end()), 16384);
+  }
   
   levenshteinContainerExpect<std::vector<float>>(
     {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
@@ -141,5 +656,449 @@ int main() {
   levenshteinFileExpect<std::uint32_t>("test/assets/random1024_1", "test/assets/random1024_2", 256);
   levenshteinFileExpect<std::uint32_t>("test/assets/random8192_1", "test/assets/random8192_2", 2048);
   // levenshteinFileExpect<char>("test/assets/loremipsum_1.utf8", "test/assets/loremipsum_2.utf8", 218919);
+
+  levenshteinParallelFileExpect<char>("test/assets/loremipsum_1-64k.utf8", "test/assets/loremipsum_2-64k.utf8",
+    ParallelPolicy(4), 49618);
+  levenshteinParallelFileExpect<short>("test/assets/loremipsum_1-16k.utf16", "test/assets/loremipsum_2-16k.utf16",
+    ParallelPolicy(3, 1000), 12450);
+  levenshteinParallelFileExpect<char>("test/assets/random1024_1", "test/assets/random1024_2",
+    ParallelPolicy(2, 100), 1011);
+
+  {
+    // one workspace for inputs of different lengths, types and algorithms
+    LevenshteinWorkspace workspace;
+    FileMappedString<char> random1("test/assets/random1024_1"), random2("test/assets/random1024_2");
+    FileMappedString<short> lorem1("test/assets/loremipsum_1-16k.utf16"), lorem2("test/assets/loremipsum_2-16k.utf16");
+    const std::string r1(random1.begin(), random1.end()), r2(random2.begin(), random2.end());
+    const std::vector<short> l1(lorem1.begin(), lorem1.end()), l2(lorem2.begin(), lorem2.end());
+    for (int i = 0; i < 2; ++i) {
+      levenshteinWorkspaceExpect<std::string>(workspace, "Saturday", "Sunday", 3);
+      levenshteinWorkspaceExpect(workspace, l1, l2, 12450);
+      levenshteinWorkspaceExpect(workspace, r1, r2, 1011);
+      levenshteinWorkspaceExpect(workspace, std::vector<float>(r1.begin(), r1.end()),
+        std::vector<float>(r2.begin(), r2.end()), 1011);
+      levenshteinWorkspaceExpect<std::list<int>>(workspace, {2, 3, 5, 7, 11, 13, 17, 19},
+        {1, 3, 5, 7, 9, 11, 13, 15, 17, 19}, 3);
+    }
+  }
+
+  levenshteinAlignmentExpect(std::string("Saturday"), std::string("Sunday"), 3);
+  levenshteinAlignmentExpect(std::string("Kitten"), std::u32string(U"Sitting"), 3);
+  levenshteinAlignmentExpect(std::string(""), std::string("abc"), 3);
+  levenshteinAlignmentExpect(std::list<int>{2, 3, 5, 7, 11, 13, 17, 19},
+    std::list<int>{1, 3, 5, 7, 9, 11, 13, 15, 17, 19}, 3);
+  levenshteinAlignmentExpect(FileMappedString<char>("test/assets/random1024_1"),
+    FileMappedString<char>("test/assets/random1024_2"), 1011);
+  levenshteinAlignmentExpect(FileMappedString<short>("test/assets/loremipsum_1-16k.utf16"),
+    FileMappedString<short>("test/assets/loremipsum_2-16k.utf16"), 12450);
+  if (std::getenv("LSTSSE_SLOW_TESTS")) {
+    levenshteinAlignmentExpect(FileMappedString<char>("test/assets/loremipsum_1.utf8"),
+      FileMappedString<char>("test/assets/loremipsum_2.utf8"), 218919);
+  }
+
+  levenshteinWeightedExpect<std::string>("Saturday", "Sunday", LevenshteinUnitCosts(), 3);
+  levenshteinWeightedExpect<std::string>("Saturday", "Sunday", LevenshteinWeights(), 3);
+  levenshteinWeightedExpect<std::string>("Saturday", "Sunday", LevenshteinWeights(1, 1, 3), 4);
+  levenshteinWeightedExpect<std::string>("Saturday", "Sunday", LevenshteinWeights(2, 3, 1), 7);
+  levenshteinWeightedExpect<std::string>("Kitten", "Sitting", LevenshteinWeights(1, 1, 3), 5);
+  levenshteinWeightedExpect<std::string>("", "abc", LevenshteinWeights(2, 3, 1), 6);
+  levenshteinWeightedExpect<std::string>("abc", "", LevenshteinWeights(2, 3, 1), 9);
+  levenshteinWeightedExpect<std::list<int>>({2, 3, 5, 7, 11, 13, 17, 19},
+    {1, 3, 5, 7, 9, 11, 13, 15, 17, 19}, LevenshteinWeights(1, 1, 3), 4);
+  levenshteinWeightedExpect<std::string>("Saturday", "Sunday", VowelCosts(), 7);
+  levenshteinWeightedExpect<std::string>("Kitten", "Sitting", VowelCosts(), 6);
+  {
+    LevenshteinCostTable costs(2, 2, 3);
+    costs.set('k', 's', 1);
+    costs.set('e', 'i', 1);
+    levenshteinWeightedExpect<std::string>("kitten", "sitting", costs, 4);
+    levenshteinWeightedExpect<std::string>("Kitten", "Sitting", costs, 6);
+
+    FileMappedString<char> a("test/assets/loremipsum_1-16k.utf8"), b("test/assets/loremipsum_2-16k.utf8");
+    const std::string a_(a.begin(), a.end()), b_(b.begin(), b.end());
+    levenshteinWeightedExpect(a_, b_, costs, 31193);
+    levenshteinWeightedExpect(a_, b_, LevenshteinWeights(1, 2, 3), 26985);
+    levenshteinWeightedExpect(a_.substr(0, 2000), b_.substr(0, 2000), VowelCosts(), 3312);
+  }
+
+  levenshteinTranspositionExpect<std::string>("ca", "abc", 3, 2);
+  levenshteinTranspositionExpect<std::string>("Saturday", "Sautrday", 1, 1);
+  levenshteinTranspositionExpect<std::string>("Kitten", "iKttne", 2, 2);
+  levenshteinTranspositionExpect<std::string>("", "", 0, 0);
+  levenshteinTranspositionExpect<std::u32string>(U"abcdef", U"badcfe", 3, 3);
+  levenshteinTranspositionExpect<std::list<int>>({1, 2, 3, 4}, {2, 1, 4, 3, 5}, 3, 3);
+  levenshteinTranspositionExpect<std::vector<float>>({1, 2}, {2, 3, 1}, 3, 2);
+  {
+    FileMappedString<char> a("test/assets/loremipsum_1-16k.utf8"), b("test/assets/loremipsum_2-16k.utf8");
+    const std::string a_(a.begin(), a.begin() + 4000), b_(b.begin(), b.begin() + 4000);
+    std::string swapped = a_;
+    for (std::size_t i = 100; i + 1 < swapped.size(); i += 150)
+      std::swap(swapped[i], swapped[i + 1]);
+    levenshteinTranspositionExpect(a_, swapped, 25, 25);
+    levenshteinTranspositionExpect(a_, b_, 2950, 2947);
+    levenshteinTranspositionExpect(std::vector<float>(a_.begin(), a_.end()),
+      std::vector<float>(b_.begin(), b_.end()), 2950, 2947);
+  }
+
+  for (std::size_t chunkSize : {1, 3, 16, 1000}) {
+    levenshteinStreamExpect<std::string>("Saturday", "Sunday", chunkSize, 3);
+    levenshteinStreamExpect<std::string>("", "Sunday", chunkSize, 6);
+    levenshteinStreamExpect<std::string>("Sunday", "", chunkSize, 6);
+    levenshteinStreamExpect<std::u16string>(u"kitten", u"sitting on the mat", chunkSize, 14);
+    levenshteinStreamExpect<std::vector<float>>({1, 2, 3, 4, 5}, {2, 3, 4, 6, 1, 2, 3, 4, 5, 7}, chunkSize, 5);
+    levenshteinStreamExpect<std::list<std::string>>({"Bananas", "are", "yellow"},
+      {"Bananas", "are", "always", "yellow"}, chunkSize, 1);
+  }
+  {
+    FileMappedString<char> a("test/assets/loremipsum_1-16k.utf8"), b("test/assets/loremipsum_2-16k.utf8");
+    const std::string a_(a.begin(), a.end()), b_(b.begin(), b.end());
+    const std::size_t expected = levenshtein(a_, b_);
+    levenshteinStreamExpect(a_, b_, 4096, expected);
+    levenshteinStreamExpect(b_.substr(0, 1000), a_, 777, levenshtein(b_.substr(0, 1000), a_));
+    levenshteinStreamExpect(std::vector<float>(a_.begin(), a_.begin() + 4000),
+      std::vector<float>(b_.begin(), b_.begin() + 4000), 500, levenshtein(a_.substr(0, 4000), b_.substr(0, 4000)));
+  }
+
+  levenshteinSearchExpect<std::string>("survey", "surgery and a survey", 2,
+    {{0, 5, 2}, {0, 6, 2}, {0, 7, 2}, {14, 18, 2}, {14, 19, 1}, {14, 20, 0}});
+  levenshteinSearchExpect<std::string>("abc", "xbc", 1, {{0, 3, 1}});
+  levenshteinSearchExpect<std::string>("ab", "", 2, {{0, 0, 2}});
+  levenshteinSearchExpect<std::string>("", "ab", 0, {{0, 0, 0}, {1, 1, 0}, {2, 2, 0}});
+  levenshteinSearchExpect<std::vector<float>>({1, 2, 3}, {5, 1, 2, 4, 3, 5, 1, 3}, 1,
+    {{1, 3, 1}, {1, 4, 1}, {1, 5, 1}, {6, 8, 1}});
+  levenshteinSearchExpect<std::list<int>>({1, 2, 3}, {5, 1, 2, 4, 3, 5, 1, 3}, 1,
+    {{1, 3, 1}, {1, 4, 1}, {1, 5, 1}, {6, 8, 1}});
+  {
+    FileMappedString<char> a("test/assets/loremipsum_1-16k.utf8"), b("test/assets/loremipsum_2-16k.utf8");
+    const std::string a_(a.begin(), a.end()), b_(b.begin(), b.end());
+    std::string pattern = a_.substr(5000, 300);
+    pattern[100] = '#';
+    pattern.erase(200, 1);
+    const std::size_t at = b_.size() / 2;
+    const std::string text = b_.substr(0, at) + a_.substr(5000, 300) + b_.substr(at);
+    // a substitution and a deletion in the pattern
+    levenshteinSearchExpect(pattern, text, 2, {{at, at + 300, 2}});
+    levenshteinSearchExpect(std::vector<float>(pattern.begin(), pattern.end()),
+      std::vector<float>(text.begin(), text.end()), 2, {{at, at + 300, 2}});
+  }
+
+  for (std::size_t checkpointInterval : {1, 2, 1024}) {
+    levenshteinIncrementalExpect<std::string>("Saturday", "", checkpointInterval,
+      {{0, 0, "Sunday"}, {1, 0, "at"}, {5, 0, "r"}, {3, 2, "u"}, {8, 0, "s"}, {0, 100, ""}});
+    levenshteinIncrementalExpect<std::u16string>(u"kitten", u"sitting", checkpointInterval,
+      {{0, 1, u"k"}, {4, 1, u"e"}, {6, 1, u""}, {6, 0, u" on the mat"}, {0, 6, u"mitten"}});
+  }
+  {
+    FileMappedString<char> a("test/assets/loremipsum_1-16k.utf8"), b("test/assets/loremipsum_2-16k.utf8");
+    const std::string a_(a.begin(), a.end()), b_(b.begin(), b.end());
+    std::vector<std::tuple<std::size_t, std::size_t, std::string>> edits;
+    for (std::size_t i = 0; i < 50; ++i)
+      edits.emplace_back(b_.size() - 2000 + 13 * i, 0, "x");
+    edits.emplace_back(b_.size() / 2, 100, "");
+    for (std::size_t i = 0; i < 50; ++i)
+      edits.emplace_back(b_.size() - 100 + i, 0, "y");
+    levenshteinIncrementalExpect(a_, b_, 1024, edits);
+
+    // the same as floats, on shorter inputs
+    levenshteinIncrementalExpect(std::vector<float>(a_.begin(), a_.begin() + 3000),
+      std::vector<float>(b_.begin(), b_.begin() + 3000), 256,
+      {{2900, 0, {1, 2, 3}}, {100, 5, {}}, {1500, 0, {32}}, {2990, 10, {}}});
+  }
+
+  levenshteinMatcherExpect<std::string>("Sitting",
+    {"Kitten", "Sitting", "", "Sittings", "A", "Kittens"},
+    {3, 0, 7, 1, 7, 3});
+  levenshteinMatcherExpect<std::u32string>(U"The quick brown fox jumps over the lazy dog. The five boxing wizards jump quickly. Sphinx of black quartz, judge my vow",
+    {U"A quick brown dog jumps over the lazy fox. Five boxing wizards jumped quickly! Sphinx of black quartz: judge my vow, please.", U"Sitting"},
+    {25, 114});
+  levenshteinMatcherExpect<std::vector<std::string>>({"Bananas", "are", "yellow"},
+    {{"Bananas", "are", "always", "yellow"}, {"Bananas", "are", "yellow"}, {}},
+    {1, 0, 3});
+  levenshteinMatcherExpect<std::vector<float>>({2, 3, 5, 7, 11, 13, 17, 19},
+    {{1, 3, 5, 7, 9, 11, 13, 15, 17, 19}, {2, 3, 5, 7}},
+    {3, 4});
+
+  levenshteinTopKExpect<std::string>("Sitting",
+    {"Kitten", "Sitting", "", "Sittings", "A", "Kittens", "sitting"}, 3, std::size_t(-1),
+    {{1, 0}, {3, 1}, {6, 1}});
+  levenshteinTopKExpect<std::string>("Sitting",
+    {"Kitten", "Sitting", "", "Sittings", "A", "Kittens", "sitting"}, 10, 3,
+    {{1, 0}, {3, 1}, {6, 1}, {0, 3}, {5, 3}});
+  levenshteinTopKExpect<std::string>("Sitting", {"Kitten", "Sitting"}, 0, std::size_t(-1), {});
+  levenshteinTopKExpect<std::vector<float>>({2, 3, 5, 7, 11, 13, 17, 19},
+    {{1, 3, 5, 7, 9, 11, 13, 15, 17, 19}, {2, 3, 5, 7}, {2, 3, 5, 7, 11, 13, 17}}, 2, 3,
+    {{2, 1}, {0, 3}});
+  {
+    // candidates derived from the query by a varying number of edits,
+    // in random order, so that the bound tightens while going through them
+    const FileMappedString<char> lorem("test/assets/loremipsum_1-16k.utf8");
+    const std::string query(lorem.begin() + 1000, lorem.begin() + 1200);
+    std::mt19937 rng(1);
+    std::vector<std::string> candidates;
+    for (std::size_t i = 0; i < 2000; ++i) {
+      std::string candidate = query;
+      const std::size_t edits = 1 + rng() % 80;
+      for (std::size_t e = 0; e < edits; ++e)
+        candidate[rng() % candidate.size()] = 'A' + rng() % 26;
+      candidates.push_back(candidate);
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> expected;
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+      expected.emplace_back(levenshtein(query, candidates[i]), i);
+    std::sort(expected.begin(), expected.end());
+    expected.resize(10);
+    for (auto& match : expected)
+      std::swap(match.first, match.second);
+
+    levenshteinTopKExpect(query, candidates, 10, std::size_t(-1), expected);
+  }
+
+  {
+    // the words of a text, with many near-duplicates
+    const FileMappedString<char> lorem("test/assets/loremipsum_1-64k.utf8");
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : lorem) {
+      if (c == ' ' || c == '\n') {
+        if (!word.empty())
+          words.push_back(word);
+        word.clear();
+      } else {
+        word.push_back(c);
+      }
+    }
+
+    LevenshteinIndex<char> index(words.begin(), words.end());
+    // a copy of the serialized index, as if it had been memory-mapped
+    std::vector<std::uint64_t> data((index.dataSize() + 7) / 8);
+    std::memcpy(data.data(), index.data(), index.dataSize());
+    const LevenshteinIndex<char> view(data.data(), index.dataSize());
+
+    for (const char* query : {"lorem", "ipsum", "Dolor", "consectetur", "x", "", "adipiscing,"}) {
+      levenshteinIndexExpect<std::string>(index, words, query, 0);
+      levenshteinIndexExpect<std::string>(view, words, query, 2);
+    }
+    levenshteinIndexExpect<std::string>(view, words, "sit", std::size_t(-1));
+
+    // corrupted copies: a child pointing back at the root, a term reaching
+    // past the elements, and a truncated buffer
+    for (std::size_t corruption = 0; corruption < 3; ++corruption) {
+      std::vector<std::uint64_t> corrupted(data);
+      std::size_t size = index.dataSize();
+      // Header is 24 bytes, each Node 32 (offset, length, index, firstChild, ...)
+      if (corruption == 0)
+        reinterpret_cast<std::uint32_t*>(&corrupted[3 + 4 * 1])[4] = 0;
+      else if (corruption == 1)
+        reinterpret_cast<std::uint32_t*>(&corrupted[3 + 4 * 2])[2] = 0xffffffff;
+      else
+        size -= 1;
+
+      std::cerr << "corrupted LevenshteinIndex data (" << corruption << ")\n";
+      try {
+        const LevenshteinIndex<char> invalid(corrupted.data(), size);
+        std::exit(1);
+      } catch (const std::invalid_argument&) {
+      }
+    }
+
+    std::vector<std::u16string> empty;
+    LevenshteinIndex<char16_t> emptyIndex(empty.begin(), empty.end());
+    levenshteinIndexExpect<std::u16string>(emptyIndex, empty, u"lorem", 3);
+
+    const LevenshteinTrie<char> trie(words.begin(), words.end());
+    for (const char* query : {"lorem", "ipsum", "Dolor", "consectetur", "x", "", "adipiscing,"}) {
+      levenshteinIndexExpect<std::string>(trie, words, query, 0);
+      levenshteinIndexExpect<std::string>(trie, words, query, 2);
+    }
+    levenshteinIndexExpect<std::string>(trie, words,
+      "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor", 70);
+
+    LevenshteinTrie<char16_t> emptyTrie(empty.begin(), empty.end());
+    levenshteinIndexExpect<std::u16string>(emptyTrie, empty, u"lorem", 3);
+  }
+
+  levenshteinBatchExpect<std::string>({
+      {"Saturday", "Sunday"}, {"Sitting", "Kittens"}, {"", "abc"}, {"abc", ""}, {"", ""},
+      {"A somewhat longer string", "Here is a maybe even longer string!"},
+      {"The quick brown fox jumps over the lazy dog. The five boxing wizards jump quickly. Sphinx of black quartz, judge my vow",
+       "A quick brown dog jumps over the lazy fox. Five boxing wizards jumped quickly! Sphinx of black quartz: judge my vow, please."}
+    },
+    {3, 3, 3, 3, 0, 17, 25});
+  levenshteinBatchExpect<std::u16string>({{u"Hallo, Welt!", u"Hello, World!"}, {u"Kitten", u"Sitting"}}, {4, 3});
+  levenshteinBatchExpect<std::vector<std::string>>({
+      {{"Bananas", "are", "yellow"}, {"Bananas", "are", "always", "yellow"}}
+    },
+    {1});
+  levenshteinBatchExpect<std::array<bool, 4>>({
+      {{{true, false, true, true}}, {{false, true, true, false}}}, {{{true, true, true, true}}, {{true, true, true, true}}}
+    },
+    {2, 0});
+  {
+    // enough pairs of different lengths to fill multiple batches and chunks
+    const std::u32string base = U"Sphinx of black quartz, judge my vow";
+    std::vector<std::pair<std::u32string, std::u32string>> pairs;
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < 10000; ++i) {
+      std::u32string a = base.substr(i % 7, i % 30);
+      std::u32string b = base.substr(i % 5, i % 23);
+      pairs.emplace_back(a, b);
+      expected.push_back(levenshtein(a, b));
+    }
+    levenshteinBatchExpect(pairs, expected);
+  }
+
+  levenshteinMatrixExpect<std::string>({"Saturday", "Sunday", "Sitting", "Kittens", "", "abc"},
+    ParallelPolicy(2));
+  levenshteinMatrixExpect<std::string>({"Saturday"}, ParallelPolicy(2));
+  levenshteinMatrixExpect<std::list<int>>({{2, 3, 5, 7}, {1, 3, 5, 7, 9}, {}, {2, 3}}, ParallelPolicy(3, 0, 1));
+  {
+    // sequences of very different lengths, so that the blocks are uneven
+    const FileMappedString<short> lorem("test/assets/loremipsum_1-16k.utf16");
+    std::vector<std::vector<short>> sequences;
+    for (std::size_t i = 0; i < 300; ++i) {
+      const std::size_t length = i % 17 == 0 ? 1000 + i : i % 40;
+      sequences.emplace_back(lorem.begin() + i * 13, lorem.begin() + i * 13 + length);
+    }
+    levenshteinMatrixExpect(sequences, ParallelPolicy(1));
+    levenshteinMatrixExpect(sequences, ParallelPolicy(4));
+    levenshteinMatrixExpect(sequences, ParallelPolicy(0, 0, 7));
+  }
+
+  levenshteinBoundedExpect<std::string>("Saturday", "Sunday", 3, 3);
+  levenshteinBoundedExpect<std::string>("Saturday", "Sunday", 2, 3);
+  levenshteinBoundedExpect<std::string>("Saturday", "Sunday", 0, 1);
+  levenshteinBoundedExpect<std::string>("Saturday", "Sunday", 100, 3);
+  levenshteinBoundedExpect<std::string>("A", "Sitting", 5, 6);
+  levenshteinBoundedExpect<std::string>("Sitting", "Sitting", 0, 0);
+  levenshteinBoundedExpect<std::u16string>(u"Hallo, Welt!", u"Hello, World!", 4, 4);
+  levenshteinBoundedExpect<std::list<int>>(
+    {2, 3, 5, 7, 11, 13, 17, 19},
+    {1, 3, 5, 7, 9, 11, 13, 15, 17, 19},
+    2, 3);
+  levenshteinBoundedExpect<std::vector<float>>(
+    {2, 3, 5, 7, 11, 13, 17, 19},
+    {1, 3, 5, 7, 9, 11, 13, 15, 17, 19},
+    3, 3);
+
+  levenshteinBoundedFileExpect<char>("test/assets/loremipsum_1-64k.utf8", "test/assets/loremipsum_2-64k.utf8", 100, 101);
+  levenshteinBoundedFileExpect<short>("test/assets/loremipsum_1-64k.utf16", "test/assets/loremipsum_2-64k.utf16", 49607, 49607);
+  levenshteinBoundedFileExpect<char>("test/assets/random1024_1", "test/assets/random1024_2", 1010, 1011);
+
+  {
+    FileMappedString<char> lorem("test/assets/loremipsum_1-16k.utf8");
+    std::string a(lorem.begin(), lorem.end()), b = a;
+    b[1000] = b[5000] = b[9000] = '#';
+    b.erase(12000, 1);
+    b.insert(3000, "#");
+    levenshteinBoundedExpect(a, b, 3, 4);
+    levenshteinBoundedExpect(a, b, 10, 5);
+    levenshteinBoundedExpect(std::vector<float>(a.begin(), a.end()), std::vector<float>(b.begin(), b.end()), 10, 5);
+    levenshteinContainerExpect(std::vector<float>(a.begin(), a.end()), std::vector<float>(b.begin(), b.end()), 5);
+  }
+
+  {
+    // results that exceed the range of 8-bit cells during the computation
+    std::vector<float> a, b;
+    for (int i = 0; i < 600; ++i) {
+      a.push_back(i % 300);
+      b.push_back(i % 3 == 0 ? -1 : i % 300);
+    }
+    levenshteinBoundedExpect(a, b, 150, 151);
+    levenshteinBoundedExpect(a, b, 250, 200);
+    levenshteinContainerExpect(a, b, 200);
+  }
+
+  levenshteinBoundsExpect<std::string>("Saturday", "Sunday", 3, 3);
+  levenshteinBoundsExpect<std::string>("Kitten", "Sitting", 3, 3);
+  levenshteinBoundsExpect<std::string>("Sitting", "Sitting", 0, 0);
+  levenshteinBoundsExpect<std::string>("", "Sitting", 7, 7);
+  levenshteinBoundsExpect<std::u16string>(u"Hallo, Welt!", u"Hello, World!", 3, 5);
+  levenshteinBoundsExpect<std::list<int>>(
+    {2, 3, 5, 7, 11, 13, 17, 19},
+    {1, 3, 5, 7, 9, 11, 13, 15, 17, 19},
+    3, 7);
+  levenshteinBoundsExpect<std::vector<float>>(
+    {2, 3, 5, 7, 11, 13, 17, 19},
+    {1, 3, 5, 7, 9, 11, 13, 15, 17, 19},
+    2, 5);
+
+  {
+    FileMappedString<char> lorem("test/assets/loremipsum_1-16k.utf8");
+    std::string a(lorem.begin(), lorem.end()), b = a;
+    b[1000] = b[5000] = b[9000] = '#';
+    b.erase(12000, 1);
+    b.insert(3000, "#");
+    levenshteinBoundsExpect(a, b, 4, 8871);
+    levenshteinBoundsExpect(std::u32string(a.begin(), a.end()), std::u32string(b.begin(), b.end()), 4, 8871);
+    levenshteinBoundsExpect(a, a.substr(0, 8000) + a.substr(8200), 200, 200);
+  }
+
+  {
+    FileMappedString<char> a("test/assets/random1024_1"), b("test/assets/random1024_2");
+    levenshteinBoundsExpect(std::string(a.begin(), a.end()), std::string(b.begin(), b.end()), 275, 1023);
+  }
+
+  levenshteinUtf8Expect("Saturday", "Sunday", 3);
+  levenshteinUtf8Expect("naïve", "naive", 1);
+  levenshteinUtf8Expect("Grüße", "Grüsse", 2);
+  levenshteinUtf8Expect("Hallo, Welt!", "Hallö, Wélt!", 2);
+  levenshteinUtf8Expect("Дом", "Дым", 1);
+  levenshteinUtf8Expect("日本語", "日本", 1);
+  levenshteinUtf8Expect("smile 😀", "smile 😁", 1);
+  levenshteinUtf8Expect("😀", "", 1);
+  levenshteinUtf8Expect("", "", 0);
+  levenshteinUtf8InvalidExpect("\x80");
+  levenshteinUtf8InvalidExpect("\xc0\xaf");
+  levenshteinUtf8InvalidExpect("\xed\xa0\x80");
+  levenshteinUtf8InvalidExpect("\xf4\x90\x80\x80");
+  levenshteinUtf8InvalidExpect("abc\xe2\x82");
+
+  {
+    FileMappedString<char> lorem1("test/assets/loremipsum_1-16k.utf8"), lorem2("test/assets/loremipsum_2-16k.utf8");
+    std::string a(lorem1.begin(), lorem1.end()), b(lorem2.begin(), lorem2.end());
+    // (a few of the characters are not ASCII, the distance in bytes is 12453)
+    levenshteinUtf8Expect(a, b, 12450);
+
+    // the same text with each Latin letter replaced by a two-byte one
+    std::string a2, b2;
+    for (char c : a)
+      a2 += c >= 'a' && c <= 'z' ? std::string("\xc3") + char(0x80 + c - 'a') : std::string(1, c);
+    for (char c : b)
+      b2 += c >= 'a' && c <= 'z' ? std::string("\xc3") + char(0x80 + c - 'a') : std::string(1, c);
+    levenshteinUtf8Expect(a2, b2, 12450);
+    levenshteinUtf8Expect(a2 + "😀", b2, 12451);
+  }
+
+  levenshteinEqualityExpect(std::string("Saturday"), std::string("SUNDAY"), LevenshteinAsciiCaseInsensitive(), 3);
+  levenshteinEqualityExpect(std::string("Saturday"), std::string("SUNDAY"), LevenshteinExact(), 7);
+  levenshteinEqualityExpect(std::string("[Hello]"), std::string("{hello}"), LevenshteinAsciiCaseInsensitive(), 2);
+  levenshteinEqualityExpect(std::u16string(u"Stra\u00dfe"), std::u16string(u"STRASSE"), LevenshteinAsciiCaseInsensitive(), 2);
+  levenshteinEqualityExpect(std::list<char>{ 'K', 'i', 't', 't', 'e', 'n' }, std::string("SITTING"), LevenshteinAsciiCaseInsensitive(), 3);
+  levenshteinEqualityExpect(std::vector<int>{ 'a', 'B', 300 }, std::vector<int>{ 'A', 'b', 301 }, LevenshteinAsciiCaseInsensitive(), 1);
+  levenshteinEqualityExpect(std::vector<float>{ 1, 2, 3 }, std::vector<float>{ 1, 3 }, LevenshteinExact(), 1);
+  levenshteinEqualityExpect(std::string(""), std::string("ABC"), LevenshteinAsciiCaseInsensitive(), 3);
+  {
+    // Latin-1, ignoring case and accents on e
+    LevenshteinFoldTable table([](unsigned char c) { return std::tolower(c); });
+    table.set(0xc9, 'e');
+    table.set(0xe9, 'e');
+    levenshteinEqualityExpect(std::string("CAF\xc9"), std::string("cafe"), table, 0);
+    levenshteinEqualityExpect(std::string("R\xe9sum\xe9"), std::string("RESUMES"), table, 1);
+    levenshteinEqualityExpect(std::u32string(U"Caf\u00e9\u0100"), std::u32string(U"cafe\u0101"), table, 1);
+    levenshteinEqualityExpect(std::string("ABC"), std::string("abc"), LevenshteinFoldTable(), 3);
+  }
+  {
+    FileMappedString<char> lorem1("test/assets/loremipsum_1-16k.utf8"), lorem2("test/assets/loremipsum_2-16k.utf8");
+    std::string a(lorem1.begin(), lorem1.end()), b(lorem2.begin(), lorem2.end());
+    std::string upper(a);
+    for (char& c : upper)
+      c = c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c;
+    levenshteinEqualityExpect(upper, a, LevenshteinAsciiCaseInsensitive(), 0);
+    // (12453 when comparing exactly)
+    levenshteinEqualityExpect(upper, b, LevenshteinAsciiCaseInsensitive(), 12391);
+    levenshteinEqualityExpect(std::u16string(upper.begin(), upper.end()),
+      std::u16string(b.begin(), b.end()), LevenshteinAsciiCaseInsensitive(), 12391);
+  }
   return 0;
 }